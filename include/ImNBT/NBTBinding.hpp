@@ -0,0 +1,313 @@
+#pragma once
+
+#include "NBTReader.hpp"
+#include "NBTRepresentation.hpp"
+#include "NBTWriter.hpp"
+
+#include <cassert>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief A member of a bound struct together with the tag name it is stored under. The name hash is computed at compile time.
+ */
+template<typename Class, typename T>
+struct Field
+{
+  StringView name;
+  uint32_t nameHash;
+  T Class::*member;
+};
+
+template<typename Class, typename T>
+constexpr Field<Class, T> MakeField(StringView name, T Class::*member)
+{
+  return { name, Internal::HashName(name), member };
+}
+
+/*!
+ * \brief Specialized by IMNBT_BIND() with the field list of a struct.
+ */
+template<typename T>
+struct Binding;
+
+namespace Internal
+{
+
+template<typename T, typename = void>
+struct IsBound : std::false_type {};
+template<typename T>
+struct IsBound<T, std::void_t<decltype(Binding<T>::fields)>> : std::true_type {};
+
+template<typename T>
+struct IsVector : std::false_type {};
+template<typename T, typename A>
+struct IsVector<std::vector<T, A>> : std::true_type {};
+
+template<typename T>
+struct IsOptional : std::false_type {};
+template<typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+constexpr bool IsArray = std::is_same_v<T, std::vector<int8_t>> || std::is_same_v<T, std::vector<int32_t>> || std::is_same_v<T, std::vector<int64_t>>;
+
+template<typename T>
+constexpr bool AlwaysFalse = false;
+
+// the tag a bound member type is stored as
+template<typename T>
+constexpr TAG BoundTag()
+{
+  if constexpr (IsBound<T>::value)
+    return TAG::Compound;
+  else if constexpr (std::is_same_v<T, std::vector<int8_t>>)
+    return TAG::Byte_Array;
+  else if constexpr (std::is_same_v<T, std::vector<int32_t>>)
+    return TAG::Int_Array;
+  else if constexpr (std::is_same_v<T, std::vector<int64_t>>)
+    return TAG::Long_Array;
+  else if constexpr (IsVector<T>::value)
+    return TAG::List;
+  else if constexpr (std::is_same_v<T, std::string>)
+    return TAG::String;
+  else if constexpr (std::is_same_v<T, bool>)
+    return TAG::Byte;
+  else
+    return TagTraits<T>::Tag;
+}
+
+struct BindingAccess
+{
+  template<typename T>
+  static void Write(Writer& writer, T const& value, StringView name)
+  {
+    if constexpr (IsOptional<T>::value)
+    {
+      if (value)
+        Write(writer, *value, name);
+    }
+    else if constexpr (IsBound<T>::value)
+    {
+      if (writer.BeginCompound(name))
+      {
+        std::apply([&](auto const&... field) { (Write(writer, value.*(field.member), field.name), ...); }, Binding<T>::fields);
+        writer.EndCompound();
+      }
+    }
+    else if constexpr (std::is_same_v<T, std::vector<int8_t>>)
+      writer.WriteByteArray(value.data(), static_cast<int32_t>(value.size()), name);
+    else if constexpr (std::is_same_v<T, std::vector<int32_t>>)
+      writer.WriteIntArray(value.data(), static_cast<int32_t>(value.size()), name);
+    else if constexpr (std::is_same_v<T, std::vector<int64_t>>)
+      writer.WriteLongArray(value.data(), static_cast<int32_t>(value.size()), name);
+    else if constexpr (IsVector<T>::value)
+    {
+      if (writer.BeginList(name))
+      {
+        for (typename T::value_type const& element : value)
+          Write(writer, element, "");
+        writer.EndList();
+      }
+    }
+    else if constexpr (std::is_same_v<T, std::string>)
+      writer.WriteString(value, name);
+    else if constexpr (std::is_same_v<T, bool>)
+      writer.WriteByte(value ? 1 : 0, name);
+    else if constexpr (std::is_same_v<T, int8_t>)
+      writer.WriteByte(value, name);
+    else if constexpr (std::is_same_v<T, int16_t>)
+      writer.WriteShort(value, name);
+    else if constexpr (std::is_same_v<T, int32_t>)
+      writer.WriteInt(value, name);
+    else if constexpr (std::is_same_v<T, int64_t>)
+      writer.WriteLong(value, name);
+    else if constexpr (std::is_same_v<T, float>)
+      writer.WriteFloat(value, name);
+    else if constexpr (std::is_same_v<T, double>)
+      writer.WriteDouble(value, name);
+    else
+      static_assert(AlwaysFalse<T>, "ImNBT : type cannot be bound");
+  }
+
+  template<typename T>
+  static bool ReadCompound(Reader& reader, StringView name, T& value)
+  {
+    // an unnamed read at file level reads the root compound in place
+    size_t const depth = reader.containers.size();
+    if (!reader.OpenCompound(name))
+      return false;
+    ReadFields(reader, value);
+    if (reader.containers.size() > depth)
+      reader.CloseEntry();
+    return true;
+  }
+
+  template<typename T>
+  static void ReadFields(Reader& reader, T& value)
+  {
+    // fields are usually stored in the order they were written, so each lookup first checks the position right after the previous field
+    size_t positionHint = 0;
+    std::apply([&](auto const&... field) { (ReadField(reader, field, positionHint, value.*(field.member)), ...); }, Binding<T>::fields);
+  }
+
+  template<typename Class, typename T>
+  static void ReadField(Reader& reader, Field<Class, T> const& field, size_t& positionHint, T& value)
+  {
+    EntryLocation const entry = reader.LocateEntry(field.name, field.nameHash, positionHint);
+    if (entry.type == TAG::End)
+      return;
+    ++positionHint;
+    ReadLocated(reader, entry, value);
+  }
+
+  template<typename T>
+  static bool ReadLocated(Reader& reader, EntryLocation const& entry, T& value)
+  {
+    if constexpr (IsOptional<T>::value)
+    {
+      typename T::value_type inner{};
+      if (!ReadLocated(reader, entry, inner))
+        return false;
+      value = std::move(inner);
+      return true;
+    }
+    else if constexpr (IsBound<T>::value || (IsVector<T>::value && !IsArray<T>))
+    {
+      if (entry.type != BoundTag<T>() || !reader.OpenEntry(entry))
+        return false;
+      ReadOpened(reader, value);
+      reader.CloseEntry();
+      return true;
+    }
+    else
+      return reader.ReadEntry(entry, value);
+  }
+
+  // reads the contents of the container on top of the reader's stack
+  template<typename T>
+  static void ReadOpened(Reader& reader, T& value)
+  {
+    if constexpr (IsBound<T>::value)
+      ReadFields(reader, value);
+    else
+    {
+      using Element = typename T::value_type;
+      static_assert(!IsOptional<Element>::value, "ImNBT : list elements cannot be optional");
+      int32_t const count = reader.ListSize();
+      if (count > 0 && reader.ListElementType() != BoundTag<Element>())
+        return;
+      value.resize(count);
+      for (int32_t i = 0; i < count; ++i)
+      {
+        Element element{};
+        ReadElement(reader, element);
+        value[i] = std::move(element);
+      }
+    }
+  }
+
+  template<typename T>
+  static void ReadElement(Reader& reader, T& value)
+  {
+    if constexpr (IsBound<T>::value)
+    {
+      if (reader.OpenCompound())
+      {
+        ReadOpened(reader, value);
+        reader.CloseEntry();
+      }
+    }
+    else if constexpr (IsVector<T>::value && !IsArray<T>)
+    {
+      if (reader.OpenList())
+      {
+        ReadOpened(reader, value);
+        reader.CloseList();
+      }
+    }
+    else if constexpr (std::is_same_v<T, std::vector<int8_t>>)
+      value = reader.ReadByteArray();
+    else if constexpr (std::is_same_v<T, std::vector<int32_t>>)
+      value = reader.ReadIntArray();
+    else if constexpr (std::is_same_v<T, std::vector<int64_t>>)
+      value = reader.ReadLongArray();
+    else if constexpr (std::is_same_v<T, std::string>)
+      value = std::string(reader.ReadString());
+    else if constexpr (std::is_same_v<T, bool>)
+      value = reader.ReadByte() != 0;
+    else if constexpr (std::is_same_v<T, int8_t>)
+      value = reader.ReadByte();
+    else if constexpr (std::is_same_v<T, int16_t>)
+      value = reader.ReadShort();
+    else if constexpr (std::is_same_v<T, int32_t>)
+      value = reader.ReadInt();
+    else if constexpr (std::is_same_v<T, int64_t>)
+      value = reader.ReadLong();
+    else if constexpr (std::is_same_v<T, float>)
+      value = reader.ReadFloat();
+    else if constexpr (std::is_same_v<T, double>)
+      value = reader.ReadDouble();
+    else
+      static_assert(AlwaysFalse<T>, "ImNBT : type cannot be bound");
+  }
+};
+
+} // namespace Internal
+
+} // namespace ImNBT
+
+/*!
+ * \brief Binds the members of a struct to the fields of a compound, after which the struct can be passed to Writer::Write(), Reader::Read() and Reader::MaybeRead() like any other value.
+ *
+ * Supported member types are the NBT primitives, bool, std::string, std::vector<int8_t/int32_t/int64_t> (stored as arrays), std::vector of any other supported type (stored as a list), std::optional of any supported type (omitted when empty) and other bound structs.
+ *
+ * Example:
+ *
+ *  struct Item { std::string id; int8_t count; };
+ *  IMNBT_BIND(Item, IMNBT_FIELD(id), IMNBT_FIELD_NAMED(count, "Count"))
+ *
+ *  writer.Write(item, "item");
+ *  Item item = reader.Read<Item>("item");
+ *
+ * Must be used at global scope, before the first use of the struct with Read/Write. Missing fields are left at their default value on read.
+ */
+#define IMNBT_BIND(Type, ...)                                                        \
+  template<>                                                                         \
+  struct ImNBT::Binding<Type>                                                        \
+  {                                                                                  \
+    using BoundType = Type;                                                          \
+    static constexpr auto fields = std::make_tuple(__VA_ARGS__);                     \
+  };                                                                                 \
+  template<>                                                                         \
+  inline void ImNBT::Writer::Write<Type>(Type value, StringView name)                \
+  {                                                                                  \
+    ::ImNBT::Internal::BindingAccess::Write(*this, value, name);                     \
+  }                                                                                  \
+  template<>                                                                         \
+  inline Type ImNBT::Reader::Read<Type>(StringView name)                             \
+  {                                                                                  \
+    Type value{};                                                                    \
+    [[maybe_unused]] bool const found =                                              \
+      ::ImNBT::Internal::BindingAccess::ReadCompound(*this, name, value);            \
+    assert(found && "Reader : Bound compound not found");                            \
+    return value;                                                                    \
+  }                                                                                  \
+  template<>                                                                         \
+  inline ImNBT::Optional<Type> ImNBT::Reader::MaybeRead<Type>(StringView name)       \
+  {                                                                                  \
+    Type value{};                                                                    \
+    if (!::ImNBT::Internal::BindingAccess::ReadCompound(*this, name, value))         \
+      return std::nullopt;                                                           \
+    return value;                                                                    \
+  }
+
+#define IMNBT_FIELD(member) ::ImNBT::MakeField(#member, &BoundType::member)
+#define IMNBT_FIELD_NAMED(member, name) ::ImNBT::MakeField(name, &BoundType::member)
@@ -2,12 +2,30 @@
 
 #include "NBTRepresentation.hpp"
 
+#include <array>
 #include <stack>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 namespace ImNBT
 {
 
+class TagRef;
+
+/*!
+ * \brief Counters of Builder::GetDeduplicationStats(): the strings, arrays and compounds stored as references to an equal one
+ * stored before, and the bytes of pools and tables this saved.
+ */
+struct DeduplicationStats
+{
+  uint64_t strings = 0;
+  uint64_t arrays = 0;
+  uint64_t compounds = 0;
+  uint64_t bytesSaved = 0;
+};
+
 class Builder
 {
 public:
@@ -89,6 +107,44 @@ public:
   void WriteLongArray(int64_t const* array, int32_t count, StringView name = "");
   void WriteString(StringView str, StringView name = "");
 
+  /*!
+   * \brief Copies a tag of another document, with everything it contains, into the open compound or list.
+   * Strings and arrays that lie next to each other in the source are copied as whole ranges,
+   * and the values of a shaped list column by column, so copying a large subtree costs little more than copying its bytes.
+   *
+   * Usage:
+   *
+   *  reader.OpenList("Sections");
+   *  writer.WriteCopy(reader.Current(), "Sections");
+   *
+   * \param source a handle from a Reader, Document or Editor, see NBTPath.hpp
+   * \param name the name to give the copy
+   * \return true if the tag was copied, false if the handle is invalid or the copy cannot be added here
+   */
+  bool WriteCopy(TagRef const& source, StringView name = "");
+
+  /*!
+   * \brief Enables storing homogeneous lists of compounds column-wise.
+   * When a list of compounds ends and every element has the same names with the same types, in the same order,
+   * the names are kept once in a schema shared by all such lists, and the values of each field are packed contiguously.
+   * Reading and exporting are unaffected, apart from taking less memory and time.
+   * Lists whose elements contain compounds (directly, or in nested lists) are kept as they are.
+   * Disabled by default.
+   */
+  void SetListShaping(bool enabled);
+
+  /*!
+   * \brief Enables storing equal strings, arrays and compounds once.
+   * Each string and array written is compared with those written before it, and each compound when it ends.
+   * One that is equal to an earlier one refers to its storage, and the storage it used itself is released, so a document
+   * repeating the same item stacks, palette entries or empty compounds many times holds each of them once.
+   * Compounds must also keep their entries in the same order to be shared. Reading and exporting are unaffected.
+   * Editors copy a shared compound before changing it, so the other tags referring to it keep their value.
+   * Writing takes longer, as every value and compound is hashed. Disabled by default.
+   */
+  void SetDeduplication(bool enabled);
+  DeduplicationStats GetDeduplicationStats() const;
+
   void Finalize();
 protected:
   void Begin(StringView rootName = "");
@@ -124,6 +180,12 @@ protected:
       AnonContainer anonContainer;
       TemporaryContainer* temporaryContainer = nullptr;
     };
+    // sizes of namedTags and compoundStorage when a list was begun
+    size_t tagMark = 0;
+    size_t storageMark = 0;
+    // decode plan serving named reads from this compound, -1 until it is looked up, and how many it has served
+    int32_t decodePlan = -1;
+    uint32_t decodeStep = 0;
 
     TAG& Type();
     TAG Type() const;
@@ -132,15 +194,47 @@ protected:
     void IncrementCount(DataStore& ds);
     uint64_t Storage(DataStore const& ds) const;
     size_t& PoolIndex(DataStore& ds);
+    TagPayload::List& ListPayload(DataStore& ds);
+    TagPayload::List const& ListPayload(DataStore const& ds) const;
+    TagPayload::Compound CompoundPayload(DataStore const& ds) const;
   };
 
   std::stack<ContainerInfo> containers;
 
+  bool listShaping = false;
+
+  bool ShapeList(ContainerInfo& container);
+
+  bool deduplication = false;
+  DeduplicationStats deduplicationStats;
+  // the strings, arrays and compounds stored so far, and their indices by content hash.
+  // Entries of a released compound are dropped from the former only, indices past its end are skipped
+  std::vector<DataTag> deduplicated;
+  std::unordered_multimap<uint64_t, size_t> deduplicatedByHash;
+  // sizes of the pools and tables when each open compound began, to release a compound that turns out to be a duplicate
+  struct DeduplicationMark
+  {
+    std::array<size_t, std::tuple_size_v<decltype(Internal::AllPools::pools)>> pools;
+    size_t shapedLists;
+    size_t deduplicated;
+    DeduplicationStats stats;
+  };
+  std::vector<DeduplicationMark> deduplicationMarks;
+
+  // an earlier tag equal to tag, or nullptr. tag is added to the candidates if there is none
+  DataTag const* FindDuplicate(uint64_t hash, DataTag const& tag);
+  // the payload of an earlier equal string or array, with the values just appended to the pool of Value released
+  template<typename Value, typename T>
+  T Deduplicate(TAG type, T payload, size_t length);
+  void PushDeduplicationMark();
+  void DeduplicateCompound(ContainerInfo& container);
+
+  // a container written with open set to false is complete, and is not opened for further writes
   template<typename T, typename Fn>
-  bool WriteTag(TAG type, StringView name, Fn valueGetter);
+  bool WriteTag(TAG type, StringView name, Fn valueGetter, bool open = true);
 
   template<typename T, std::enable_if_t<!std::is_invocable_v<T>, bool> = true>
-  bool WriteTag(TAG type, StringView name, T value);
+  bool WriteTag(TAG type, StringView name, T value, bool open = true);
 };
 
 } // namespace ImNBT
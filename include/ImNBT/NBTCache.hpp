@@ -0,0 +1,80 @@
+#pragma once
+
+#include "NBTDocument.hpp"
+
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief A cache of parsed documents shared by everything in a process that imports the same files.
+ *
+ * Files are keyed by path, size and modification time, so a file that changed is parsed again. Data in memory is keyed by
+ * a hash of its contents, and a copy of the contents is kept to confirm hits, so it also counts towards the memory usage.
+ * Lookups are safe from any thread, and concurrent misses for the same key wait for one parse.
+ *
+ * Documents are evicted least recently used first once their memory usage exceeds the budget. An evicted document
+ * stays alive for as long as anyone still holds it.
+ */
+class DocumentCache
+{
+public:
+  struct Stats
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // misses that found a parse of the same key in progress, and waited for it
+    uint64_t sharedLoads = 0;
+    uint64_t failedLoads = 0;
+    uint64_t evictions = 0;
+    size_t documents = 0;
+    size_t memoryUsage = 0;
+  };
+
+  explicit DocumentCache(size_t memoryBudget = 256u << 20);
+
+  /*!
+   * \brief The document of a file, imported as by Reader::ImportFile(). Returns nullptr if the file cannot be imported.
+   */
+  DocumentPtr Get(StringView filepath);
+  /*!
+   * \brief The document of binary NBT data, as imported by Reader::ImportBinary().
+   */
+  DocumentPtr Get(uint8_t const* data, size_t length);
+
+  void SetMemoryBudget(size_t memoryBudget);
+  Stats GetStats() const;
+  void Clear();
+
+private:
+  struct Slot
+  {
+    std::shared_future<DocumentPtr> document;
+    // set once the document is loaded
+    bool ready = false;
+    size_t memoryUsage = 0;
+    std::list<std::string>::iterator recency{};
+    // the bytes of data in memory, copied while the document loads. Only read once it has loaded
+    std::shared_ptr<std::vector<uint8_t>> contents;
+  };
+
+  mutable std::mutex mutex;
+  size_t memoryBudget;
+  std::unordered_map<std::string, Slot> slots;
+  // keys of loaded documents, most recently used first
+  std::list<std::string> recency;
+  Stats stats;
+
+  DocumentPtr Lookup(std::string const& key, std::function<DocumentPtr()> const& load, uint8_t const* data = nullptr, size_t length = 0);
+  void Evict();
+};
+
+} // namespace ImNBT
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "NBTPath.hpp"
+#include "NBTRepresentation.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief A parsed document that is never changed again. Documents are made with Reader::ReleaseDocument(), held by
+ * std::shared_ptr<Document const>, and can be queried from any number of threads at once without locking.
+ */
+class Document
+{
+public:
+  /*!
+   * \brief Handle to the root compound, for use with Path. Handles stay valid as long as the document does.
+   */
+  TagRef Root() const;
+
+  /*!
+   * \brief Bytes of memory held by the document.
+   */
+  size_t MemoryUsage() const { return dataStore.MemoryUsage(); }
+  /*!
+   * \brief Bytes of memory held by the document that it does not share with base, an earlier snapshot of the same Editor.
+   */
+  size_t MemoryUsage(Document const& base) const { return dataStore.MemoryUsage(base.dataStore); }
+
+private:
+  DataStore dataStore;
+
+  friend class Editor;
+  friend class Reader;
+  friend class Writer;
+};
+
+using DocumentPtr = std::shared_ptr<Document const>;
+
+/*!
+ * \brief A read position in a shared Document, with the navigation and read functions of Reader.
+ *
+ * A cursor holds a reference to its document and the containers it has open, so any number of cursors,
+ * in any number of threads, can read one document at once without synchronization. A single cursor is not thread safe.
+ *
+ * Unlike Reader, reads of missing tags or past the end of a list do not assert: MaybeRead functions return nothing
+ * and Read functions return a default value.
+ */
+class Cursor
+{
+public:
+  explicit Cursor(DocumentPtr document);
+
+  /*!
+   * \brief Opens a compound for reading, by name from a compound or the next element of a list. See Reader::OpenCompound().
+   * Opening an unnamed compound at the root opens the root itself.
+   */
+  bool OpenCompound(StringView name = "");
+  void CloseCompound();
+  bool OpenList(StringView name = "");
+  void CloseList();
+
+  /*!
+   * \brief The number of elements of the open list, or of entries of the open compound.
+   */
+  int32_t Count() const;
+  int32_t ListSize() const;
+
+  /*!
+   * \brief The open container, for use with Path.
+   */
+  TagRef Current() const { return frames.back().container; }
+
+  int8_t ReadByte(StringView name = "") { return MaybeRead<int8_t>(name).value_or(0); }
+  int16_t ReadShort(StringView name = "") { return MaybeRead<int16_t>(name).value_or(0); }
+  int32_t ReadInt(StringView name = "") { return MaybeRead<int32_t>(name).value_or(0); }
+  int64_t ReadLong(StringView name = "") { return MaybeRead<int64_t>(name).value_or(0); }
+  float ReadFloat(StringView name = "") { return MaybeRead<float>(name).value_or(0.f); }
+  double ReadDouble(StringView name = "") { return MaybeRead<double>(name).value_or(0.); }
+  std::vector<int8_t> ReadByteArray(StringView name = "") { return MaybeReadByteArray(name).value_or(std::vector<int8_t>{}); }
+  std::vector<int32_t> ReadIntArray(StringView name = "") { return MaybeReadIntArray(name).value_or(std::vector<int32_t>{}); }
+  std::vector<int64_t> ReadLongArray(StringView name = "") { return MaybeReadLongArray(name).value_or(std::vector<int64_t>{}); }
+  StringView ReadString(StringView name = "") { return MaybeRead<StringView>(name).value_or(StringView{}); }
+
+  Optional<int8_t> MaybeReadByte(StringView name = "") { return MaybeRead<int8_t>(name); }
+  Optional<int16_t> MaybeReadShort(StringView name = "") { return MaybeRead<int16_t>(name); }
+  Optional<int32_t> MaybeReadInt(StringView name = "") { return MaybeRead<int32_t>(name); }
+  Optional<int64_t> MaybeReadLong(StringView name = "") { return MaybeRead<int64_t>(name); }
+  Optional<float> MaybeReadFloat(StringView name = "") { return MaybeRead<float>(name); }
+  Optional<double> MaybeReadDouble(StringView name = "") { return MaybeRead<double>(name); }
+  Optional<std::vector<int8_t>> MaybeReadByteArray(StringView name = "") { return Next(TAG::Byte_Array, name).AsByteArray(); }
+  Optional<std::vector<int32_t>> MaybeReadIntArray(StringView name = "") { return Next(TAG::Int_Array, name).AsIntArray(); }
+  Optional<std::vector<int64_t>> MaybeReadLongArray(StringView name = "") { return Next(TAG::Long_Array, name).AsLongArray(); }
+  Optional<StringView> MaybeReadString(StringView name = "") { return MaybeRead<StringView>(name); }
+
+  /*!
+   * \brief Reads a value of one of the types of TagRef::As().
+   */
+  template<typename T>
+  Optional<T> MaybeRead(StringView name = "")
+  {
+    return Next(Internal::TagTraits<T>::Tag, name).template As<T>();
+  }
+
+private:
+  struct Frame
+  {
+    TagRef container;
+    // the next element of a list, or where the last entry of a compound was found
+    int32_t position = 0;
+  };
+
+  DocumentPtr document;
+  std::vector<Frame> frames;
+
+  // the tag a read refers to: the entry of the open compound with the given name, or the next element of the open list
+  TagRef Next(TAG type, StringView name);
+  bool Open(TAG type, StringView name);
+};
+
+} // namespace ImNBT
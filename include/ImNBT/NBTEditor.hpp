@@ -0,0 +1,175 @@
+#pragma once
+
+#include "NBTDocument.hpp"
+#include "NBTPath.hpp"
+#include "NBTRepresentation.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief Changes a document while other threads go on reading earlier versions of it.
+ *
+ * An editor starts from a Document and publishes its changes as new documents with Snapshot(). Starting an editor and
+ * taking a snapshot are both O(1), as the editor and its snapshots share their tag tables and pools. A change copies only
+ * the table segments holding the tags it changes, and moves changed list elements and shaped list fields to the end of
+ * their pool rather than overwriting them, so documents taken before a change never see it. The space this leaves
+ * behind is reclaimed by Compact(). Snapshots can be exported by constructing a Writer from them.
+ *
+ * An editor is not thread safe, but the documents it makes may be read from any number of threads while it goes on editing.
+ */
+class Editor
+{
+public:
+  explicit Editor(DocumentPtr document);
+
+  /*!
+   * \brief The document as edited so far. Later changes to the editor do not affect it.
+   */
+  DocumentPtr Snapshot() const;
+
+  /*!
+   * \brief Handle to the root compound of the edited document, for use with Path. Handles are valid until the next change.
+   */
+  TagRef Root() const;
+
+  /*!
+   * \brief Sets the value of the tag a path refers to, which must already hold a value of the same type.
+   * Returns false, and changes nothing, if the path has wildcards or refers to no tag of that type.
+   * This holds for every edit: a failed edit changes nothing.
+   */
+  bool SetByte(Path const& path, int8_t value) { return Set(path, value); }
+  bool SetShort(Path const& path, int16_t value) { return Set(path, value); }
+  bool SetInt(Path const& path, int32_t value) { return Set(path, value); }
+  bool SetLong(Path const& path, int64_t value) { return Set(path, value); }
+  bool SetFloat(Path const& path, float value) { return Set(path, value); }
+  bool SetDouble(Path const& path, double value) { return Set(path, value); }
+
+  bool SetString(Path const& path, StringView value) { return Set(path, value); }
+  /*!
+   * \brief Replaces the array a path refers to, which may have another length. Values are given in host byte order.
+   */
+  bool SetByteArray(Path const& path, int8_t const* values, int32_t count);
+  bool SetIntArray(Path const& path, int32_t const* values, int32_t count);
+  bool SetLongArray(Path const& path, int64_t const* values, int32_t count);
+
+  template<typename T>
+  bool Set(Path const& path, T value);
+
+  /*!
+   * \brief Adds an entry to the compound a path refers to, replacing any entry of the same name whatever its type.
+   * Compounds and lists are added empty, to be filled by later edits. Returns false if the path refers to no compound.
+   */
+  bool InsertByte(Path const& compound, StringView name, int8_t value) { return Insert(compound, name, value); }
+  bool InsertShort(Path const& compound, StringView name, int16_t value) { return Insert(compound, name, value); }
+  bool InsertInt(Path const& compound, StringView name, int32_t value) { return Insert(compound, name, value); }
+  bool InsertLong(Path const& compound, StringView name, int64_t value) { return Insert(compound, name, value); }
+  bool InsertFloat(Path const& compound, StringView name, float value) { return Insert(compound, name, value); }
+  bool InsertDouble(Path const& compound, StringView name, double value) { return Insert(compound, name, value); }
+  bool InsertString(Path const& compound, StringView name, StringView value) { return Insert(compound, name, value); }
+  bool InsertByteArray(Path const& compound, StringView name, int8_t const* values, int32_t count);
+  bool InsertIntArray(Path const& compound, StringView name, int32_t const* values, int32_t count);
+  bool InsertLongArray(Path const& compound, StringView name, int64_t const* values, int32_t count);
+  bool InsertCompound(Path const& compound, StringView name);
+  bool InsertList(Path const& compound, StringView name);
+
+  template<typename T>
+  bool Insert(Path const& compound, StringView name, T value);
+
+  /*!
+   * \brief Appends an element to the list a path refers to. An empty list takes the type of its first element,
+   * other lists only accept elements of the type they hold.
+   */
+  bool AppendByte(Path const& list, int8_t value) { return Append(list, value); }
+  bool AppendShort(Path const& list, int16_t value) { return Append(list, value); }
+  bool AppendInt(Path const& list, int32_t value) { return Append(list, value); }
+  bool AppendLong(Path const& list, int64_t value) { return Append(list, value); }
+  bool AppendFloat(Path const& list, float value) { return Append(list, value); }
+  bool AppendDouble(Path const& list, double value) { return Append(list, value); }
+  bool AppendString(Path const& list, StringView value) { return Append(list, value); }
+  bool AppendByteArray(Path const& list, int8_t const* values, int32_t count);
+  bool AppendIntArray(Path const& list, int32_t const* values, int32_t count);
+  bool AppendLongArray(Path const& list, int64_t const* values, int32_t count);
+  bool AppendCompound(Path const& list);
+  bool AppendList(Path const& list);
+
+  template<typename T>
+  bool Append(Path const& list, T value);
+
+  /*!
+   * \brief Removes the compound entry or list element a path refers to. The root compound can not be removed.
+   */
+  bool Remove(Path const& path);
+
+  /*!
+   * \brief Copies the edited document into new tables and pools, leaving out the values and tags that edits replaced or removed.
+   *
+   * Edits never reuse the space of what they replace, so the store of a long running editor only grows. Compacting is
+   * O(document), and the compacted store shares nothing with earlier snapshots, so it is best done between bursts of edits.
+   * Returns the bytes of memory reclaimed, compared to the editor before compacting.
+   */
+  size_t Compact();
+
+  /*!
+   * \brief Encodes the edited document in binary, keeping the output to speed up the next export.
+   *
+   * The root, each of its entries, and every deeper compound or shaped list of at least cacheThreshold encoded bytes
+   * remember where they are in the output. Until an edit changes them, later exports copy their bytes from it
+   * instead of encoding them again, so saving a large document after a few edits costs little more than copying it.
+   * Snapshots taken after an export share the output and export the same way. The editor holds on to the output
+   * until the next export. Returns nullptr if the document is empty.
+   */
+  std::shared_ptr<std::vector<uint8_t> const> ExportBinary(size_t cacheThreshold = 4096);
+
+  /*!
+   * \brief Hash of the tag a path refers to, as TagRef::Hash(), or 0 if there is none.
+   *
+   * The hash of every compound visited is cached until an edit changes it or anything it holds, so hashing again after
+   * a few edits only visits the compounds on the paths to them. Snapshots taken afterwards share the cached hashes,
+   * which also speed up hashing their handles and comparing them with TagRef::Equals().
+   */
+  uint64_t Hash(Path const& path, HashOrder order = HashOrder::Stored);
+
+private:
+  // where a tag on the path to a change is stored, so the change can be written back to its owner
+  struct Link
+  {
+    enum class Slot
+    {
+      // a tag of namedTags, index is its position
+      Record,
+      // an element of the list of the previous link, index is its position in the list
+      Element,
+      // an entry of a shaped list element, index is its field in the schema of the list
+      Field,
+    } slot;
+    DataTag tag;
+    size_t index;
+  };
+
+  DataStore dataStore;
+
+  bool Resolve(Path const& path, std::vector<Link>& chain) const;
+  // resolves a path to be changed, with every compound on it made a compound of its own first
+  bool ResolveForChange(Path const& path, std::vector<Link>& chain);
+  // copies the first compound of the chain that deduplication shares with other tags, returns false if there is none
+  bool Unshare(std::vector<Link>& chain);
+  void Store(std::vector<Link>& chain, size_t link, DataTag const& tag);
+  // the containers of the chain are no longer as they were read, so exports encode them again
+  void MarkChanged(std::vector<Link> const& chain);
+  // stores the shaped list of the chain as a regular list of compounds, so its elements can change shape
+  void Unshape(std::vector<Link>& chain, size_t link);
+
+  // make(DataStore&) writes the value to the pools and returns its tag, once the path is known to accept it
+  template<typename Make>
+  bool Replace(Path const& path, TAG type, Make make);
+  template<typename Make>
+  bool Insert(Path const& compound, StringView name, TAG type, Make make);
+  template<typename Make>
+  bool Append(Path const& list, TAG type, Make make);
+};
+
+} // namespace ImNBT
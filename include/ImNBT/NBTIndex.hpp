@@ -0,0 +1,100 @@
+#pragma once
+
+#include "NBTReader.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief A persistent index of where the tags near the root of a binary file are, so single subtrees can be decoded
+ * without inflating and parsing the file from the beginning. See Reader::ImportIndexedSubtree().
+ *
+ * Tags are indexed by their path (see Path), written with keys quoted only where needed and plain list indices:
+ *
+ *    Level.Sections[3]
+ *
+ * For compressed files the index also holds inflate checkpoints, as in zlib's zran example: at the first deflate block
+ * boundary after every checkpointSpacing bytes of output, the compressed position and the last 32 KiB of output,
+ * from which inflation can resume. Each checkpoint takes 32 KiB in memory and in the index file.
+ *
+ * An index records the size, modification time and a hash of samples of the file it describes.
+ * Load() rejects an index if any of these changed, and imports through it fail if the size or modification time did.
+ */
+class OffsetIndex
+{
+public:
+  /*!
+   * \brief Where a tag is in the decompressed stream. Named tags span their header and payload, list elements only their payload.
+   */
+  struct Entry
+  {
+    uint64_t offset;
+    uint64_t size;
+    TAG type;
+    bool named;
+  };
+
+  /*!
+   * \brief Indexes the tags up to depth levels below the root of a binary file, gzip or zlib compressed or not.
+   */
+  static Optional<OffsetIndex> Build(StringView filepath, int depth = 2, size_t checkpointSpacing = 1 << 20);
+  /*!
+   * \brief Loads an index saved with Save(), if it still describes the file at filepath.
+   */
+  static Optional<OffsetIndex> Load(StringView indexPath, StringView filepath);
+  bool Save(StringView indexPath) const;
+
+  /*!
+   * \brief Whether the file still has the size, modification time and hash it was indexed with.
+   */
+  bool IsCurrent() const;
+
+  Entry const* Find(StringView path) const;
+  size_t EntryCount() const { return entries.size(); }
+  size_t CheckpointCount() const { return checkpoints.size(); }
+
+  /*!
+   * \brief Decompresses the bytes of an entry, resuming inflation at the last checkpoint before it.
+   */
+  bool Read(Entry const& entry, std::vector<uint8_t>& out) const;
+
+private:
+  static constexpr size_t WindowSize = 32768;
+
+  struct Checkpoint
+  {
+    // position in the compressed file, of the byte holding the first bits of the next block if bits is not 0
+    uint64_t in;
+    // position in the decompressed stream
+    uint64_t out;
+    uint8_t bits;
+    std::vector<uint8_t> window;
+  };
+
+  struct FileStamp
+  {
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t hash = 0;
+
+    bool operator==(FileStamp const& other) const { return size == other.size && modified == other.modified && hash == other.hash; }
+  };
+
+  std::string filepath;
+  bool compressed = false;
+  FileStamp stamp;
+  std::vector<Checkpoint> checkpoints;
+  std::unordered_map<std::string, Entry> entries;
+
+  class InflateSource;
+
+  static Optional<FileStamp> StampFile(StringView filepath, bool hash);
+
+  friend class Reader;
+};
+
+} // namespace ImNBT
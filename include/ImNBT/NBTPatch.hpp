@@ -0,0 +1,85 @@
+#pragma once
+
+#include "NBTEditor.hpp"
+#include "NBTPath.hpp"
+#include "NBTRepresentation.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief The changes that turn one version of a document into another, encoded compactly, so a replica can be brought
+ * up to date by sending the changes rather than the whole document.
+ *
+ * A patch is a sequence of edits, applied in order to an Editor holding the old version:
+ *  - setting a value, or only the ranges of an array that differ, along with its new length
+ *  - adding a compound entry or list element; compounds and lists are added empty, and filled by the edits that follow
+ *  - removing a compound entry or list element
+ * Its size grows with the changes, not with the document. Entries keep their order when changed in place,
+ * and added entries end up after those that were there before.
+ *
+ * Usage:
+ *
+ *   Optional<Patch> patch = Patch::Diff(previous->Root(), current->Root());
+ *   send(patch->Bytes());
+ *   ...
+ *   Optional<Patch> received = Patch::Decode(data, size);
+ *   if (received && received->Apply(editor))
+ *     ...
+ */
+class Patch
+{
+public:
+  struct Change
+  {
+    enum class Kind
+    {
+      // added, or replaced by a tag of another type
+      Added,
+      Removed,
+      Changed,
+    } kind;
+    // in the syntax of Path
+    std::string path;
+  };
+
+  /*!
+   * \brief The changes from one root compound to another. Returns nothing if either is not a compound.
+   */
+  static Optional<Patch> Diff(TagRef const& from, TagRef const& to);
+  /*!
+   * \brief A patch from its encoding, or nothing if data is not a valid encoding.
+   */
+  static Optional<Patch> Decode(uint8_t const* data, size_t size);
+
+  std::vector<uint8_t> const& Bytes() const { return bytes; }
+  /*!
+   * \brief True if the documents compared were equal.
+   */
+  bool Empty() const;
+
+  /*!
+   * \brief The paths that are added, removed or changed, in the order the edits apply. The contents of added compounds
+   * and lists are not listed separately.
+   */
+  std::vector<Change> Changes() const;
+
+  /*!
+   * \brief Applies the edits to a document that is equal to the one the patch was made from.
+   * Returns false, and changes nothing, if an edit does not fit the document.
+   */
+  bool Apply(Editor& editor) const;
+
+private:
+  std::vector<uint8_t> bytes;
+
+  struct Differ;
+  struct Decoder;
+
+  bool Run(Editor* editor, std::vector<Change>* changes) const;
+};
+
+} // namespace ImNBT
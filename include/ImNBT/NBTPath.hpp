@@ -0,0 +1,205 @@
+#pragma once
+
+#include "NBTReader.hpp"
+#include "NBTRepresentation.hpp"
+
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ImNBT
+{
+
+enum class HashOrder
+{
+  // compound entries are hashed in the order they are stored
+  Stored,
+  // compound entries are hashed sorted by name, so compounds that differ only in the order of their entries hash equal
+  Canonical,
+};
+
+/*!
+ * \brief A handle to one tag of a document held by a Reader. Handles are cheap to copy and are valid until the reader's next import.
+ * A default constructed handle, or one returned by a failed lookup, is invalid and every lookup through it fails.
+ */
+class TagRef
+{
+public:
+  TagRef() = default;
+  TagRef(DataStore const* dataStore, DataTag const& tag) : dataStore(dataStore), tag(tag) {}
+
+  bool IsValid() const { return dataStore != nullptr; }
+  explicit operator bool() const { return IsValid(); }
+
+  TAG Type() const { return IsValid() ? tag.type : TAG::INVALID; }
+  /*!
+   * \brief Number of elements of a list or array, entries of a compound or bytes of a string. 0 for other tags.
+   */
+  int32_t Size() const;
+
+  /*!
+   * \brief Entry of a compound by name.
+   */
+  TagRef operator[](StringView name) const;
+  /*!
+   * \brief Element of a list by index.
+   */
+  TagRef operator[](int32_t index) const;
+
+  /*!
+   * \brief The value of a tag. T may be int8_t, int16_t, int32_t, int64_t, float, double or StringView.
+   * Returns nothing if the tag holds another type.
+   */
+  template<typename T>
+  Optional<T> As() const;
+
+  Optional<std::vector<int8_t>> AsByteArray() const;
+  Optional<std::vector<int32_t>> AsIntArray() const;
+  Optional<std::vector<int64_t>> AsLongArray() const;
+
+  /*!
+   * \brief 64 bit hash of the tag and everything it holds, equal for tags holding equal data in any document.
+   * Computing it visits the whole subtree, except for the compounds whose hashes an Editor cached, see Editor::Hash().
+   * Returns 0 for an invalid handle.
+   */
+  uint64_t Hash(HashOrder order = HashOrder::Stored) const;
+  /*!
+   * \brief True if both tags hold the same data, compared bit for bit, whatever documents they are in.
+   * The entries of compounds may be in any order. Compounds with cached hashes that differ are told apart without
+   * visiting their entries. Invalid handles only equal each other.
+   */
+  bool Equals(TagRef const& other) const;
+
+private:
+  DataStore const* dataStore = nullptr;
+  DataTag tag;
+
+  friend class Builder;
+  friend class Cursor;
+  friend class Patch;
+  friend class Path;
+};
+
+/*!
+ * \brief A path expression compiled once and evaluated against any number of documents.
+ *
+ * A path is a sequence of compound keys separated by '.' and list indices in brackets:
+ *
+ *    Level.Sections[3].BlockStates
+ *
+ * Keys containing '.', '[', ']' or '"' are written in double quotes, with \" and \\ escapes.
+ * Negative indices count from the end of the list. '*' as a key matches every entry of a compound
+ * and [*] matches every element of a list. An empty path refers to the root compound.
+ *
+ * Keys are hashed when compiling, and each key step remembers where its entry was last found,
+ * so evaluating the same path over documents of the same kind avoids the name search.
+ * Because of this, threads should evaluate copies of a Path rather than one shared instance.
+ */
+class Path
+{
+public:
+  static Optional<Path> Compile(StringView expression);
+
+  /*!
+   * \brief The first tag the path refers to, or an invalid handle if there is none.
+   */
+  TagRef Evaluate(Reader const& reader) const;
+  TagRef Evaluate(TagRef const& from) const;
+
+  /*!
+   * \brief Calls fn(TagRef const&) with every tag the path refers to, in document order.
+   * fn may return false to end the evaluation early.
+   */
+  template<typename Fn>
+  void ForEach(Reader const& reader, Fn&& fn) const;
+  template<typename Fn>
+  void ForEach(TagRef const& from, Fn&& fn) const;
+
+  std::vector<TagRef> All(Reader const& reader) const;
+
+private:
+  struct Step
+  {
+    enum class Kind
+    {
+      Key,
+      AnyKey,
+      Index,
+      AnyIndex,
+    } kind;
+    std::string key;
+    uint32_t keyHash = 0;
+    int32_t index = 0;
+    mutable size_t positionHint = 0;
+  };
+  std::vector<Step> steps;
+
+  TagRef Child(TagRef const& node, Step const& step) const;
+
+  template<typename Fn>
+  bool Walk(TagRef const& node, size_t step, Fn& fn) const;
+
+  friend class Editor;
+  friend class Patch;
+  friend class Reader;
+};
+
+template<typename Fn>
+void Path::ForEach(Reader const& reader, Fn&& fn) const
+{
+  ForEach(reader.Root(), std::forward<Fn>(fn));
+}
+
+template<typename Fn>
+void Path::ForEach(TagRef const& from, Fn&& fn) const
+{
+  if (from)
+    Walk(from, 0, fn);
+}
+
+template<typename Fn>
+bool Path::Walk(TagRef const& node, size_t step, Fn& fn) const
+{
+  if (step == steps.size())
+  {
+    if constexpr (std::is_void_v<std::invoke_result_t<Fn&, TagRef const&>>)
+    {
+      fn(node);
+      return true;
+    }
+    else
+    {
+      return fn(node);
+    }
+  }
+  Step const& current = steps[step];
+  if (current.kind == Step::Kind::AnyKey)
+  {
+    if (node.tag.type != TAG::Compound)
+      return true;
+    bool proceed = true;
+    node.dataStore->ForEachEntry(node.tag.payload.As<TagPayload::Compound>(), [&](StringView, DataTag const& entry) {
+      if (proceed)
+        proceed = Walk(TagRef{ node.dataStore, entry }, step + 1, fn);
+    });
+    return proceed;
+  }
+  if (current.kind == Step::Kind::AnyIndex)
+  {
+    if (node.tag.type != TAG::List)
+      return true;
+    TagPayload::List const& list = node.tag.payload.As<TagPayload::List>();
+    for (int32_t i = 0; i < list.count_; ++i)
+    {
+      if (!Walk(TagRef{ node.dataStore, node.dataStore->ListElement(list, i) }, step + 1, fn))
+        return false;
+    }
+    return true;
+  }
+  TagRef const child = Child(node, current);
+  return child ? Walk(child, step + 1, fn) : true;
+}
+
+} // namespace ImNBT
@@ -3,9 +3,12 @@
 #include "NBTBuilder.hpp"
 #include "NBTRepresentation.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ImNBT
@@ -14,6 +17,45 @@ namespace ImNBT
 template<typename T>
 using Optional = std::optional<T>;
 
+class Document;
+class OffsetIndex;
+class TagRef;
+
+namespace Internal
+{
+struct BindingAccess;
+} // namespace Internal
+
+/*!
+ * \brief Counters of Reader::GetDecodePlanStats().
+ * A hit is a named read resolved directly at the position that the same read had in an earlier compound of the same shape.
+ */
+struct DecodePlanStats
+{
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+/*!
+ * \brief One field of a list of compounds, extracted into contiguous storage by Reader::ExtractColumns().
+ * values holds one slot per list element. Elements that lack the field, or hold it with a different type,
+ * keep a default-constructed value and have their bit in the validity bitmap cleared.
+ * T may be int8_t, int16_t, int32_t, int64_t, float, double or StringView.
+ * StringViews point into the reader's storage and are valid until the next import.
+ */
+template<typename T>
+struct Column
+{
+  Column(StringView name) : name(name) {}
+
+  StringView name;
+  std::vector<T> values;
+  std::vector<uint64_t> validity;
+
+  size_t Size() const { return values.size(); }
+  bool Valid(size_t element) const { return (validity[element / 64] >> (element % 64)) & 1; }
+};
+
 class Reader : Builder
 {
 public:
@@ -30,6 +72,108 @@ public:
   bool ImportString(char const* data, uint32_t length);
   bool ImportBinary(uint8_t const* data, uint32_t length);
 
+  /*!
+   * \brief Imports only the given paths (see SetProjection()) of a binary file, gzip compressed or not.
+   * The file is inflated and parsed incrementally, and reading stops as soon as every path is resolved:
+   * when its tag has been read, or when the compound that would contain it has closed.
+   * Paths with wildcards are resolved when the container holding the wildcard closes.
+   */
+  bool ImportBinaryFileFields(StringView filepath, std::vector<StringView> const& paths);
+
+  /*!
+   * \brief Imports a single subtree of the file an OffsetIndex was built for, decoding only its bytes. See NBTIndex.hpp.
+   * A compound is imported as the root of the document. Other tags are imported as the only entry of an unnamed root,
+   * under their own name, or an empty name for list elements, which Root()[""] reaches.
+   */
+  bool ImportIndexedSubtree(OffsetIndex const& index, StringView path);
+
+  /*!
+   * \brief Imports a frozen image written by ExportFrozen(). An image is the reader's document as it is held in memory,
+   * so importing one copies its tables and pools without parsing, hashing names or swapping bytes.
+   * Images are rejected if they were written by another version of the format or on a host of the other byte order,
+   * if any of their tables refers outside of the image, or if any compound or list holds itself.
+   */
+  bool ImportFrozen(uint8_t const* data, size_t length);
+  /*!
+   * \brief Imports a frozen image from a file, which is mapped into memory rather than read.
+   * Values and names are not copied: the document reads them from the mapping, so only the pages of the values it reads are
+   * loaded, and the file stays mapped until the document and every copy of it are gone. Changing a value copies its pool.
+   * The tables of tags, compounds and list elements are still rebuilt, in one pass over them. The file must not be changed
+   * while it is mapped.
+   */
+  bool ImportFrozenFile(StringView filepath);
+
+  /*!
+   * \brief Writes the document of the last import as a frozen image, for importing quickly with ImportFrozen().
+   */
+  bool ExportFrozen(std::vector<uint8_t>& out);
+  bool ExportFrozenFile(StringView filepath);
+
+  /*!
+   * \brief Stores homogeneous lists of compounds column-wise in the following imports. See Builder::SetListShaping().
+   */
+  using Builder::SetListShaping;
+  /*!
+   * \brief Stores equal strings, arrays and compounds once in the following imports. See Builder::SetDeduplication().
+   * The stats count the last import.
+   */
+  using Builder::SetDeduplication;
+  using Builder::GetDeduplicationStats;
+
+  /*!
+   * \brief Makes the following binary imports lazy. Only the top-level entries of the root compound are indexed,
+   * by skipping over their payloads, as far as the first read needs. Each entry is decoded the first time a read names it.
+   * Reads that need the whole root, such as Names() and Count() on the root, decode everything that is left.
+   * In this mode, StringViews returned by reads are only valid until the next entry is decoded.
+   */
+  void SetLazyImport(bool enabled);
+
+  /*!
+   * \brief Keeps the bytes of the following binary imports with the document, and where each compound was read from.
+   * Binary exports of the document, or of edited copies of it, then copy every compound that was not changed as it was read,
+   * encoding only the changed parts again. Costs 16 bytes per compound and keeps the uncompressed input alive with the document.
+   * Compounds inside projected or lazily indexed parts of a document are re-encoded as usual. Disabled by default.
+   */
+  void SetSourcePassthrough(bool enabled);
+
+  /*!
+   * \brief Inflates compressed files written on several threads by Writer::ExportBinaryFile() on up to this many threads,
+   * or one per core if 0. Files compressed as a whole are inflated on the calling thread as usual. 1 by default.
+   */
+  void SetImportThreads(unsigned threads);
+
+  /*!
+   * \brief Restricts the following binary imports to the given paths (see Path for the syntax) and the compounds and lists leading to them.
+   * Everything else is skipped over by length without creating tags, names or pool entries.
+   * Lists keep all of their elements, so a specific index such as [3] selects the same as [*].
+   * Returns false and leaves the projection unchanged if a path does not compile. An empty set removes the projection.
+   */
+  bool SetProjection(std::vector<StringView> const& paths);
+
+  /*!
+   * \brief The reader learns the order in which named values are read from each compound shape it sees,
+   * and resolves reads from later compounds of the same shape by position instead of by search.
+   * Plans are kept across imports, so reading many documents of the same kind benefits too. At most 4096 shapes are planned,
+   * reads from compounds of the shapes seen after that are searched and count as misses.
+   */
+  DecodePlanStats GetDecodePlanStats() const;
+  void ResetDecodePlanStats();
+
+  /*!
+   * \brief Handle to the root compound of the last import, for use with Path. See NBTPath.hpp.
+   */
+  TagRef Root() const;
+  /*!
+   * \brief Handle to the compound or list the reader has open, for use with Path or Builder::WriteCopy().
+   */
+  TagRef Current() const;
+
+  /*!
+   * \brief Moves the document of the last import into an immutable Document that can be shared between threads,
+   * leaving the reader empty. Returns nullptr if nothing was imported. See NBTDocument.hpp.
+   */
+  std::shared_ptr<Document const> ReleaseDocument();
+
   /*!
    * \brief Opens a compound for reading. This means that all reads until CloseCompound() is called will be read from this compound.
    * Compounds are analogous to dictionaries/structs and contain named tags of any type.
@@ -206,11 +350,13 @@ public:
       }
       StringView operator*() const
       {
+        if (compoundView->schemaNames)
+          return (*compoundView->schemaNames)[ntiIndex];
         return compoundView->dataStore->namedTags[(*compoundView->namedTagIndices)[ntiIndex]].GetName();
       }
       bool operator!=(End const&) const
       {
-        return compoundView ? compoundView->namedTagIndices->size() != ntiIndex : true;
+        return compoundView ? compoundView->Size() != ntiIndex : true;
       }
       bool operator!=(NameProxy const& rhs) const
       {
@@ -229,23 +375,128 @@ public:
     NameProxy::End end() { return {}; }
   private:
     DataStore const* dataStore;
-    std::vector<Internal::NamedDataTagIndex> const* namedTagIndices;
+    std::vector<Internal::NamedDataTagIndex> const* namedTagIndices = nullptr;
+    // the elements of shaped lists keep their names in a shared schema
+    std::vector<std::string> const* schemaNames = nullptr;
     CompoundView(DataStore const* dataStore, std::vector<Internal::NamedDataTagIndex> const* namedTagIndices)
       : dataStore(dataStore)
       , namedTagIndices(namedTagIndices)
     {}
+    CompoundView(DataStore const* dataStore, std::vector<std::string> const* schemaNames)
+      : dataStore(dataStore)
+      , schemaNames(schemaNames)
+    {}
+
+    size_t Size() const { return schemaNames ? schemaNames->size() : namedTagIndices->size(); }
 
     friend NameProxy;
     friend CompoundView Reader::Names();
   };
+
+  class ListRange;
+
+  /*!
+   * \brief An iterable range over the compounds of a list.
+   * The list is opened once, and each step of the iteration points the reader at the next element directly from its pool slot,
+   * so reads inside the loop body go to the current element. Do not call OpenCompound()/CloseCompound() for the elements themselves.
+   * The list is closed again when the range is destroyed, including when the loop is left early.
+   * Usage:
+   *
+   *  for (int32_t i : Compounds("Entities"))
+   *  {
+   *    double x = ReadDouble("x");
+   *  }
+   *
+   * If the list does not exist or does not hold compounds, yields a range with no elements.
+   * \param name name of the list to iterate
+   */
+  ListRange Compounds(StringView name = "");
+  /*!
+   * \brief An iterable range over the lists of a list. Behaves exactly like Compounds(), but for lists of lists.
+   * Inside the loop body, the current element list is open for reading.
+   * \param name name of the list to iterate
+   */
+  ListRange Lists(StringView name = "");
+
+  /*!
+   * \brief Extracts fields of every compound in a list into one column per field, in a single pass over the list.
+   * Usage:
+   *
+   *  Column<double> x{ "x" }, y{ "y" };
+   *  Column<StringView> id{ "id" };
+   *  if (ExtractColumns("Entities", x, y, id))
+   *  {
+   *    for (size_t i = 0; i < x.Size(); ++i)
+   *      if (x.Valid(i) && y.Valid(i))
+   *        plot(x.values[i], y.values[i]);
+   *  }
+   *
+   * Elements are processed in blocks of 64, one validity word per column each, and no block writes to another's slots,
+   * so the work splits cleanly across elements.
+   * \param listName name of the list of compounds in the currently open container
+   * \return true if the list exists and holds compounds (or is empty), false otherwise
+   */
+  template<typename... Ts>
+  bool ExtractColumns(StringView listName, Column<Ts>&... columns);
+
+  class ListRange
+  {
+  public:
+    class Iterator
+    {
+    public:
+      int32_t operator*() const { return index; }
+      Iterator& operator++()
+      {
+        range->Seek(++index);
+        return *this;
+      }
+      bool operator!=(Iterator const& rhs) const { return index != rhs.index; }
+    private:
+      ListRange* range;
+      int32_t index;
+      friend ListRange;
+      Iterator(ListRange* range, int32_t index)
+        : range(range)
+        , index(index)
+      {}
+    };
+
+    Iterator begin() { return Iterator(this, 0); }
+    Iterator end() { return Iterator(this, count); }
+
+    ListRange(ListRange const&) = delete;
+    ListRange& operator=(ListRange const&) = delete;
+    ~ListRange();
+  private:
+    Reader* reader;
+    ContainerInfo* list = nullptr;
+    ContainerInfo* element = nullptr;
+    TAG elementType;
+    int32_t count = 0;
+    ListRange(Reader* reader, StringView name, TAG elementType);
+
+    void Seek(int32_t index);
+
+    friend Reader;
+  };
 private:
   class MemoryStream
   {
     size_t position = 0;
-    std::vector<uint8_t> data;
+    // held by a shared buffer, so documents can keep the bytes they were read from
+    std::shared_ptr<std::vector<uint8_t>> contents;
+    uint8_t const* data = nullptr;
+    size_t size = 0;
 
   public:
     void SetContents(std::vector<uint8_t>&& inData);
+    std::shared_ptr<std::vector<uint8_t> const> Share() const { return contents; }
+
+    uint8_t const* Data() const { return data; }
+    size_t Size() const { return size; }
+    size_t Position() const { return position; }
+    void Seek(size_t inPosition) { position = inPosition; }
 
     template<typename T>
     T Retrieve();
@@ -313,19 +564,73 @@ private:
 
   bool inVirtualRootCompound = false;
 
+  // a top-level entry of a lazy import, the name points into memoryStream
+  struct LazyEntry
+  {
+    StringView name;
+    uint32_t nameHash;
+    size_t offset;
+    bool materialized;
+    // the root entry decoded from it, none if a projection skipped it
+    Optional<uint64_t> tagIndex;
+  };
+  bool lazyImport = false;
+  bool lazyPending = false;
+  bool sourcePassthrough = false;
+  unsigned importThreads = 1;
+  std::vector<LazyEntry> lazyEntries;
+  size_t lazyScanPosition = 0;
+
+  // a node of the projection set with SetProjection(), the root is the first node
+  struct ProjectionNode
+  {
+    std::vector<std::pair<std::string, size_t>> children;
+    size_t anyKey = 0;
+    size_t anyIndex = 0;
+    bool whole = false;
+  };
+  std::vector<ProjectionNode> projection;
+  // node of the tag being parsed, npos while keeping everything
+  size_t projectionNode = std::numeric_limits<size_t>::max();
+
+  static Optional<std::vector<ProjectionNode>> BuildProjection(std::vector<StringView> const& paths);
+  static size_t ProjectedChild(std::vector<ProjectionNode> const& nodes, size_t node, TAG type, StringView name);
+
+  struct ExtractionVisitor;
+  bool SkipBinaryPayload(TAG type);
+
+  bool IndexNextEntry();
+  void Materialize(StringView name, uint32_t nameHash);
+  void MaterializeAll();
+  void DecodeLazyEntry(LazyEntry& entry);
+  // index in compoundStorage of the root compound's entries
+  uint64_t RootStorage() const;
+
+  // positions of the entries read from compounds of one shape, by read order
+  std::vector<std::vector<uint32_t>> decodePlans;
+  std::unordered_map<uint64_t, int32_t> decodePlanIndices;
+  DecodePlanStats decodePlanStats;
+
   void Clear();
 
+  // imports a frozen image, read in place if image owns it, see DataStore::Thaw()
+  bool ImportFrozen(uint8_t const* data, size_t length, std::shared_ptr<void const> image);
+
   bool ImportCompressedFile(StringView filepath);
   bool ImportUncompressedFile(StringView filepath);
 
   bool ParseTextStream();
   bool ParseBinaryStream();
 
+  // the type of the tag parsed, TAG::End at the end of a compound, or TAG::INVALID if it could not be parsed or skipped
   TAG ParseBinaryNamedTag();
+  // the entries of a compound up to its end tag, false if one could not be parsed or skipped
+  bool ParseBinaryEntries();
   bool ParseBinaryPayload(TAG type, StringView name = "");
 
   TAG RetrieveBinaryTag();
   std::string RetrieveBinaryStr();
+  StringView RetrieveBinaryStrView();
   int32_t RetrieveBinaryArrayLen();
 
   TAG ParseTextNamedTag();
@@ -335,13 +640,80 @@ private:
 
   bool OpenContainer(TAG t, StringView name);
 
+  Internal::EntryLocation LocateNamed(ContainerInfo& container, StringView name);
+
+  Internal::EntryLocation LocateEntry(StringView name, uint32_t nameHash, size_t& positionHint);
+  bool OpenEntry(Internal::EntryLocation const& entry);
+  void CloseEntry();
+  TAG ListElementType() const;
+
   template<typename T>
-  T& ReadValue(TAG t, StringView name);
+  bool ReadEntry(Internal::EntryLocation const& entry, T& value) const;
+
+  ContainerInfo ListElementContainer(ContainerInfo& list, TAG t, int32_t index);
+
+  template<typename T>
+  uint64_t ExtractColumnBlock(TagPayload::List const& list, int32_t begin, int32_t end, Column<T>& column) const;
+
+  template<typename T>
+  T const& ReadValue(TAG t, StringView name);
 
   template<typename T>
   Optional<T> MaybeReadValue(TAG t, StringView name);
 
   template<typename T, void(Builder::*WriteArray)(T const*, int32_t, StringView), char...> friend auto PackedIntegerList(Reader* reader, TAG tag, StringView name) -> TAG;
+  friend struct Internal::BindingAccess;
+  friend class Writer;
 };
 
+template<typename... Ts>
+bool Reader::ExtractColumns(StringView listName, Column<Ts>&... columns)
+{
+  if (!OpenList(listName))
+    return false;
+  ContainerInfo& list = containers.top();
+  int32_t const count = list.Count(dataStore);
+  if (count != 0 && list.ElementType(dataStore) != TAG::Compound)
+  {
+    CloseList();
+    return false;
+  }
+  TagPayload::List const payload = list.ListPayload(dataStore);
+  CloseList();
+
+  ((columns.values.assign(count, Ts{}), columns.validity.assign((count + 63) / 64, 0)), ...);
+  for (int32_t block = 0; block < count; block += 64)
+  {
+    int32_t const blockEnd = std::min(count, block + 64);
+    ((columns.validity[block / 64] = ExtractColumnBlock(payload, block, blockEnd, columns)), ...);
+  }
+  return true;
+}
+
+template<typename T>
+uint64_t Reader::ExtractColumnBlock(TagPayload::List const& list, int32_t begin, int32_t end, Column<T>& column) const
+{
+  using Traits = Internal::TagTraits<T>;
+  uint64_t valid = 0;
+  // compounds in one list usually share their layout, so start each lookup where the field was last found
+  size_t positionHint = 0;
+  for (int32_t i = begin; i < end; ++i)
+  {
+    Internal::EntryLocation const entry = dataStore.Locate(dataStore.ListCompound(list, i), column.name, positionHint);
+    if (entry.type != Traits::Tag)
+      continue;
+    auto const& payload = dataStore.Payload<typename Traits::Payload>(entry);
+    if constexpr (std::is_same_v<T, StringView>)
+    {
+      column.values[i] = StringView{ dataStore.Pool<char>().data() + payload.poolIndex_, payload.length_ };
+    }
+    else
+    {
+      column.values[i] = payload;
+    }
+    valid |= uint64_t{ 1 } << (i - begin);
+  }
+  return valid;
+}
+
 } // namespace ImNBT
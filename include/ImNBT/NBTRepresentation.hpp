@@ -1,7 +1,11 @@
 #pragma once
 
+#include "NBTStorage.hpp"
+
+#include <cassert>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -71,12 +75,16 @@ struct TagPayload
   struct List
   {
     TAG elementType_ = TAG::End;
+    // a shaped list of compounds keeps its elements column-wise, and poolIndex_ indexes DataStore::shapedLists
+    bool shaped_ = false;
     int32_t count_ = 0;
     size_t poolIndex_ = std::numeric_limits<size_t>::max();
   };
   struct Compound
   {
     size_t storageIndex_ = std::numeric_limits<size_t>::max();
+    // set for the elements of a shaped list, storageIndex_ then indexes DataStore::shapedLists
+    int32_t shapedRow_ = -1;
   };
 
   template<typename T>
@@ -115,10 +123,18 @@ class NamedDataTag
 {
 public:
   StringView GetName() const;
+  uint32_t GetNameHash() const { return nameHash; }
+  bool BorrowsName() const { return borrowedName != nullptr; }
   void SetName(StringView inName);
+  void SetName(StringView inName, uint32_t inNameHash);
+  // refers to the name rather than copying it, for names in memory the store holding the tag keeps alive
+  void BorrowName(StringView inName, uint32_t inNameHash);
 
 private:
   std::string name;
+  char const* borrowedName = nullptr;
+  uint32_t borrowedLength = 0;
+  uint32_t nameHash = 0;
 
 public:
   DataTag dataTag;
@@ -128,6 +144,70 @@ namespace Internal
 {
 bool IsContainer(TAG t);
 
+/**
+ * FNV-1a hash of a tag name. Names are hashed once when tags are created, so lookups compare integers before strings.
+ * Usable at compile time for names known up front.
+ */
+
+constexpr uint32_t HashName(StringView name)
+{
+  uint32_t hash = 2166136261u;
+  for (char c : name)
+  {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Maps the value types of the Read/Write API onto their tag type and the payload type that stores them
+ */
+
+template<typename T>
+struct TagTraits;
+
+template<> struct TagTraits<int8_t> { static constexpr TAG Tag = TAG::Byte; using Payload = byte; };
+template<> struct TagTraits<int16_t> { static constexpr TAG Tag = TAG::Short; using Payload = int16_t; };
+template<> struct TagTraits<int32_t> { static constexpr TAG Tag = TAG::Int; using Payload = int32_t; };
+template<> struct TagTraits<int64_t> { static constexpr TAG Tag = TAG::Long; using Payload = int64_t; };
+template<> struct TagTraits<float> { static constexpr TAG Tag = TAG::Float; using Payload = float; };
+template<> struct TagTraits<double> { static constexpr TAG Tag = TAG::Double; using Payload = double; };
+template<> struct TagTraits<StringView> { static constexpr TAG Tag = TAG::String; using Payload = TagPayload::String; };
+
+template<typename T>
+struct PayloadType
+{
+  using Type = T;
+};
+
+/**
+ * Calls fn with a PayloadType<T>, where T is the payload type that stores tags of the given type
+ */
+
+template<typename Fn>
+decltype(auto) WithPayloadType(TAG type, Fn&& fn)
+{
+  switch (type)
+  {
+    case TAG::Byte: return fn(PayloadType<byte>{});
+    case TAG::Short: return fn(PayloadType<int16_t>{});
+    case TAG::Int: return fn(PayloadType<int32_t>{});
+    case TAG::Long: return fn(PayloadType<int64_t>{});
+    case TAG::Float: return fn(PayloadType<float>{});
+    case TAG::Double: return fn(PayloadType<double>{});
+    case TAG::Byte_Array: return fn(PayloadType<TagPayload::ByteArray>{});
+    case TAG::String: return fn(PayloadType<TagPayload::String>{});
+    case TAG::List: return fn(PayloadType<TagPayload::List>{});
+    case TAG::Compound: return fn(PayloadType<TagPayload::Compound>{});
+    case TAG::Int_Array: return fn(PayloadType<TagPayload::IntArray>{});
+    case TAG::Long_Array: return fn(PayloadType<TagPayload::LongArray>{});
+    default:
+      assert(!"Internal Type Error - Tag type has no payload.");
+      return fn(PayloadType<byte>{});
+  }
+}
+
 struct NamedDataTagIndex
 {
   uint64_t idx;
@@ -139,42 +219,258 @@ struct NamedDataTagIndex
 };
 
 /**
- * Pools are the backing storage of lists/arrays
+ * Pools are the backing storage of lists/arrays. Copies of a set of pools share their buffers.
  */
 
 template<typename... Ts>
 struct Pools
 {
-  std::tuple<std::vector<Ts>...> pools;
+  std::tuple<SharedPool<Ts>...> pools;
 
   template<typename T>
-  std::vector<T>& Pool()
+  SharedPool<T>& Pool()
   {
-    return std::get<std::vector<T>>(pools);
+    return std::get<SharedPool<T>>(pools);
+  }
+
+  template<typename T>
+  SharedPool<T> const& Pool() const
+  {
+    return std::get<SharedPool<T>>(pools);
   }
 
   void Clear()
   {
-    (std::get<std::vector<Ts>>(pools).clear(), ...);
+    (std::get<SharedPool<Ts>>(pools).clear(), ...);
   }
 };
 
 using AllPools = Internal::Pools<ImNBT_ALL_TYPES>;
 
+/**
+ * The key set shared by every compound of a shaped list: the same names, with the same types, in the same order
+ */
+
+struct CompoundSchema
+{
+  std::vector<std::string> names;
+  std::vector<uint32_t> nameHashes;
+  std::vector<TAG> types;
+
+  size_t Find(StringView name, uint32_t nameHash, size_t& positionHint) const;
+};
+
+/**
+ * Where a payload is in the binary document a store was read from. Empty for payloads that were built or changed since.
+ */
+
+struct SourceRange
+{
+  size_t begin = 0;
+  size_t end = 0;
+
+  bool empty() const { return begin == end; }
+};
+
+/**
+ * Content hashes of a compound, with its entries in stored order and sorted by name. 0 until computed.
+ */
+struct ContentHashes
+{
+  uint64_t stored = 0;
+  uint64_t canonical = 0;
+};
+
+/**
+ * A homogeneous list of compounds stored column-wise.
+ * Field f of element i is stored at columns[f] + i in the pool of the field's payload type.
+ */
+
+struct ShapedList
+{
+  size_t schemaIndex;
+  std::vector<size_t> columns;
+  SourceRange source;
+  // hashes of the elements cached by Editor::Hash(), by row
+  std::vector<ContentHashes> rowHashes;
+};
+
+/**
+ * Where an entry of a compound is stored. type is End if the compound has no entry with the requested name.
+ */
+
+struct EntryLocation
+{
+  TAG type = TAG::End;
+  // index into namedTags, or the pool slot of the entry for elements of shaped lists
+  size_t index = 0;
+  bool shaped = false;
+};
+
 } // namespace Internal
 
+/**
+ * Copying a store is O(1): the copy shares the segments of its tables and the buffers of its pools, and changes to
+ * either store copy only the segments they touch. Pooled values shared with another store are relocated rather than changed.
+ */
+
 struct DataStore : Internal::AllPools
 {
   // sets of indices into namedTags
-  std::vector<std::vector<Internal::NamedDataTagIndex>> compoundStorage;
+  Internal::SegmentedVector<std::vector<Internal::NamedDataTagIndex>> compoundStorage;
+
+  Internal::SegmentedVector<NamedDataTag> namedTags;
+
+  Internal::SegmentedVector<Internal::CompoundSchema> schemas;
+  Internal::SegmentedVector<Internal::ShapedList> shapedLists;
+
+  /**
+   * The binary document the store was read from, kept if the reader was asked to, and where the payload of each compound
+   * is in it, indexed like compoundStorage. Binary exports copy unchanged compounds and shaped lists from it as they are.
+   */
+  std::shared_ptr<std::vector<uint8_t> const> sourceBytes;
+  Internal::SegmentedVector<Internal::SourceRange> compoundSources;
+
+  /**
+   * The frozen image a store was thawed from in place, which the names of its tags refer to. See Thaw().
+   */
+  std::shared_ptr<void const> frozenImage;
 
-  std::vector<NamedDataTag> namedTags;
+  // hashes cached by Editor::Hash(), indexed like compoundStorage. Shaped lists cache those of their elements
+  Internal::SegmentedVector<Internal::ContentHashes> compoundHashes;
+
+  /**
+   * Set for the compounds that deduplication made several tags refer to, indexed like compoundStorage.
+   * What they hold is reachable through each of those tags, so editors copy a shared compound before changing anything in it.
+   */
+  Internal::SegmentedVector<uint8_t> sharedCompounds;
+
+  // a Reader keeps int and long arrays in file byte order, a Writer in host byte order
+  bool bigEndianArrays = false;
 
   Internal::NamedDataTagIndex AddNamedDataTag(TAG type, StringView name);
 
+  size_t AddSchema(Internal::CompoundSchema&& schema);
+
+  /**
+   * Finds the entry of a compound with the given name. The search begins at positionHint, which is updated to where the entry was found.
+   */
+  Internal::EntryLocation Locate(TagPayload::Compound const& compound, StringView name, size_t& positionHint) const;
+  Internal::EntryLocation Locate(TagPayload::Compound const& compound, StringView name, uint32_t nameHash, size_t& positionHint) const;
+
+  template<typename T>
+  T const& Payload(Internal::EntryLocation const& entry) const
+  {
+    return entry.shaped ? Pool<T>()[entry.index] : namedTags[entry.index].dataTag.payload.As<T>();
+  }
+
+  size_t EntryCount(TagPayload::Compound const& compound) const;
+
+  /**
+   * Cheap summary of a compound's layout from its entry count and the names and types of its first and last entries.
+   * Compounds with the same keys in the same order share a fingerprint, but equal fingerprints do not guarantee equal layouts.
+   */
+  uint64_t ShapeFingerprint(TagPayload::Compound const& compound) const;
+
+  /**
+   * Calls fn(StringView name, DataTag const& tag) for each entry of a compound, in order
+   */
+  template<typename Fn>
+  void ForEachEntry(TagPayload::Compound const& compound, Fn&& fn) const;
+
+  /**
+   * The entries of a compound sorted by name
+   */
+  std::vector<std::pair<StringView, DataTag>> SortedEntries(TagPayload::Compound const& compound) const;
+
+  TagPayload::Compound ListCompound(TagPayload::List const& list, int32_t index) const;
+
+  DataTag ShapedEntry(Internal::ShapedList const& list, int32_t row, size_t field) const;
+
+  DataTag EntryTag(Internal::EntryLocation const& entry) const;
+
+  DataTag ListElement(TagPayload::List const& list, int32_t index) const;
+
+  /**
+   * The bytes of a compound, or of a shaped list, as they were read. Empty if there are none, or they changed since.
+   */
+  Internal::SourceRange Source(TagPayload::Compound const& compound) const;
+  Internal::SourceRange Source(TagPayload::List const& list) const;
+  void SetSource(TagPayload::Compound const& compound, Internal::SourceRange source);
+  /**
+   * Forgets the bytes a container was read from and its cached hashes, for a change to it or to anything it holds.
+   */
+  void MarkChanged(DataTag const& tag);
+
+  /**
+   * Hash of a tag and everything it holds, see TagRef::Hash(). Cached compound hashes are used, and the non-const overload
+   * caches the compound hashes it computes.
+   */
+  uint64_t ContentHash(DataTag const& tag, bool canonical) const;
+  uint64_t ContentHash(DataTag const& tag, bool canonical);
+  /**
+   * True if a tag holds the same data as a tag of another store, see TagRef::Equals().
+   * If ordered is set, the entries of compounds must also be in the same order.
+   */
+  bool ContentEquals(DataTag const& tag, DataStore const& other, DataTag const& otherTag, bool ordered = false) const;
+
+  bool IsShared(TagPayload::Compound const& compound) const;
+  void MarkShared(TagPayload::Compound const& compound);
+
+  /**
+   * Copies a tag of another store into this one, with the entries, elements and values it refers to, and returns the copy.
+   * Shaped lists stay shaped, and an element of a shaped list is copied as a regular compound.
+   * A shared compound found more than once in the tag is copied once, and the copy is shared.
+   */
+  DataTag CopyTag(DataStore const& source, DataTag const& tag);
+
+  /**
+   * Writes the store as a frozen image: a flat, position-independent copy of its tables and pools in host byte order,
+   * with every section 8 byte aligned, so an image can be mapped and handed to Thaw() without parsing.
+   */
+  void Freeze(std::vector<uint8_t>& out) const;
+  /**
+   * Replaces the contents of the store with a frozen image. Fails, leaving the store empty, if the image has another version
+   * or byte order, any table refers outside of the image, or any compound or list holds itself.
+   * The tables of tags, compounds and list elements are rebuilt from the image. Values and names are copied, unless image
+   * is given: the number and string pools then read the image in place and tags refer to their names in it, which keeps
+   * image alive for as long as the store or any copy of it does.
+   */
+  bool Thaw(uint8_t const* data, size_t length, std::shared_ptr<void const> image = nullptr);
+
+  /**
+   * Bytes of memory held by the store, counting the capacity of its tables and pools. Values and names read in place from
+   * a frozen image are not counted
+   */
+  size_t MemoryUsage() const;
+  /**
+   * Bytes of memory held by the store that it does not share with base, a copy of the store made before it was changed
+   */
+  size_t MemoryUsage(DataStore const& base) const;
+
   void Clear();
 };
 
+template<typename Fn>
+void DataStore::ForEachEntry(TagPayload::Compound const& compound, Fn&& fn) const
+{
+  if (compound.shapedRow_ >= 0)
+  {
+    Internal::ShapedList const& list = shapedLists[compound.storageIndex_];
+    Internal::CompoundSchema const& schema = schemas[list.schemaIndex];
+    for (size_t field = 0; field < schema.names.size(); ++field)
+    {
+      fn(StringView{ schema.names[field] }, ShapedEntry(list, compound.shapedRow_, field));
+    }
+    return;
+  }
+  for (Internal::NamedDataTagIndex tagIndex : compoundStorage[compound.storageIndex_])
+  {
+    NamedDataTag const& tag = namedTags[tagIndex];
+    fn(tag.GetName(), tag.dataTag);
+  }
+}
+
 #undef ImNBT_ALL_TYPES
 
 } // namespace ImNBT
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// copying shared storage is the rare path, kept out of line so the checks in front of it stay small
+#if defined(_MSC_VER)
+#define ImNBT_NOINLINE __declspec(noinline)
+#else
+#define ImNBT_NOINLINE __attribute__((noinline))
+#endif
+
+namespace ImNBT
+{
+
+namespace Internal
+{
+
+/*!
+ * \brief A reference counted value that copies share. Mutable() copies the value first if any other copy refers to it,
+ * so a shared value is never changed. Copies may be made and released from any thread.
+ */
+template<typename T>
+class Shared
+{
+public:
+  Shared() = default;
+  Shared(Shared const& other) : node(other.node)
+  {
+    if (node)
+      node->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  Shared(Shared&& other) noexcept : node(std::exchange(other.node, nullptr)) {}
+  Shared& operator=(Shared other) noexcept
+  {
+    std::swap(node, other.node);
+    return *this;
+  }
+  ~Shared()
+  {
+    if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete node;
+  }
+
+  template<typename... Args>
+  static Shared Make(Args&&... args)
+  {
+    Shared shared;
+    shared.node = new Node(std::forward<Args>(args)...);
+    return shared;
+  }
+
+  explicit operator bool() const { return node != nullptr; }
+  T const& operator*() const { return node->value; }
+  T const* operator->() const { return &node->value; }
+
+  // acquire, so the writes of copies released on other threads happen before those of the sole owner
+  bool Unique() const { return node->refs.load(std::memory_order_acquire) == 1; }
+  bool SameAs(Shared const& other) const { return node == other.node; }
+
+  T& Mutable()
+  {
+    if (!Unique())
+      Detach();
+    return node->value;
+  }
+
+  // the value, which the caller may change without copying it because changes cannot be observed by other copies
+  T& Unsafe() const { return node->value; }
+
+private:
+  ImNBT_NOINLINE void Detach() { *this = Make(node->value); }
+
+  struct Node
+  {
+    template<typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+    std::atomic<size_t> refs{ 1 };
+    T value;
+  };
+  Node* node = nullptr;
+};
+
+/*!
+ * \brief Contiguous storage of trivially copyable values that copies in O(1) by sharing one buffer.
+ *
+ * Holders of a buffer only ever read the elements below their own size. The buffer keeps the highest size any holder
+ * has reached (claimed), and the highest size any holder had when it was copied (sealed):
+ *  - a holder whose size is the claimed size appends in place by claiming more, every other holder reallocates
+ *  - elements at or above sealed are only visible to the holder that claimed them, so it may change them in place
+ * Changing an element below sealed copies the pool, unless the caller moves the range with Relocate() first.
+ * A pool made by Borrow() reads values it does not own, and copies them into a buffer of its own before any change.
+ */
+template<typename T>
+class SharedPool
+{
+  static_assert(std::is_trivially_copyable_v<T>, "pooled values are copied as bytes");
+
+public:
+  using value_type = T;
+
+  SharedPool() = default;
+
+  /*!
+   * \brief A pool of the count values at values, read in place. owner is kept alive for as long as any holder refers to them.
+   */
+  static SharedPool Borrow(T const* values, size_t count, std::shared_ptr<void const> owner)
+  {
+    SharedPool pool;
+    if (count > 0)
+    {
+      pool.buffer = Shared<Buffer>::Make(values, count, std::move(owner));
+      pool.count = count;
+    }
+    return pool;
+  }
+
+  SharedPool(SharedPool const& other) : buffer(other.buffer), count(other.count)
+  {
+    if (buffer)
+      Raise(buffer.Unsafe().sealed, count);
+  }
+  SharedPool(SharedPool&& other) noexcept : buffer(std::move(other.buffer)), count(std::exchange(other.count, 0)) {}
+  SharedPool& operator=(SharedPool const& other)
+  {
+    SharedPool copy(other);
+    return *this = std::move(copy);
+  }
+  SharedPool& operator=(SharedPool&& other) noexcept
+  {
+    buffer = std::move(other.buffer);
+    count = std::exchange(other.count, 0);
+    return *this;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  size_t capacity() const { return buffer ? buffer->capacity : 0; }
+  bool Borrowed() const { return buffer && buffer->owner; }
+
+  T const* data() const { return buffer ? buffer->elements : nullptr; }
+  T* data()
+  {
+    if (buffer && (buffer->owner || (!buffer.Unique() && buffer->sealed.load(std::memory_order_acquire) > 0)))
+      Reallocate(count, capacity());
+    return buffer ? buffer->elements : nullptr;
+  }
+  T const* begin() const { return data(); }
+  T const* end() const { return data() + count; }
+
+  T const& operator[](size_t index) const { return data()[index]; }
+  T& operator[](size_t index)
+  {
+    assert(index < count);
+    if (!Writable(index))
+      Reallocate(count, capacity());
+    return buffer->elements[index];
+  }
+
+  void reserve(size_t capacity)
+  {
+    if (capacity > this->capacity())
+      Reallocate(count, capacity);
+  }
+
+  void resize(size_t newCount)
+  {
+    size_t const oldCount = count;
+    Claim(newCount);
+    if (newCount > oldCount)
+      std::fill(buffer->elements + oldCount, buffer->elements + newCount, T{});
+  }
+
+  void push_back(T const& value)
+  {
+    Claim(count + 1);
+    buffer->elements[count - 1] = value;
+  }
+
+  template<typename It>
+  void append(It first, It last)
+  {
+    size_t const oldCount = count;
+    size_t const added = static_cast<size_t>(std::distance(first, last));
+    if (added == 0)
+      return;
+    Claim(oldCount + added);
+    using Source = typename std::iterator_traits<It>::value_type;
+    // values are only ever appended from their own type or, for bytes, from int8_t, so same sized values copy as bytes
+    if constexpr (std::is_pointer_v<It> && sizeof(Source) == sizeof(T) && std::is_trivially_copyable_v<Source>)
+      std::memcpy(buffer->elements + oldCount, first, added * sizeof(T));
+    else
+      std::copy(first, last, buffer->elements + oldCount);
+  }
+
+  template<typename It>
+  void assign(It first, It last)
+  {
+    clear();
+    append(first, last);
+  }
+
+  void clear()
+  {
+    if (buffer && buffer.Unique() && !buffer->owner)
+      Claim(0);
+    else
+      buffer = {};
+    count = 0;
+  }
+
+  /*!
+   * \brief Makes the elements [first, first + length) changeable without affecting other holders of the buffer.
+   * Returns first if they already are, otherwise the elements are copied to the end of the pool and their new position is returned.
+   */
+  size_t Relocate(size_t first, size_t length)
+  {
+    if (length == 0 || Writable(first))
+      return first;
+    return Duplicate(first, length);
+  }
+
+  /*!
+   * \brief Copies the elements [first, first + length) to the end of the pool and returns their new position.
+   */
+  size_t Duplicate(size_t first, size_t length)
+  {
+    size_t const moved = count;
+    Claim(count + length);
+    T* elements = buffer->elements;
+    std::memcpy(elements + moved, elements + first, length * sizeof(T));
+    return moved;
+  }
+
+  /*!
+   * \brief Bytes held by this pool that base does not hold. Borrowed values are held by their owner, and not counted.
+   */
+  size_t UnsharedBytes(SharedPool const& base) const
+  {
+    if (!buffer || buffer->owner)
+      return 0;
+    if (buffer.SameAs(base.buffer))
+      return count > base.count ? (count - base.count) * sizeof(T) : 0;
+    return buffer->capacity * sizeof(T);
+  }
+
+private:
+  struct Buffer
+  {
+    explicit Buffer(size_t capacity) : owned(new T[capacity]), elements(owned.get()), capacity(capacity) {}
+    // every borrowed element is sealed, so none is ever written
+    Buffer(T const* values, size_t count, std::shared_ptr<void const> owner)
+      : elements(const_cast<T*>(values)), capacity(count), owner(std::move(owner)), claimed(count), sealed(count)
+    {
+    }
+
+    std::unique_ptr<T[]> owned;
+    T* elements;
+    size_t capacity;
+    // set for borrowed elements, which are read only
+    std::shared_ptr<void const> owner;
+    std::atomic<size_t> claimed{ 0 };
+    std::atomic<size_t> sealed{ 0 };
+  };
+  Shared<Buffer> buffer;
+  size_t count = 0;
+
+  static void Raise(std::atomic<size_t>& value, size_t atLeast)
+  {
+    size_t current = value.load(std::memory_order_relaxed);
+    while (current < atLeast && !value.compare_exchange_weak(current, atLeast, std::memory_order_acq_rel))
+      ;
+  }
+
+  bool Writable(size_t index) const { return !buffer->owner && (buffer.Unique() || index >= buffer->sealed.load(std::memory_order_acquire)); }
+
+  // sets the size, reusing the buffer when no other holder can see the change
+  void Claim(size_t newCount)
+  {
+    if (buffer && newCount <= buffer->capacity)
+    {
+      if (buffer.Unique() && !buffer->owner)
+      {
+        buffer.Unsafe().claimed.store(newCount, std::memory_order_relaxed);
+        buffer.Unsafe().sealed.store(0, std::memory_order_relaxed);
+        count = newCount;
+        return;
+      }
+      if (newCount <= count)
+      {
+        count = newCount;
+        return;
+      }
+      size_t expected = count;
+      if (buffer.Unsafe().claimed.compare_exchange_strong(expected, newCount, std::memory_order_acq_rel))
+      {
+        count = newCount;
+        return;
+      }
+    }
+    Reallocate(std::min(count, newCount), std::max({ newCount, capacity() + capacity() / 2, size_t(16) }));
+    count = newCount;
+    buffer.Unsafe().claimed.store(newCount, std::memory_order_relaxed);
+  }
+
+  // moves the first kept elements into a buffer of its own
+  ImNBT_NOINLINE void Reallocate(size_t kept, size_t newCapacity)
+  {
+    Shared<Buffer> replacement = Shared<Buffer>::Make(newCapacity);
+    if (kept > 0)
+      std::memcpy(replacement.Unsafe().elements, buffer->elements, kept * sizeof(T));
+    replacement.Unsafe().claimed.store(count, std::memory_order_relaxed);
+    buffer = std::move(replacement);
+  }
+};
+
+/*!
+ * \brief A table of records stored in fixed size segments that copies in O(1) by sharing them.
+ * Changing a record copies the segment holding it, and the segment table, if they are shared.
+ */
+template<typename T>
+class SegmentedVector
+{
+  static constexpr size_t SegmentBits = 9;
+  static constexpr size_t SegmentSize = size_t(1) << SegmentBits;
+  static constexpr size_t SegmentMask = SegmentSize - 1;
+
+  using Segment = Shared<std::vector<T>>;
+
+public:
+  class const_iterator
+  {
+  public:
+    const_iterator(SegmentedVector const* records, size_t index) : records(records), index(index) {}
+    T const& operator*() const { return (*records)[index]; }
+    T const* operator->() const { return &(*records)[index]; }
+    const_iterator& operator++()
+    {
+      ++index;
+      return *this;
+    }
+    bool operator==(const_iterator const& other) const { return index == other.index; }
+    bool operator!=(const_iterator const& other) const { return index != other.index; }
+
+  private:
+    SegmentedVector const* records;
+    size_t index;
+  };
+
+  SegmentedVector() = default;
+  SegmentedVector(SegmentedVector const&) = default;
+  SegmentedVector(SegmentedVector&& other) noexcept : table(std::move(other.table)), count(std::exchange(other.count, 0)) {}
+  SegmentedVector& operator=(SegmentedVector const&) = default;
+  SegmentedVector& operator=(SegmentedVector&& other) noexcept
+  {
+    table = std::move(other.table);
+    count = std::exchange(other.count, 0);
+    return *this;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  size_t capacity() const
+  {
+    size_t capacity = 0;
+    if (table)
+    {
+      for (Segment const& segment : *table)
+        capacity += segment->capacity();
+    }
+    return capacity;
+  }
+
+  T const& operator[](size_t index) const { return (*(*table)[index >> SegmentBits])[index & SegmentMask]; }
+  T& operator[](size_t index) { return MutableSegment(index >> SegmentBits)[index & SegmentMask]; }
+
+  T const& front() const { return (*this)[0]; }
+  T const& back() const { return (*this)[count - 1]; }
+  T& front() { return (*this)[0]; }
+  T& back() { return (*this)[count - 1]; }
+
+  const_iterator begin() const { return { this, 0 }; }
+  const_iterator end() const { return { this, count }; }
+
+  void push_back(T value) { emplace_back(std::move(value)); }
+
+  template<typename... Args>
+  T& emplace_back(Args&&... args)
+  {
+    if (!table)
+      table = Shared<std::vector<Segment>>::Make();
+    size_t const segment = count >> SegmentBits;
+    // segments emptied by resize() are kept for reuse
+    if (segment == table->size())
+    {
+      // the first segment grows as a vector would, so that small tables stay small
+      table.Mutable().push_back(Segment::Make());
+      if (segment > 0)
+        MutableSegment(segment).reserve(SegmentSize);
+    }
+    T& record = MutableSegment(segment).emplace_back(std::forward<Args>(args)...);
+    ++count;
+    return record;
+  }
+
+  void resize(size_t newCount)
+  {
+    if (newCount < count)
+    {
+      std::vector<Segment>& segments = table.Mutable();
+      for (size_t segment = newCount >> SegmentBits; segment < (count + SegmentMask) >> SegmentBits; ++segment)
+      {
+        std::vector<T> const& records = *segments[segment];
+        size_t const kept = segment == newCount >> SegmentBits ? newCount & SegmentMask : 0;
+        if (segments[segment].Unique())
+          segments[segment].Unsafe().erase(records.begin() + kept, records.end());
+        else
+          segments[segment] = Segment::Make(records.begin(), records.begin() + kept);
+      }
+      count = newCount;
+    }
+    while (count < newCount)
+      emplace_back();
+  }
+
+  void clear()
+  {
+    table = {};
+    count = 0;
+  }
+
+  /*!
+   * \brief Bytes held by this table that base does not hold, counting the capacity of unshared segments.
+   */
+  size_t UnsharedBytes(SegmentedVector const& base) const
+  {
+    if (!table || table.SameAs(base.table))
+      return 0;
+    size_t bytes = table->capacity() * sizeof(Segment);
+    for (size_t segment = 0; segment < table->size(); ++segment)
+    {
+      if (!base.table || segment >= base.table->size() || !(*table)[segment].SameAs((*base.table)[segment]))
+        bytes += (*table)[segment]->capacity() * sizeof(T);
+    }
+    return bytes;
+  }
+
+private:
+  Shared<std::vector<Segment>> table;
+  size_t count = 0;
+
+  std::vector<T>& MutableSegment(size_t segment) { return table.Mutable()[segment].Mutable(); }
+};
+
+} // namespace Internal
+
+} // namespace ImNBT
+
+#undef ImNBT_NOINLINE
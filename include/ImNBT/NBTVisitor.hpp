@@ -0,0 +1,445 @@
+#pragma once
+
+#include "NBTRepresentation.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace ImNBT
+{
+
+/*!
+ * \brief Returned by visitor callbacks. Skip from BeginCompound()/BeginList() passes over the container
+ * without visiting its contents or calling the matching End callback, elsewhere it is the same as Continue.
+ * Stop ends the visit.
+ */
+enum class Visit
+{
+  Continue,
+  Skip,
+  Stop,
+};
+
+namespace Internal
+{
+
+template<typename T>
+T LoadBigEndian(uint8_t const* bytes)
+{
+  using Bits = std::conditional_t<sizeof(T) == 1, uint8_t, std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+  Bits bits;
+  std::memcpy(&bits, bytes, sizeof(T));
+  // compilers turn this into a single byte swap instruction
+  if constexpr (sizeof(T) == 2)
+    bits = static_cast<Bits>((bits >> 8) | (bits << 8));
+  if constexpr (sizeof(T) == 4)
+  {
+    bits = ((bits << 8) & 0xFF00FF00u) | ((bits >> 8) & 0x00FF00FFu);
+    bits = (bits << 16) | (bits >> 16);
+  }
+  if constexpr (sizeof(T) == 8)
+  {
+    bits = ((bits << 8) & 0xFF00FF00FF00FF00ull) | ((bits >> 8) & 0x00FF00FF00FF00FFull);
+    bits = ((bits << 16) & 0xFFFF0000FFFF0000ull) | ((bits >> 16) & 0x0000FFFF0000FFFFull);
+    bits = (bits << 32) | (bits >> 32);
+  }
+  T value;
+  std::memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+} // namespace Internal
+
+/*!
+ * \brief A view of a big endian array in the input, converting elements as they are accessed.
+ */
+template<typename T>
+struct ArrayView
+{
+  uint8_t const* data = nullptr;
+  int32_t count = 0;
+
+  int32_t Size() const { return count; }
+  T operator[](int32_t index) const { return Internal::LoadBigEndian<T>(data + index * sizeof(T)); }
+
+  void CopyTo(T* out) const
+  {
+    for (int32_t i = 0; i < count; ++i)
+      out[i] = (*this)[i];
+  }
+};
+
+/*!
+ * \brief Base for visitors passed to VisitBinary(). Every callback does nothing and continues,
+ * so a visitor declares only the callbacks it cares about, with the same signatures.
+ * Names are empty for list elements. All views point into the input and are only valid during the callback.
+ */
+struct VisitorBase
+{
+  Visit BeginCompound(StringView /*name*/) { return Visit::Continue; }
+  Visit EndCompound() { return Visit::Continue; }
+  Visit BeginList(StringView /*name*/, TAG /*elementType*/, int32_t /*count*/) { return Visit::Continue; }
+  Visit EndList() { return Visit::Continue; }
+
+  Visit Byte(StringView /*name*/, int8_t /*value*/) { return Visit::Continue; }
+  Visit Short(StringView /*name*/, int16_t /*value*/) { return Visit::Continue; }
+  Visit Int(StringView /*name*/, int32_t /*value*/) { return Visit::Continue; }
+  Visit Long(StringView /*name*/, int64_t /*value*/) { return Visit::Continue; }
+  Visit Float(StringView /*name*/, float /*value*/) { return Visit::Continue; }
+  Visit Double(StringView /*name*/, double /*value*/) { return Visit::Continue; }
+  Visit String(StringView /*name*/, StringView /*value*/) { return Visit::Continue; }
+
+  Visit ByteArray(StringView /*name*/, ArrayView<int8_t> /*value*/) { return Visit::Continue; }
+  Visit IntArray(StringView /*name*/, ArrayView<int32_t> /*value*/) { return Visit::Continue; }
+  Visit LongArray(StringView /*name*/, ArrayView<int64_t> /*value*/) { return Visit::Continue; }
+};
+
+/*!
+ * \brief Binary input held in memory.
+ *
+ * Sources give the visitor a window of upcoming bytes with Peek(), which returns nullptr when fewer than
+ * count bytes remain, consume them with Advance(), and pass over bytes nobody will look at with Skip().
+ */
+class MemorySource
+{
+public:
+  MemorySource(uint8_t const* data, size_t length) : data(data), length(length) {}
+
+  uint8_t const* Peek(size_t count) const { return count <= length - position ? data + position : nullptr; }
+  void Advance(size_t count) { position += count; }
+  bool Skip(size_t count)
+  {
+    if (count > length - position)
+      return false;
+    position += count;
+    return true;
+  }
+  size_t Position() const { return position; }
+
+private:
+  uint8_t const* data;
+  size_t length;
+  size_t position = 0;
+};
+
+/*!
+ * \brief Binary input read incrementally from a file, gzip compressed or not.
+ * Only the bytes of the tag being visited are held in memory.
+ */
+class FileSource
+{
+public:
+  FileSource(StringView filepath);
+  ~FileSource();
+  FileSource(FileSource const&) = delete;
+  FileSource& operator=(FileSource const&) = delete;
+
+  bool IsOpen() const { return file != nullptr; }
+
+  uint8_t const* Peek(size_t count);
+  void Advance(size_t count) { begin += count; }
+  bool Skip(size_t count);
+  size_t Position() const { return consumed + begin; }
+
+private:
+  void* file = nullptr;
+  std::vector<uint8_t> buffer;
+  size_t begin = 0;
+  size_t end = 0;
+  // bytes discarded from the front of the buffer so far
+  size_t consumed = 0;
+
+  bool Fill(size_t count);
+};
+
+namespace Internal
+{
+
+constexpr int MaxNestingDepth = 512;
+
+constexpr size_t FixedPayloadSize(TAG type)
+{
+  switch (type)
+  {
+    case TAG::Byte: return 1;
+    case TAG::Short: return 2;
+    case TAG::Int: case TAG::Float: return 4;
+    case TAG::Long: case TAG::Double: return 8;
+    default: return 0;
+  }
+}
+
+/**
+ * Passes over the payload of a tag of the given type using only the lengths stored in it
+ */
+template<typename Source>
+bool SkipBinaryPayload(Source& source, TAG type, int depth = 0)
+{
+  if (depth > MaxNestingDepth)
+    return false;
+  if (size_t const size = FixedPayloadSize(type))
+    return source.Skip(size);
+  switch (type)
+  {
+    case TAG::String:
+    {
+      uint8_t const* header = source.Peek(2);
+      if (!header)
+        return false;
+      uint16_t const length = LoadBigEndian<uint16_t>(header);
+      source.Advance(2);
+      return source.Skip(length);
+    }
+    case TAG::Byte_Array:
+    case TAG::Int_Array:
+    case TAG::Long_Array:
+    {
+      uint8_t const* header = source.Peek(4);
+      if (!header)
+        return false;
+      int32_t const count = LoadBigEndian<int32_t>(header);
+      if (count < 0)
+        return false;
+      source.Advance(4);
+      size_t const elementSize = type == TAG::Byte_Array ? 1 : type == TAG::Int_Array ? 4 : 8;
+      return source.Skip(count * elementSize);
+    }
+    case TAG::List:
+    {
+      uint8_t const* header = source.Peek(5);
+      if (!header)
+        return false;
+      TAG const elementType = static_cast<TAG>(header[0]);
+      int32_t const count = LoadBigEndian<int32_t>(header + 1);
+      if (count < 0)
+        return false;
+      source.Advance(5);
+      if (size_t const size = FixedPayloadSize(elementType))
+        return source.Skip(count * size);
+      for (int32_t i = 0; i < count; ++i)
+      {
+        if (!SkipBinaryPayload(source, elementType, depth + 1))
+          return false;
+      }
+      return true;
+    }
+    case TAG::Compound:
+    {
+      while (true)
+      {
+        uint8_t const* header = source.Peek(1);
+        if (!header)
+          return false;
+        TAG const entryType = static_cast<TAG>(header[0]);
+        if (entryType == TAG::End)
+        {
+          source.Advance(1);
+          return true;
+        }
+        header = source.Peek(3);
+        if (!header)
+          return false;
+        uint16_t const nameLength = LoadBigEndian<uint16_t>(header + 1);
+        source.Advance(3);
+        if (!source.Skip(nameLength) || !SkipBinaryPayload(source, entryType, depth + 1))
+          return false;
+      }
+    }
+    default:
+      return false;
+  }
+}
+
+/**
+ * Drives a visitor over binary NBT. Each tag is peeked as one window holding its header, name and
+ * payload (or the header of a container), so the name and value views stay valid for the callback.
+ */
+template<typename Source, typename Visitor>
+class BinaryVisit
+{
+public:
+  BinaryVisit(Source& source, Visitor& visitor) : source(source), visitor(visitor) {}
+
+  bool Run()
+  {
+    uint8_t const* header = source.Peek(3);
+    if (!header || static_cast<TAG>(header[0]) != TAG::Compound)
+      return false;
+    uint16_t const nameLength = LoadBigEndian<uint16_t>(header + 1);
+    Value(TAG::Compound, nameLength, 3 + size_t(nameLength), 0);
+    return !malformed;
+  }
+
+private:
+  Source& source;
+  Visitor& visitor;
+  bool malformed = false;
+
+  bool Fail()
+  {
+    malformed = true;
+    return false;
+  }
+
+  // the name ends where the payload begins, at prefix
+  static StringView Name(uint8_t const* window, size_t nameLength, size_t prefix)
+  {
+    return { reinterpret_cast<char const*>(window + prefix - nameLength), nameLength };
+  }
+
+  template<typename T, typename Callback>
+  bool Fixed(uint16_t nameLength, size_t prefix, Callback callback)
+  {
+    uint8_t const* window = source.Peek(prefix + sizeof(T));
+    if (!window)
+      return Fail();
+    Visit const visit = callback(Name(window, nameLength, prefix), LoadBigEndian<T>(window + prefix));
+    source.Advance(prefix + sizeof(T));
+    return visit != Visit::Stop;
+  }
+
+  template<typename T, typename Callback>
+  bool Array(uint16_t nameLength, size_t prefix, Callback callback)
+  {
+    uint8_t const* window = source.Peek(prefix + 4);
+    if (!window)
+      return Fail();
+    int32_t const count = LoadBigEndian<int32_t>(window + prefix);
+    if (count < 0)
+      return Fail();
+    size_t const size = prefix + 4 + count * sizeof(T);
+    window = source.Peek(size);
+    if (!window)
+      return Fail();
+    Visit const visit = callback(Name(window, nameLength, prefix), ArrayView<T>{ window + prefix + 4, count });
+    source.Advance(size);
+    return visit != Visit::Stop;
+  }
+
+  // visits a tag whose name (nameLength bytes) and header (prefix bytes including the name) have not been consumed yet
+  bool Value(TAG type, uint16_t nameLength, size_t prefix, int depth)
+  {
+    switch (type)
+    {
+      case TAG::Byte: return Fixed<int8_t>(nameLength, prefix, [this](StringView n, int8_t v) { return visitor.Byte(n, v); });
+      case TAG::Short: return Fixed<int16_t>(nameLength, prefix, [this](StringView n, int16_t v) { return visitor.Short(n, v); });
+      case TAG::Int: return Fixed<int32_t>(nameLength, prefix, [this](StringView n, int32_t v) { return visitor.Int(n, v); });
+      case TAG::Long: return Fixed<int64_t>(nameLength, prefix, [this](StringView n, int64_t v) { return visitor.Long(n, v); });
+      case TAG::Float: return Fixed<float>(nameLength, prefix, [this](StringView n, float v) { return visitor.Float(n, v); });
+      case TAG::Double: return Fixed<double>(nameLength, prefix, [this](StringView n, double v) { return visitor.Double(n, v); });
+      case TAG::Byte_Array: return Array<int8_t>(nameLength, prefix, [this](StringView n, ArrayView<int8_t> v) { return visitor.ByteArray(n, v); });
+      case TAG::Int_Array: return Array<int32_t>(nameLength, prefix, [this](StringView n, ArrayView<int32_t> v) { return visitor.IntArray(n, v); });
+      case TAG::Long_Array: return Array<int64_t>(nameLength, prefix, [this](StringView n, ArrayView<int64_t> v) { return visitor.LongArray(n, v); });
+      case TAG::String:
+      {
+        uint8_t const* window = source.Peek(prefix + 2);
+        if (!window)
+          return Fail();
+        size_t const size = prefix + 2 + LoadBigEndian<uint16_t>(window + prefix);
+        window = source.Peek(size);
+        if (!window)
+          return Fail();
+        Visit const visit = visitor.String(Name(window, nameLength, prefix), StringView{ reinterpret_cast<char const*>(window + prefix + 2), size - prefix - 2 });
+        source.Advance(size);
+        return visit != Visit::Stop;
+      }
+      case TAG::List:
+      {
+        if (depth > MaxNestingDepth)
+          return Fail();
+        uint8_t const* window = source.Peek(prefix + 5);
+        if (!window)
+          return Fail();
+        TAG const elementType = static_cast<TAG>(window[prefix]);
+        int32_t const count = LoadBigEndian<int32_t>(window + prefix + 1);
+        if (count < 0)
+          return Fail();
+        Visit const visit = visitor.BeginList(Name(window, nameLength, prefix), elementType, count);
+        source.Advance(prefix + 5);
+        if (visit == Visit::Stop)
+          return false;
+        if (visit == Visit::Skip)
+        {
+          if (size_t const size = FixedPayloadSize(elementType))
+            return source.Skip(count * size) || Fail();
+          for (int32_t i = 0; i < count; ++i)
+          {
+            if (!SkipBinaryPayload(source, elementType, depth + 1))
+              return Fail();
+          }
+          return true;
+        }
+        for (int32_t i = 0; i < count; ++i)
+        {
+          if (!Value(elementType, 0, 0, depth + 1))
+            return false;
+        }
+        return visitor.EndList() != Visit::Stop;
+      }
+      case TAG::Compound:
+      {
+        if (depth > MaxNestingDepth)
+          return Fail();
+        uint8_t const* window = source.Peek(prefix);
+        if (!window)
+          return Fail();
+        Visit const visit = visitor.BeginCompound(Name(window, nameLength, prefix));
+        source.Advance(prefix);
+        if (visit == Visit::Stop)
+          return false;
+        if (visit == Visit::Skip)
+          return SkipBinaryPayload(source, TAG::Compound, depth) || Fail();
+        while (true)
+        {
+          uint8_t const* header = source.Peek(1);
+          if (!header)
+            return Fail();
+          TAG const entryType = static_cast<TAG>(header[0]);
+          if (entryType == TAG::End)
+          {
+            source.Advance(1);
+            break;
+          }
+          header = source.Peek(3);
+          if (!header)
+            return Fail();
+          uint16_t const entryNameLength = LoadBigEndian<uint16_t>(header + 1);
+          if (!Value(entryType, entryNameLength, 3 + size_t(entryNameLength), depth + 1))
+            return false;
+        }
+        return visitor.EndCompound() != Visit::Stop;
+      }
+      default:
+        return Fail();
+    }
+  }
+};
+
+} // namespace Internal
+
+/*!
+ * \brief Visits uncompressed binary NBT without building a document, calling the visitor's callbacks in document order.
+ * Returns false if the input is malformed or truncated. A visit ended with Visit::Stop still returns true.
+ */
+template<typename Visitor>
+bool VisitBinary(uint8_t const* data, size_t length, Visitor& visitor)
+{
+  MemorySource source{ data, length };
+  return Internal::BinaryVisit<MemorySource, Visitor>{ source, visitor }.Run();
+}
+
+/*!
+ * \brief Visits a binary NBT file, gzip compressed or not, reading it incrementally.
+ */
+template<typename Visitor>
+bool VisitBinaryFile(StringView filepath, Visitor& visitor)
+{
+  FileSource source{ filepath };
+  if (!source.IsOpen())
+    return false;
+  return Internal::BinaryVisit<FileSource, Visitor>{ source, visitor }.Run();
+}
+
+} // namespace ImNBT
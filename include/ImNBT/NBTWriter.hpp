@@ -1,9 +1,11 @@
 #pragma once
 
 #include "NBTBuilder.hpp"
+#include "NBTDocument.hpp"
 #include "NBTRepresentation.hpp"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace ImNBT
@@ -19,6 +21,15 @@ public:
   };
 
   Writer();
+  /*!
+   * \brief A finalized writer holding a parsed or edited document, for exporting it. The document is shared, not copied.
+   */
+  explicit Writer(DocumentPtr document);
+  /*!
+   * \brief A finalized writer holding the document of a reader's last import, for exporting it again or in the other format.
+   * The document is shared, not copied, and the reader can go on reading it. Lazily imported entries are decoded first.
+   */
+  explicit Writer(Reader& reader);
   ~Writer();
 
   /*!
@@ -39,20 +50,98 @@ public:
   bool ExportString(std::string& out, PrettyPrint prettyPrint = PrettyPrint::Disabled);
   bool ExportBinary(std::vector<uint8_t>& out);
 
+  /*!
+   * \brief Exports the entries of every compound sorted by name, rather than in the order they were written,
+   * so documents holding equal data export to identical bytes and text. Disabled by default.
+   */
+  void SetCanonicalOrder(bool enabled) { canonicalOrder = enabled; }
+
+  /*!
+   * \brief Encodes binary exports of large documents on up to this many threads, or one per core if 0.
+   * The size of each part of the document is computed first, so its large compounds and list elements can be encoded
+   * in place in the output, concurrently. Documents of less than a few megabytes are always encoded on the calling thread,
+   * and the output is the same however many threads encode it.
+   *
+   * ExportBinaryFile() also compresses documents of more than a megabyte on these threads, as a gzip stream of members
+   * of a megabyte each, which any gzip reader inflates as one. Readers set to several threads inflate them concurrently,
+   * see Reader::SetImportThreads(). The file is a little larger than one compressed as a whole. 1 by default.
+   */
+  void SetExportThreads(unsigned threads) { exportThreads = threads; }
+
 private:
-  void OutputBinaryTag(std::vector<uint8_t>& out, NamedDataTag const& tag);
-  void OutputBinaryStr(std::vector<uint8_t>& out, StringView str);
-  void OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag);
+  template<typename Out>
+  void OutputBinaryTag(Out& out, NamedDataTag const& tag) const;
+  template<typename Out>
+  void OutputBinaryTag(Out& out, StringView name, DataTag const& tag) const;
+  template<typename Out>
+  void OutputBinaryStr(Out& out, StringView str) const;
+  template<typename Out>
+  void OutputBinaryPayload(Out& out, DataTag const& tag) const;
+  template<typename Out>
+  void OutputBinaryContents(Out& out, DataTag const& tag) const;
+
+  // the encoded size of a payload, as OutputBinaryPayload() writes it
+  size_t BinaryPayloadSize(DataTag const& tag) const;
 
-  void OutputTextTag(std::ostream& out, NamedDataTag const& tag);
-  void OutputTextStr(std::ostream& out, StringView str);
-  void OutputTextPayload(std::ostream& out, DataTag const& tag);
+  // a parallel export: the parts of the output that are encoded concurrently, and the bytes between them
+  struct BinaryPlan
+  {
+    // a run of entries of a compound, written with their type and name, or of elements of a list
+    struct Task
+    {
+      size_t offset;
+      size_t size;
+      bool named;
+      std::vector<std::pair<StringView, DataTag>> tags;
+    };
+    size_t grain = 0;
+    size_t size = 0;
+    std::vector<Task> tasks;
+    // types, names, list headers and compound ends, and where they are placed
+    std::vector<uint8_t> frames;
+    std::vector<std::pair<size_t, Internal::SourceRange>> framePlacements;
+
+    // appends the bytes write(std::vector<uint8_t>&) writes to the frames, at the end of the plan
+    template<typename Fn>
+    void Frame(Fn&& write);
+  };
+  bool ExportBinaryParallel(std::vector<uint8_t>& out, unsigned threads) const;
+  // plans the contents of a container, splitting those of its entries or elements larger than the grain in turn
+  void PlanBinaryContents(BinaryPlan& plan, DataTag const& tag) const;
+  void PlanBinaryChild(BinaryPlan& plan, bool named, StringView name, DataTag const& tag) const;
+
+  void OutputTextTag(std::ostream& out, NamedDataTag const& tag) const;
+  void OutputTextTag(std::ostream& out, StringView name, DataTag const& tag) const;
+  void OutputTextStr(std::ostream& out, StringView str) const;
+  void OutputTextPayload(std::ostream& out, DataTag const& tag) const;
+
+  // calls fn(StringView name, DataTag const& tag) for each entry of a compound, in the order they are exported
+  template<typename Fn>
+  void ForEachEntry(TagPayload::Compound const& compound, Fn&& fn) const;
+
+  bool canonicalOrder = false;
+  unsigned exportThreads = 1;
 
-  struct TextOutputState
+  mutable struct TextOutputState
   {
     int depth = 0;
     PrettyPrint prettyPrint;
   } textOutputState {};
+
+  // where containers ended up in the output, noted for Editor::ExportBinary(): the root and its entries,
+  // and deeper compounds and shaped lists of at least threshold bytes. Indices are storage indices and shaped list indices
+  struct EncodedRanges
+  {
+    size_t threshold = 0;
+    int depth = 0;
+    std::vector<std::pair<size_t, Internal::SourceRange>> compounds;
+    std::vector<std::pair<size_t, Internal::SourceRange>> shapedLists;
+    // ranges of the source bytes copied as they were, and where each copy begins in the output
+    std::vector<std::pair<Internal::SourceRange, size_t>> copies;
+  };
+  mutable EncodedRanges* encodedRanges = nullptr;
+
+  friend class Editor;
 };
 
 } // namespace ImNBT
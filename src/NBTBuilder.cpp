@@ -1,6 +1,8 @@
 #include <ImNBT/NBTBuilder.hpp>
+#include <ImNBT/NBTPath.hpp>
 
 #include <cassert>
+#include <utility>
 
 namespace ImNBT
 {
@@ -21,11 +23,13 @@ void Builder::EndCompound()
     auto& pool = dataStore.Pool<TagPayload::Compound>();
     int64_t const currentSize = static_cast<int64_t>(pool.size());
     auto& tempPool = container.temporaryContainer->data.Pool<TagPayload::Compound>();
-    pool.insert(pool.end(), tempPool.begin(), tempPool.end());
+    pool.append(tempPool.begin(), tempPool.end());
     container.PoolIndex(dataStore) = currentSize;
     assert(container.temporaryContainer == &temporaryContainers.top());
     temporaryContainers.pop();
   }
+  if (deduplication && containers.size() > 1)
+    DeduplicateCompound(container);
   TagPayload::Compound compound{ container.Storage(dataStore)};
   containers.pop();
   if (containers.empty())
@@ -55,21 +59,25 @@ void Builder::EndList()
       auto& pool = dataStore.Pool<TagPayload::List>();
       currentSize = static_cast<int64_t>(pool.size());
       auto& tempPool = container.temporaryContainer->data.Pool<TagPayload::List>();
-      pool.insert(pool.end(), tempPool.begin(), tempPool.end());
+      pool.append(tempPool.begin(), tempPool.end());
 
     }
+    else if (container.ElementType(dataStore) == TAG::Compound && ShapeList(container))
+    {
+      currentSize = static_cast<int64_t>(dataStore.shapedLists.size() - 1);
+    }
     else if (container.ElementType(dataStore) == TAG::Compound)
     {
       auto& pool = dataStore.Pool<TagPayload::Compound>();
       currentSize = static_cast<int64_t>(pool.size());
       auto& tempPool = container.temporaryContainer->data.Pool<TagPayload::Compound>();
-      pool.insert(pool.end(), tempPool.begin(), tempPool.end());
+      pool.append(tempPool.begin(), tempPool.end());
     }
     container.PoolIndex(dataStore) = currentSize;
     assert(container.temporaryContainer == &temporaryContainers.top());
     temporaryContainers.pop();
   }
-  TagPayload::List list{ container.ElementType(dataStore), container.Count(dataStore), container.PoolIndex(dataStore) };
+  TagPayload::List list = container.ListPayload(dataStore);
   containers.pop();
   ContainerInfo& parentContainer = containers.top();
   if (parentContainer.temporaryContainer)
@@ -78,6 +86,103 @@ void Builder::EndList()
   }
 }
 
+void Builder::SetDeduplication(bool enabled)
+{
+  deduplication = enabled;
+}
+
+DeduplicationStats Builder::GetDeduplicationStats() const
+{
+  return deduplicationStats;
+}
+
+DataTag const* Builder::FindDuplicate(uint64_t hash, DataTag const& tag)
+{
+  auto const [first, last] = deduplicatedByHash.equal_range(hash);
+  for (auto candidate = first; candidate != last; ++candidate)
+  {
+    // candidates of released compounds may have been replaced by other tags, which are compared all the same
+    if (candidate->second < deduplicated.size() && dataStore.ContentEquals(tag, dataStore, deduplicated[candidate->second], true))
+      return &deduplicated[candidate->second];
+  }
+  deduplicatedByHash.emplace(hash, deduplicated.size());
+  deduplicated.push_back(tag);
+  return nullptr;
+}
+
+template<typename Value, typename T>
+T Builder::Deduplicate(TAG type, T payload, size_t length)
+{
+  DataTag tag{ type };
+  tag.payload.Set(payload);
+  DataTag const* duplicate = FindDuplicate(std::as_const(dataStore).ContentHash(tag, false), tag);
+  if (!duplicate)
+    return payload;
+  dataStore.Pool<Value>().resize(payload.poolIndex_);
+  ++(type == TAG::String ? deduplicationStats.strings : deduplicationStats.arrays);
+  deduplicationStats.bytesSaved += length * sizeof(Value);
+  return duplicate->payload.As<T>();
+}
+
+void Builder::PushDeduplicationMark()
+{
+  DeduplicationMark mark;
+  std::apply([&](auto const&... pools) {
+    size_t pool = 0;
+    ((mark.pools[pool++] = pools.size()), ...);
+  }, dataStore.pools);
+  mark.shapedLists = dataStore.shapedLists.size();
+  mark.deduplicated = deduplicated.size();
+  mark.stats = deduplicationStats;
+  deduplicationMarks.push_back(mark);
+}
+
+void Builder::DeduplicateCompound(ContainerInfo& container)
+{
+  DeduplicationMark const mark = deduplicationMarks.back();
+  deduplicationMarks.pop_back();
+  size_t const storage = container.storageMark - 1;
+  DataTag tag{ TAG::Compound };
+  tag.payload.Set(TagPayload::Compound{ storage });
+  // nested compounds cached their hash as they ended, so this only hashes the entries of this one
+  DataTag const* duplicate = FindDuplicate(dataStore.ContentHash(tag, false), tag);
+  if (!duplicate)
+    return;
+  TagPayload::Compound const shared = duplicate->payload.As<TagPayload::Compound>();
+
+  // everything stored since the compound began is released
+  DataStore const& store = dataStore;
+  uint64_t released = (store.namedTags.size() - container.tagMark) * sizeof(NamedDataTag)
+    + (store.shapedLists.size() - mark.shapedLists) * sizeof(ShapedList);
+  for (size_t index = storage; index < store.compoundStorage.size(); ++index)
+    released += sizeof(store.compoundStorage[index]) + store.compoundStorage[index].size() * sizeof(NamedDataTagIndex);
+  std::apply([&](auto&... pools) {
+    size_t pool = 0;
+    ((released += (pools.size() - mark.pools[pool]) * sizeof(pools[0]), pools.resize(mark.pools[pool++])), ...);
+  }, dataStore.pools);
+  dataStore.namedTags.resize(container.tagMark);
+  dataStore.compoundStorage.resize(storage);
+  dataStore.shapedLists.resize(mark.shapedLists);
+  if (dataStore.compoundSources.size() > storage)
+    dataStore.compoundSources.resize(storage);
+  if (dataStore.compoundHashes.size() > storage)
+    dataStore.compoundHashes.resize(storage);
+  if (dataStore.sharedCompounds.size() > storage)
+    dataStore.sharedCompounds.resize(storage);
+  deduplicated.resize(mark.deduplicated);
+
+  dataStore.MarkShared(shared);
+  if (container.named)
+    dataStore.namedTags[container.namedContainer.tagIndex].dataTag.payload.Set(shared);
+  else
+    container.anonContainer.compound = shared;
+  // what the compound held counts as part of it, but the bytes that deduplication saved within it were saved all the same
+  uint64_t const bytesSaved = deduplicationStats.bytesSaved + released;
+  deduplicationStats = mark.stats;
+  ++deduplicationStats.compounds;
+  deduplicationStats.bytesSaved = bytesSaved;
+}
+
 void Builder::WriteByte(int8_t b, StringView name)
 {
   WriteTag(TAG::Byte, name, byte{ b });
@@ -113,7 +218,9 @@ void Builder::WriteByteArray(int8_t const* array, int32_t count, StringView name
   WriteTag<TagPayload::ByteArray>(TAG::Byte_Array, name, [this, array, count]() {
     auto& bytePool = dataStore.Pool<byte>();
     TagPayload::ByteArray byteArrayTag{ count, bytePool.size() };
-    bytePool.insert(bytePool.end(), array, array + count);
+    bytePool.append(array, array + count);
+    if (deduplication)
+      return Deduplicate<byte>(TAG::Byte_Array, byteArrayTag, count);
     return byteArrayTag;
   });
 }
@@ -123,7 +230,9 @@ void Builder::WriteIntArray(int32_t const* array, int32_t count, StringView name
   WriteTag<TagPayload::IntArray>(TAG::Int_Array, name, [this, array, count]() {
     auto& intPool = dataStore.Pool<int32_t>();
     TagPayload::IntArray intArrayTag{ count, intPool.size() };
-    intPool.insert(intPool.end(), array, array + count);
+    intPool.append(array, array + count);
+    if (deduplication)
+      return Deduplicate<int32_t>(TAG::Int_Array, intArrayTag, count);
     return intArrayTag;
   });
 }
@@ -133,7 +242,9 @@ void Builder::WriteLongArray(int64_t const* array, int32_t count, StringView nam
   WriteTag<TagPayload::LongArray>(TAG::Long_Array, name, [this, array, count]() {
     auto& longPool = dataStore.Pool<int64_t>();
     TagPayload::LongArray longArrayTag{ count, longPool.size() };
-    longPool.insert(longPool.end(), array, array + count);
+    longPool.append(array, array + count);
+    if (deduplication)
+      return Deduplicate<int64_t>(TAG::Long_Array, longArrayTag, count);
     return longArrayTag;
   });
 }
@@ -143,11 +254,114 @@ void Builder::WriteString(StringView str, StringView name)
   WriteTag<TagPayload::String>(TAG::String, name, [this, str]() {
     auto& stringPool = dataStore.Pool<char>();
     TagPayload::String stringTag{ static_cast<uint16_t>(str.size()), stringPool.size() };
-    stringPool.insert(stringPool.end(), str.data(), str.data() + str.size());
+    stringPool.append(str.data(), str.data() + str.size());
+    if (deduplication)
+      return Deduplicate<char>(TAG::String, stringTag, str.size());
     return stringTag;
   });
 }
 
+bool Builder::WriteCopy(TagRef const& source, StringView name)
+{
+  if (!source || containers.empty())
+    return false;
+  DataTag const copy = dataStore.CopyTag(*source.dataStore, source.tag);
+  return WithPayloadType(copy.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    return WriteTag(copy.type, name, copy.payload.As<T>(), false);
+  });
+}
+
+void Builder::SetListShaping(bool enabled)
+{
+  listShaping = enabled;
+}
+
+bool Builder::ShapeList(ContainerInfo& container)
+{
+  static constexpr int32_t minimumShapedListSize = 8;
+  int32_t const count = container.Count(dataStore);
+  if (!listShaping || count < minimumShapedListSize)
+    return false;
+  // the elements must be the only compounds and tags added since the list began, so their storage can be released.
+  // Deduplicated elements refer to the storage of an earlier equal compound instead of their own
+  auto const& elements = std::as_const(container.temporaryContainer->data).Pool<TagPayload::Compound>();
+  size_t own = 0;
+  for (int32_t element = 0; element < count; ++element)
+  {
+    if (elements[element].storageIndex_ == container.storageMark + own)
+      ++own;
+  }
+  if (dataStore.compoundStorage.size() - container.storageMark != own)
+    return false;
+  auto const& first = dataStore.compoundStorage[elements[0].storageIndex_];
+  size_t const fieldCount = first.size();
+  if (dataStore.namedTags.size() - container.tagMark != fieldCount * own)
+    return false;
+  // rows hold no compounds, which the fields of deduplicated elements could otherwise be
+  for (NamedDataTagIndex const field : first)
+  {
+    if (std::as_const(dataStore).namedTags[field].dataTag.type == TAG::Compound)
+      return false;
+  }
+  for (int32_t element = 1; element < count; ++element)
+  {
+    auto const& entries = dataStore.compoundStorage[elements[element].storageIndex_];
+    if (entries.size() != fieldCount)
+      return false;
+    for (size_t field = 0; field < fieldCount; ++field)
+    {
+      NamedDataTag const& expected = dataStore.namedTags[first[field]];
+      NamedDataTag const& actual = dataStore.namedTags[entries[field]];
+      if (actual.dataTag.type != expected.dataTag.type || actual.GetNameHash() != expected.GetNameHash() || actual.GetName() != expected.GetName())
+        return false;
+    }
+  }
+
+  CompoundSchema schema;
+  ShapedList shapedList;
+  for (size_t field = 0; field < fieldCount; ++field)
+  {
+    NamedDataTag const& tag = dataStore.namedTags[first[field]];
+    schema.names.emplace_back(tag.GetName());
+    schema.nameHashes.push_back(tag.GetNameHash());
+    schema.types.push_back(tag.dataTag.type);
+    WithPayloadType(tag.dataTag.type, [&](auto type) {
+      using T = typename decltype(type)::Type;
+      auto& pool = dataStore.Pool<T>();
+      shapedList.columns.push_back(pool.size());
+      for (int32_t element = 0; element < count; ++element)
+      {
+        NamedDataTagIndex const tagIndex = dataStore.compoundStorage[elements[element].storageIndex_][field];
+        pool.push_back(dataStore.namedTags[tagIndex].dataTag.payload.As<T>());
+      }
+    });
+  }
+  shapedList.schemaIndex = dataStore.AddSchema(std::move(schema));
+  dataStore.shapedLists.push_back(std::move(shapedList));
+
+  dataStore.namedTags.resize(container.tagMark);
+  dataStore.compoundStorage.resize(container.storageMark);
+  if (dataStore.compoundSources.size() > container.storageMark)
+    dataStore.compoundSources.resize(container.storageMark);
+  if (dataStore.compoundHashes.size() > container.storageMark)
+    dataStore.compoundHashes.resize(container.storageMark);
+  if (dataStore.sharedCompounds.size() > container.storageMark)
+    dataStore.sharedCompounds.resize(container.storageMark);
+  // the released elements are no longer candidates for deduplication. They were added last, after any earlier compound
+  for (size_t index = deduplicated.size(); index-- > 0;)
+  {
+    DataTag& candidate = deduplicated[index];
+    if (candidate.type != TAG::Compound)
+      continue;
+    if (candidate.payload.As<TagPayload::Compound>().storageIndex_ < container.storageMark)
+      break;
+    candidate.type = TAG::End;
+  }
+  container.ListPayload(dataStore).shaped_ = true;
+  return true;
+}
+
 void Builder::Begin(StringView rootName)
 {
   NamedDataTagIndex rootTagIndex = dataStore.AddNamedDataTag(TAG::Compound, rootName);
@@ -209,7 +423,7 @@ int32_t Builder::ContainerInfo::Count(DataStore const& ds) const
       case TAG::List:
         return ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::List>().count_;
       case TAG::Compound:
-        return static_cast<int32_t>(ds.compoundStorage[ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::Compound>().storageIndex_].size());
+        return static_cast<int32_t>(ds.EntryCount(ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::Compound>()));
       default:
         assert(!"Builder : Internal Type Error - This should never happen.");
         return 0;
@@ -220,7 +434,7 @@ int32_t Builder::ContainerInfo::Count(DataStore const& ds) const
     case TAG::List:
       return anonContainer.list.count_;
     case TAG::Compound:
-      return static_cast<int32_t>(ds.compoundStorage[anonContainer.compound.storageIndex_].size());
+      return static_cast<int32_t>(ds.EntryCount(anonContainer.compound));
     default:
       assert(!"Builder : Internal Type Error - This should never happen.");
       return 0;
@@ -263,8 +477,38 @@ size_t& Builder::ContainerInfo::PoolIndex(DataStore& ds)
   return anonContainer.list.poolIndex_;
 }
 
+TagPayload::List& Builder::ContainerInfo::ListPayload(DataStore& ds)
+{
+  assert(Type() == TAG::List);
+  if (named)
+  {
+    return ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::List>();
+  }
+  return anonContainer.list;
+}
+
+TagPayload::List const& Builder::ContainerInfo::ListPayload(DataStore const& ds) const
+{
+  assert(Type() == TAG::List);
+  if (named)
+  {
+    return ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::List>();
+  }
+  return anonContainer.list;
+}
+
+TagPayload::Compound Builder::ContainerInfo::CompoundPayload(DataStore const& ds) const
+{
+  assert(Type() == TAG::Compound);
+  if (named)
+  {
+    return ds.namedTags[namedContainer.tagIndex].dataTag.payload.As<TagPayload::Compound>();
+  }
+  return anonContainer.compound;
+}
+
 template<typename T, typename Fn>
-bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
+bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter, bool open)
 {
   if (containers.size() >= 512)
   {
@@ -282,7 +526,7 @@ bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
     NamedDataTagIndex newTagIndex = dataStore.AddNamedDataTag(type, name);
     dataStore.namedTags[newTagIndex].dataTag.payload.Set<T>(valueGetter());
     dataStore.compoundStorage[container.Storage(dataStore)].push_back(newTagIndex);
-    if (IsContainer(type))
+    if (IsContainer(type) && open)
     {
       ContainerInfo newContainer{};
       newContainer.named = true;
@@ -293,6 +537,10 @@ bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
         dataStore.namedTags[newTagIndex].dataTag.payload.As<TagPayload::Compound>().storageIndex_ = dataStore.compoundStorage.size();
         dataStore.compoundStorage.emplace_back();
       }
+      newContainer.tagMark = dataStore.namedTags.size();
+      newContainer.storageMark = dataStore.compoundStorage.size();
+      if (deduplication && type == TAG::Compound)
+        PushDeduplicationMark();
       containers.push(newContainer);
     }
   }
@@ -331,6 +579,12 @@ bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
       {
         container.temporaryContainer->data.Pool<T>().push_back(valueGetter());
       }
+      if (!open)
+      {
+        ++container.currentIndex;
+        container.IncrementCount(dataStore);
+        return true;
+      }
 
       ContainerInfo newContainer{};
       newContainer.named = false;
@@ -340,7 +594,10 @@ bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
         newContainer.anonContainer.compound.storageIndex_ = dataStore.compoundStorage.size();
         dataStore.compoundStorage.emplace_back();
       }
-      
+      newContainer.tagMark = dataStore.namedTags.size();
+      newContainer.storageMark = dataStore.compoundStorage.size();
+      if (deduplication && type == TAG::Compound)
+        PushDeduplicationMark();
       containers.push(newContainer);
     }
     else // ordinary data type
@@ -358,9 +615,9 @@ bool Builder::WriteTag(TAG type, StringView name, Fn valueGetter)
 }
 
 template<typename T, std::enable_if_t<!std::is_invocable_v<T>, bool>>
-bool Builder::WriteTag(TAG type, StringView name, T value)
+bool Builder::WriteTag(TAG type, StringView name, T value, bool open)
 {
-  return WriteTag<T>(type, name, [&value]() -> T { return value; });
+  return WriteTag<T>(type, name, [&value]() -> T { return value; }, open);
 }
 
 } // namespace ImNBT
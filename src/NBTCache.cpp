@@ -0,0 +1,141 @@
+#include <ImNBT/NBTCache.hpp>
+
+#include "hashbytes.h"
+
+#include <cstring>
+#include <filesystem>
+
+namespace ImNBT
+{
+
+DocumentCache::DocumentCache(size_t memoryBudget) : memoryBudget(memoryBudget) {}
+
+DocumentPtr DocumentCache::Get(StringView filepath)
+{
+  std::error_code error;
+  std::filesystem::path const path{ std::string(filepath) };
+  uintmax_t const size = std::filesystem::file_size(path, error);
+  if (error)
+    return nullptr;
+  auto const modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+  if (error)
+    return nullptr;
+  std::string key = "file:" + std::to_string(size) + ':' + std::to_string(modified) + ':';
+  key.append(filepath.data(), filepath.size());
+  return Lookup(key, [filepath]() -> DocumentPtr {
+    Reader reader;
+    return reader.ImportFile(filepath) ? reader.ReleaseDocument() : nullptr;
+  });
+}
+
+DocumentPtr DocumentCache::Get(uint8_t const* data, size_t length)
+{
+  // with the length to make collisions between different sizes impossible. Hits are confirmed against the contents
+  std::string const key = "data:" + std::to_string(length) + ':' + std::to_string(Internal::HashBytes(data, length, 0));
+  auto const load = [data, length]() -> DocumentPtr {
+    Reader reader;
+    return reader.ImportBinary(data, static_cast<uint32_t>(length)) ? reader.ReleaseDocument() : nullptr;
+  };
+  return Lookup(key, load, data, length);
+}
+
+DocumentPtr DocumentCache::Lookup(std::string const& key, std::function<DocumentPtr()> const& load, uint8_t const* data, size_t length)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = slots.find(key);
+  if (it != slots.end())
+  {
+    Slot& slot = it->second;
+    auto const sameContents = [data, length](std::vector<uint8_t> const* contents) { return !contents || (contents->size() == length && (length == 0 || std::memcmp(contents->data(), data, length) == 0)); };
+    if (slot.ready)
+    {
+      // different data with the same hash is parsed, but not cached
+      if (!sameContents(slot.contents.get()))
+      {
+        ++stats.misses;
+        lock.unlock();
+        return load();
+      }
+      ++stats.hits;
+      recency.splice(recency.begin(), recency, slot.recency);
+      return slot.document.get();
+    }
+    ++stats.misses;
+    ++stats.sharedLoads;
+    std::shared_future<DocumentPtr> const pending = slot.document;
+    std::shared_ptr<std::vector<uint8_t> const> const contents = slot.contents;
+    lock.unlock();
+    DocumentPtr document = pending.get();
+    return sameContents(contents.get()) ? document : load();
+  }
+  ++stats.misses;
+  std::promise<DocumentPtr> loading;
+  std::shared_ptr<std::vector<uint8_t>> contents = data ? std::make_shared<std::vector<uint8_t>>() : nullptr;
+  slots.emplace(key, Slot{ loading.get_future().share(), false, 0, {}, contents });
+
+  // copied and parsed without holding the lock, so lookups of other keys are not held up
+  lock.unlock();
+  if (contents)
+    contents->assign(data, data + length);
+  DocumentPtr document = load();
+  lock.lock();
+  it = slots.find(key);
+  if (!document)
+  {
+    ++stats.failedLoads;
+    slots.erase(it);
+  }
+  else
+  {
+    Slot& slot = it->second;
+    slot.ready = true;
+    slot.memoryUsage = document->MemoryUsage() + (contents ? contents->size() : 0);
+    slot.recency = recency.insert(recency.begin(), key);
+    stats.memoryUsage += slot.memoryUsage;
+    ++stats.documents;
+    Evict();
+  }
+  lock.unlock();
+  loading.set_value(document);
+  return document;
+}
+
+void DocumentCache::Evict()
+{
+  // the most recent document is kept even if it alone exceeds the budget
+  while (stats.memoryUsage > memoryBudget && recency.size() > 1)
+  {
+    auto const it = slots.find(recency.back());
+    stats.memoryUsage -= it->second.memoryUsage;
+    --stats.documents;
+    ++stats.evictions;
+    slots.erase(it);
+    recency.pop_back();
+  }
+}
+
+void DocumentCache::SetMemoryBudget(size_t inMemoryBudget)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  memoryBudget = inMemoryBudget;
+  Evict();
+}
+
+DocumentCache::Stats DocumentCache::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void DocumentCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  // documents still loading are left to finish
+  for (std::string const& key : recency)
+    slots.erase(key);
+  recency.clear();
+  stats.documents = 0;
+  stats.memoryUsage = 0;
+}
+
+} // namespace ImNBT
@@ -0,0 +1,97 @@
+#include <ImNBT/NBTDocument.hpp>
+
+namespace ImNBT
+{
+
+TagRef Document::Root() const
+{
+  if (dataStore.namedTags.empty())
+    return {};
+  return TagRef{ &dataStore, dataStore.namedTags.front().dataTag };
+}
+
+std::shared_ptr<Document const> Reader::ReleaseDocument()
+{
+  if (lazyPending)
+    MaterializeAll();
+  if (dataStore.namedTags.empty())
+    return nullptr;
+  auto document = std::make_shared<Document>();
+  document->dataStore = std::move(dataStore);
+  memoryStream.Clear();
+  Clear();
+  return document;
+}
+
+Cursor::Cursor(DocumentPtr document) : document(std::move(document))
+{
+  frames.push_back({ this->document ? this->document->Root() : TagRef{} });
+}
+
+TagRef Cursor::Next(TAG type, StringView name)
+{
+  Frame& frame = frames.back();
+  TagRef const& container = frame.container;
+  if (container.Type() == TAG::List)
+  {
+    TagPayload::List const& list = container.tag.payload.As<TagPayload::List>();
+    if (list.elementType_ != type || frame.position >= list.count_)
+      return {};
+    return TagRef{ container.dataStore, container.dataStore->ListElement(list, frame.position++) };
+  }
+  if (container.Type() != TAG::Compound)
+    return {};
+  size_t positionHint = frame.position;
+  Internal::EntryLocation const entry = container.dataStore->Locate(container.tag.payload.As<TagPayload::Compound>(), name, positionHint);
+  if (entry.type != type)
+    return {};
+  frame.position = static_cast<int32_t>(positionHint);
+  return TagRef{ container.dataStore, container.dataStore->EntryTag(entry) };
+}
+
+bool Cursor::Open(TAG type, StringView name)
+{
+  TagRef const next = Next(type, name);
+  if (!next)
+    return false;
+  frames.push_back({ next });
+  return true;
+}
+
+bool Cursor::OpenCompound(StringView name)
+{
+  if (name.empty() && frames.size() == 1 && frames.front().container.Type() == TAG::Compound)
+    return true;
+  return Open(TAG::Compound, name);
+}
+
+void Cursor::CloseCompound()
+{
+  // the root stays open
+  if (frames.size() > 1 && frames.back().container.Type() == TAG::Compound)
+    frames.pop_back();
+}
+
+bool Cursor::OpenList(StringView name)
+{
+  return Open(TAG::List, name);
+}
+
+void Cursor::CloseList()
+{
+  if (frames.size() > 1 && frames.back().container.Type() == TAG::List)
+    frames.pop_back();
+}
+
+int32_t Cursor::Count() const
+{
+  return frames.back().container.Size();
+}
+
+int32_t Cursor::ListSize() const
+{
+  TagRef const& container = frames.back().container;
+  return container.Type() == TAG::List ? container.Size() : 0;
+}
+
+} // namespace ImNBT
@@ -0,0 +1,533 @@
+#include <ImNBT/NBTEditor.hpp>
+#include <ImNBT/NBTWriter.hpp>
+
+#include "byteswapping.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ImNBT
+{
+
+namespace
+{
+
+template<typename T>
+DataTag MakeValue(DataStore& dataStore, T value)
+{
+  using Traits = Internal::TagTraits<T>;
+  DataTag tag{ Traits::Tag };
+  if constexpr (std::is_same_v<T, StringView>)
+  {
+    auto& chars = dataStore.Pool<char>();
+    tag.payload.Set(TagPayload::String{ static_cast<uint16_t>(value.size()), chars.size() });
+    chars.append(value.data(), value.data() + value.size());
+  }
+  else
+  {
+    tag.payload.Set<typename Traits::Payload>(value);
+  }
+  return tag;
+}
+
+// documents keep int and long arrays big endian, as they were read
+DataTag MakeArray(DataStore& dataStore, int8_t const* values, int32_t count)
+{
+  DataTag tag{ TAG::Byte_Array };
+  auto& pool = dataStore.Pool<byte>();
+  tag.payload.Set(TagPayload::ByteArray{ count, pool.size() });
+  pool.append(values, values + count);
+  return tag;
+}
+
+DataTag MakeArray(DataStore& dataStore, int32_t const* values, int32_t count)
+{
+  DataTag tag{ TAG::Int_Array };
+  auto& pool = dataStore.Pool<int32_t>();
+  tag.payload.Set(TagPayload::IntArray{ count, pool.size() });
+  pool.reserve(pool.size() + count);
+  for (int32_t i = 0; i < count; ++i)
+    pool.push_back(swap_i32(values[i]));
+  return tag;
+}
+
+DataTag MakeArray(DataStore& dataStore, int64_t const* values, int32_t count)
+{
+  DataTag tag{ TAG::Long_Array };
+  auto& pool = dataStore.Pool<int64_t>();
+  tag.payload.Set(TagPayload::LongArray{ count, pool.size() });
+  pool.reserve(pool.size() + count);
+  for (int32_t i = 0; i < count; ++i)
+    pool.push_back(swap_i64(values[i]));
+  return tag;
+}
+
+DataTag MakeCompound(DataStore& dataStore)
+{
+  DataTag tag{ TAG::Compound };
+  tag.payload.Set(TagPayload::Compound{ dataStore.compoundStorage.size() });
+  dataStore.compoundStorage.emplace_back();
+  return tag;
+}
+
+DataTag MakeList(DataStore&)
+{
+  DataTag tag{ TAG::List };
+  tag.payload.Set(TagPayload::List{});
+  return tag;
+}
+
+} // namespace
+
+Editor::Editor(DocumentPtr document)
+{
+  if (document)
+    dataStore = document->dataStore;
+}
+
+DocumentPtr Editor::Snapshot() const
+{
+  auto document = std::make_shared<Document>();
+  document->dataStore = dataStore;
+  return document;
+}
+
+TagRef Editor::Root() const
+{
+  if (dataStore.namedTags.empty())
+    return {};
+  return TagRef{ &dataStore, dataStore.namedTags.front().dataTag };
+}
+
+template<typename Make>
+bool Editor::Replace(Path const& path, TAG type, Make make)
+{
+  std::vector<Link> chain;
+  if (!ResolveForChange(path, chain) || chain.back().tag.type != type)
+    return false;
+  MarkChanged(chain);
+  Store(chain, chain.size() - 1, make(dataStore));
+  return true;
+}
+
+template<typename Make>
+bool Editor::Insert(Path const& compound, StringView name, TAG type, Make make)
+{
+  std::vector<Link> chain;
+  if (!ResolveForChange(compound, chain) || chain.back().tag.type != TAG::Compound)
+    return false;
+  if (chain.back().tag.payload.As<TagPayload::Compound>().shapedRow_ >= 0)
+  {
+    Unshape(chain, chain.size() - 2);
+    chain.clear();
+    Resolve(compound, chain);
+  }
+  MarkChanged(chain);
+  TagPayload::Compound const& target = chain.back().tag.payload.As<TagPayload::Compound>();
+  size_t positionHint = 0;
+  Internal::EntryLocation const entry = std::as_const(dataStore).Locate(target, name, positionHint);
+  DataTag const tag = make(dataStore);
+  if (entry.type != TAG::End)
+  {
+    dataStore.namedTags[entry.index].dataTag = tag;
+    return true;
+  }
+  Internal::NamedDataTagIndex const tagIndex = dataStore.AddNamedDataTag(type, name);
+  dataStore.namedTags[tagIndex].dataTag = tag;
+  dataStore.compoundStorage[target.storageIndex_].push_back(tagIndex);
+  return true;
+}
+
+template<typename Make>
+bool Editor::Append(Path const& path, TAG type, Make make)
+{
+  std::vector<Link> chain;
+  if (!ResolveForChange(path, chain) || chain.back().tag.type != TAG::List)
+    return false;
+  if (chain.back().tag.payload.As<TagPayload::List>().count_ > 0 && chain.back().tag.payload.As<TagPayload::List>().elementType_ != type)
+    return false;
+  if (chain.back().tag.payload.As<TagPayload::List>().shaped_)
+    Unshape(chain, chain.size() - 1);
+  MarkChanged(chain);
+  TagPayload::List list = chain.back().tag.payload.As<TagPayload::List>();
+  DataTag const element = make(dataStore);
+  Internal::WithPayloadType(type, [&](auto payloadType) {
+    using T = typename decltype(payloadType)::Type;
+    auto& pool = dataStore.Pool<T>();
+    // the elements of a list are contiguous, so unless the list ends the pool they are moved to its end to make room
+    if (list.count_ == 0)
+      list.poolIndex_ = pool.size();
+    else if (list.poolIndex_ + list.count_ != pool.size())
+      list.poolIndex_ = pool.Duplicate(list.poolIndex_, list.count_);
+    pool.push_back(element.payload.As<T>());
+  });
+  list.elementType_ = type;
+  ++list.count_;
+  DataTag tag{ TAG::List };
+  tag.payload.Set(list);
+  Store(chain, chain.size() - 1, tag);
+  return true;
+}
+
+template<typename T>
+bool Editor::Set(Path const& path, T value)
+{
+  return Replace(path, Internal::TagTraits<T>::Tag, [&](DataStore& store) { return MakeValue(store, value); });
+}
+
+bool Editor::SetByteArray(Path const& path, int8_t const* values, int32_t count)
+{
+  return Replace(path, TAG::Byte_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::SetIntArray(Path const& path, int32_t const* values, int32_t count)
+{
+  return Replace(path, TAG::Int_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::SetLongArray(Path const& path, int64_t const* values, int32_t count)
+{
+  return Replace(path, TAG::Long_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+template<typename T>
+bool Editor::Insert(Path const& compound, StringView name, T value)
+{
+  return Insert(compound, name, Internal::TagTraits<T>::Tag, [&](DataStore& store) { return MakeValue(store, value); });
+}
+
+bool Editor::InsertByteArray(Path const& compound, StringView name, int8_t const* values, int32_t count)
+{
+  return Insert(compound, name, TAG::Byte_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::InsertIntArray(Path const& compound, StringView name, int32_t const* values, int32_t count)
+{
+  return Insert(compound, name, TAG::Int_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::InsertLongArray(Path const& compound, StringView name, int64_t const* values, int32_t count)
+{
+  return Insert(compound, name, TAG::Long_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::InsertCompound(Path const& compound, StringView name)
+{
+  return Insert(compound, name, TAG::Compound, MakeCompound);
+}
+
+bool Editor::InsertList(Path const& compound, StringView name)
+{
+  return Insert(compound, name, TAG::List, MakeList);
+}
+
+template<typename T>
+bool Editor::Append(Path const& list, T value)
+{
+  return Append(list, Internal::TagTraits<T>::Tag, [&](DataStore& store) { return MakeValue(store, value); });
+}
+
+bool Editor::AppendByteArray(Path const& list, int8_t const* values, int32_t count)
+{
+  return Append(list, TAG::Byte_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::AppendIntArray(Path const& list, int32_t const* values, int32_t count)
+{
+  return Append(list, TAG::Int_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::AppendLongArray(Path const& list, int64_t const* values, int32_t count)
+{
+  return Append(list, TAG::Long_Array, [&](DataStore& store) { return MakeArray(store, values, count); });
+}
+
+bool Editor::AppendCompound(Path const& list)
+{
+  return Append(list, TAG::Compound, MakeCompound);
+}
+
+bool Editor::AppendList(Path const& list)
+{
+  return Append(list, TAG::List, MakeList);
+}
+
+#define ImNBT_EDITOR_VALUE_FUNCTIONS(T)                   \
+  template bool Editor::Set(Path const&, T);              \
+  template bool Editor::Insert(Path const&, StringView, T); \
+  template bool Editor::Append(Path const&, T);
+
+ImNBT_EDITOR_VALUE_FUNCTIONS(int8_t)
+ImNBT_EDITOR_VALUE_FUNCTIONS(int16_t)
+ImNBT_EDITOR_VALUE_FUNCTIONS(int32_t)
+ImNBT_EDITOR_VALUE_FUNCTIONS(int64_t)
+ImNBT_EDITOR_VALUE_FUNCTIONS(float)
+ImNBT_EDITOR_VALUE_FUNCTIONS(double)
+ImNBT_EDITOR_VALUE_FUNCTIONS(StringView)
+
+#undef ImNBT_EDITOR_VALUE_FUNCTIONS
+
+bool Editor::Remove(Path const& path)
+{
+  std::vector<Link> chain;
+  if (!ResolveForChange(path, chain) || chain.size() < 2)
+    return false;
+  DataTag const& owner = chain[chain.size() - 2].tag;
+  if (owner.type == TAG::Compound && owner.payload.As<TagPayload::Compound>().shapedRow_ >= 0)
+  {
+    // the entries of shaped list elements are fields of the list, so the element must become a compound of its own
+    Unshape(chain, chain.size() - 3);
+    chain.clear();
+    Resolve(path, chain);
+  }
+  else if (owner.type == TAG::List && owner.payload.As<TagPayload::List>().shaped_)
+  {
+    Unshape(chain, chain.size() - 2);
+  }
+  MarkChanged(chain);
+
+  Link const& removed = chain.back();
+  DataTag const& container = chain[chain.size() - 2].tag;
+  if (container.type == TAG::Compound)
+  {
+    auto& entries = dataStore.compoundStorage[container.payload.As<TagPayload::Compound>().storageIndex_];
+    entries.erase(std::find(entries.begin(), entries.end(), removed.index));
+    return true;
+  }
+  TagPayload::List list = container.payload.As<TagPayload::List>();
+  Internal::WithPayloadType(list.elementType_, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    auto& pool = dataStore.Pool<T>();
+    list.poolIndex_ = pool.Relocate(list.poolIndex_, list.count_);
+    for (size_t i = removed.index; i + 1 < static_cast<size_t>(list.count_); ++i)
+      pool[list.poolIndex_ + i] = std::as_const(pool)[list.poolIndex_ + i + 1];
+  });
+  --list.count_;
+  DataTag tag{ TAG::List };
+  tag.payload.Set(list);
+  Store(chain, chain.size() - 2, tag);
+  return true;
+}
+
+size_t Editor::Compact()
+{
+  DataStore const& store = dataStore;
+  if (store.namedTags.empty())
+    return 0;
+  size_t const before = store.MemoryUsage();
+  DataStore compacted;
+  compacted.sourceBytes = store.sourceBytes;
+  compacted.bigEndianArrays = store.bigEndianArrays;
+  NamedDataTag const& root = store.namedTags.front();
+  compacted.AddNamedDataTag(TAG::Compound, root.GetName());
+  DataTag const copy = compacted.CopyTag(store, root.dataTag);
+  compacted.namedTags[0].dataTag = copy;
+  dataStore = std::move(compacted);
+  size_t const after = store.MemoryUsage();
+  return before > after ? before - after : 0;
+}
+
+std::shared_ptr<std::vector<uint8_t> const> Editor::ExportBinary(size_t cacheThreshold)
+{
+  if (dataStore.namedTags.empty())
+    return nullptr;
+  auto output = std::make_shared<std::vector<uint8_t>>();
+  Writer::EncodedRanges ranges;
+  ranges.threshold = cacheThreshold;
+  {
+    Writer writer{ Snapshot() };
+    writer.encodedRanges = &ranges;
+    writer.ExportBinary(*output);
+  }
+
+  // ranges into the previous output, or the file the document was read from, are replaced by ranges into this one.
+  // Containers inside one that was copied as it was are not visited, so their ranges move along with the copy
+  std::sort(ranges.copies.begin(), ranges.copies.end(), [](auto const& a, auto const& b) { return a.first.begin < b.first.begin; });
+  auto const rebase = [&](Internal::SourceRange const& range) {
+    auto copy = std::upper_bound(ranges.copies.begin(), ranges.copies.end(), range.begin, [](size_t begin, auto const& copy) { return begin < copy.first.begin; });
+    if (range.empty() || copy == ranges.copies.begin() || range.end > (--copy)->first.end)
+      return Internal::SourceRange{};
+    return Internal::SourceRange{ range.begin - copy->first.begin + copy->second, range.end - copy->first.begin + copy->second };
+  };
+  // ranges are only written where they change, so the segments shared with snapshots are kept
+  DataStore const& store = dataStore;
+  std::vector<Internal::SourceRange> listSources(store.shapedLists.size());
+  for (size_t list = 0; list < listSources.size(); ++list)
+    listSources[list] = rebase(store.shapedLists[list].source);
+  for (auto const& [list, range] : ranges.shapedLists)
+    listSources[list] = range;
+  for (size_t list = 0; list < listSources.size(); ++list)
+  {
+    Internal::SourceRange const& current = store.shapedLists[list].source;
+    if (current.begin != listSources[list].begin || current.end != listSources[list].end)
+      dataStore.shapedLists[list].source = listSources[list];
+  }
+  std::vector<Internal::SourceRange> compoundSources(store.compoundSources.size());
+  for (size_t compound = 0; compound < compoundSources.size(); ++compound)
+    compoundSources[compound] = rebase(store.compoundSources[compound]);
+  for (auto const& [storageIndex, range] : ranges.compounds)
+  {
+    if (compoundSources.size() <= storageIndex)
+      compoundSources.resize(storageIndex + 1);
+    compoundSources[storageIndex] = range;
+  }
+  if (store.compoundSources.size() < compoundSources.size())
+    dataStore.compoundSources.resize(compoundSources.size());
+  for (size_t compound = 0; compound < compoundSources.size(); ++compound)
+  {
+    Internal::SourceRange const& current = store.compoundSources[compound];
+    if (current.begin != compoundSources[compound].begin || current.end != compoundSources[compound].end)
+      dataStore.compoundSources[compound] = compoundSources[compound];
+  }
+  dataStore.sourceBytes = output;
+  return output;
+}
+
+uint64_t Editor::Hash(Path const& path, HashOrder order)
+{
+  std::vector<Link> chain;
+  if (!Resolve(path, chain))
+    return 0;
+  return dataStore.ContentHash(chain.back().tag, order == HashOrder::Canonical);
+}
+
+bool Editor::Resolve(Path const& path, std::vector<Link>& chain) const
+{
+  if (dataStore.namedTags.empty())
+    return false;
+  // the root compound is always the first tag of a document
+  chain.push_back({ Link::Slot::Record, dataStore.namedTags.front().dataTag, 0 });
+  for (Path::Step const& step : path.steps)
+  {
+    DataTag const& node = chain.back().tag;
+    if (step.kind == Path::Step::Kind::Key && node.type == TAG::Compound)
+    {
+      Internal::EntryLocation const entry = dataStore.Locate(node.payload.As<TagPayload::Compound>(), step.key, step.keyHash, step.positionHint);
+      if (entry.type == TAG::End)
+        return false;
+      // for an entry of a shaped list element, the search leaves the hint at its field
+      if (entry.shaped)
+        chain.push_back({ Link::Slot::Field, dataStore.EntryTag(entry), step.positionHint });
+      else
+        chain.push_back({ Link::Slot::Record, dataStore.EntryTag(entry), entry.index });
+    }
+    else if (step.kind == Path::Step::Kind::Index && node.type == TAG::List)
+    {
+      TagPayload::List const& list = node.payload.As<TagPayload::List>();
+      int32_t const index = step.index < 0 ? list.count_ + step.index : step.index;
+      if (index < 0 || index >= list.count_)
+        return false;
+      chain.push_back({ Link::Slot::Element, dataStore.ListElement(list, index), static_cast<size_t>(index) });
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Editor::ResolveForChange(Path const& path, std::vector<Link>& chain)
+{
+  if (!Resolve(path, chain))
+    return false;
+  while (Unshare(chain))
+  {
+    chain.clear();
+    Resolve(path, chain);
+  }
+  return true;
+}
+
+bool Editor::Unshare(std::vector<Link>& chain)
+{
+  for (size_t link = 0; link < chain.size(); ++link)
+  {
+    DataTag const& tag = chain[link].tag;
+    if (tag.type != TAG::Compound || !dataStore.IsShared(tag.payload.As<TagPayload::Compound>()))
+      continue;
+    // the copy is read from a snapshot of the store, as writing it may move what it is copied from
+    DataStore const source = dataStore;
+    DataTag const copy = dataStore.CopyTag(source, tag);
+    Store(chain, link, copy);
+    return true;
+  }
+  return false;
+}
+
+void Editor::Store(std::vector<Link>& chain, size_t link, DataTag const& tag)
+{
+  Link& target = chain[link];
+  target.tag = tag;
+  if (target.slot == Link::Slot::Record)
+  {
+    dataStore.namedTags[target.index].dataTag = tag;
+    return;
+  }
+  DataTag const& owner = chain[link - 1].tag;
+  Internal::WithPayloadType(tag.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    auto& pool = dataStore.Pool<T>();
+    if (target.slot == Link::Slot::Element)
+    {
+      // the elements are moved if they may be shared, which changes the list itself in its own owner
+      TagPayload::List list = owner.payload.As<TagPayload::List>();
+      size_t const first = pool.Relocate(list.poolIndex_, list.count_);
+      pool[first + target.index] = tag.payload.As<T>();
+      if (first != list.poolIndex_)
+      {
+        list.poolIndex_ = first;
+        DataTag moved{ TAG::List };
+        moved.payload.Set<TagPayload::List>(list);
+        Store(chain, link - 1, moved);
+      }
+      return;
+    }
+    // a shaped list stores each field of its elements as one column, which is moved as a whole
+    TagPayload::Compound const& compound = owner.payload.As<TagPayload::Compound>();
+    int32_t const rows = chain[link - 2].tag.payload.As<TagPayload::List>().count_;
+    size_t const column = std::as_const(dataStore).shapedLists[compound.storageIndex_].columns[target.index];
+    size_t const first = pool.Relocate(column, rows);
+    pool[first + compound.shapedRow_] = tag.payload.As<T>();
+    if (first != column)
+      dataStore.shapedLists[compound.storageIndex_].columns[target.index] = first;
+  });
+}
+
+void Editor::MarkChanged(std::vector<Link> const& chain)
+{
+  for (Link const& link : chain)
+    dataStore.MarkChanged(link.tag);
+}
+
+void Editor::Unshape(std::vector<Link>& chain, size_t link)
+{
+  DataStore const& store = dataStore;
+  TagPayload::List list = chain[link].tag.payload.As<TagPayload::List>();
+  Internal::ShapedList const shaped = store.shapedLists[list.poolIndex_];
+  Internal::CompoundSchema const& schema = store.schemas[shaped.schemaIndex];
+  auto& compounds = dataStore.Pool<TagPayload::Compound>();
+  size_t const first = compounds.size();
+  for (int32_t row = 0; row < list.count_; ++row)
+  {
+    std::vector<Internal::NamedDataTagIndex> entries;
+    entries.reserve(schema.names.size());
+    for (size_t field = 0; field < schema.names.size(); ++field)
+    {
+      NamedDataTag entry;
+      entry.SetName(schema.names[field], schema.nameHashes[field]);
+      entry.dataTag = store.ShapedEntry(shaped, row, field);
+      entries.push_back(store.namedTags.size());
+      dataStore.namedTags.push_back(std::move(entry));
+    }
+    compounds.push_back(TagPayload::Compound{ store.compoundStorage.size() });
+    dataStore.compoundStorage.push_back(std::move(entries));
+  }
+  list.shaped_ = false;
+  list.poolIndex_ = first;
+  DataTag tag{ TAG::List };
+  tag.payload.Set(list);
+  Store(chain, link, tag);
+}
+
+} // namespace ImNBT
@@ -0,0 +1,760 @@
+#include <ImNBT/NBTReader.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ImNBT
+{
+
+namespace
+{
+
+constexpr char FrozenMagic[8] = { 'I', 'M', 'N', 'B', 'T', 'F', 'R', 'Z' };
+constexpr uint32_t FrozenVersion = 2;
+// reads as 0x04030201 on a host of the other byte order
+constexpr uint32_t FrozenByteOrder = 0x01020304;
+constexpr size_t FrozenAlignment = 8;
+
+enum Section : uint32_t
+{
+  Tags,
+  Names,
+  StorageOffsets,
+  StorageEntries,
+  Schemas,
+  SchemaFields,
+  ShapedLists,
+  Columns,
+  Bytes,
+  Shorts,
+  Ints,
+  Longs,
+  Floats,
+  Doubles,
+  Chars,
+  ByteArrays,
+  IntArrays,
+  LongArrays,
+  Strings,
+  Lists,
+  Compounds,
+  // storage indices of the compounds deduplication shares between several tags
+  SharedCompounds,
+  SectionCount
+};
+
+struct FrozenSection
+{
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct FrozenHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t headerSize;
+  uint32_t sectionCount;
+  uint64_t imageSize;
+  FrozenSection sections[SectionCount];
+};
+
+// the payload of a tag or of a pool element. Values of number tags are stored bitwise in index
+struct FrozenPayload
+{
+  uint64_t index;
+  int32_t count;
+  TAG elementType;
+  uint8_t shaped;
+  uint16_t padding;
+};
+
+struct FrozenName
+{
+  uint64_t offset;
+  uint32_t hash;
+  uint16_t length;
+  TAG type;
+  uint8_t padding;
+};
+
+struct FrozenTag
+{
+  FrozenName name;
+  FrozenPayload payload;
+};
+
+struct FrozenSchema
+{
+  uint64_t firstField;
+  uint64_t fieldCount;
+};
+
+struct FrozenShapedList
+{
+  uint64_t schemaIndex;
+  uint64_t firstColumn;
+};
+
+static_assert(sizeof(FrozenPayload) == 16 && sizeof(FrozenName) == 16 && sizeof(FrozenTag) == 32, "frozen records must not depend on the compiler's padding");
+
+FrozenPayload FreezePayload(TAG type, TagPayload const& payload)
+{
+  FrozenPayload frozen{};
+  switch (type)
+  {
+    case TAG::Byte_Array:
+      frozen.index = payload.As<TagPayload::ByteArray>().poolIndex_;
+      frozen.count = payload.As<TagPayload::ByteArray>().count_;
+      break;
+    case TAG::Int_Array:
+      frozen.index = payload.As<TagPayload::IntArray>().poolIndex_;
+      frozen.count = payload.As<TagPayload::IntArray>().count_;
+      break;
+    case TAG::Long_Array:
+      frozen.index = payload.As<TagPayload::LongArray>().poolIndex_;
+      frozen.count = payload.As<TagPayload::LongArray>().count_;
+      break;
+    case TAG::String:
+      frozen.index = payload.As<TagPayload::String>().poolIndex_;
+      frozen.count = payload.As<TagPayload::String>().length_;
+      break;
+    case TAG::List:
+    {
+      auto const& list = payload.As<TagPayload::List>();
+      frozen.index = list.poolIndex_;
+      frozen.count = list.count_;
+      frozen.elementType = list.elementType_;
+      frozen.shaped = list.shaped_;
+      break;
+    }
+    case TAG::Compound:
+      frozen.index = payload.As<TagPayload::Compound>().storageIndex_;
+      frozen.count = payload.As<TagPayload::Compound>().shapedRow_;
+      break;
+    default:
+      Internal::WithPayloadType(type, [&](auto payloadType) {
+        using T = typename decltype(payloadType)::Type;
+        T const value = payload.As<T>();
+        std::memcpy(&frozen.index, &value, sizeof(T));
+      });
+      break;
+  }
+  return frozen;
+}
+
+template<typename T>
+TagPayload ThawStruct(T value)
+{
+  TagPayload payload;
+  payload.Set<T>(value);
+  return payload;
+}
+
+TagPayload ThawPayload(TAG type, FrozenPayload const& frozen)
+{
+  switch (type)
+  {
+    case TAG::Byte_Array: return ThawStruct(TagPayload::ByteArray{ frozen.count, frozen.index });
+    case TAG::Int_Array: return ThawStruct(TagPayload::IntArray{ frozen.count, frozen.index });
+    case TAG::Long_Array: return ThawStruct(TagPayload::LongArray{ frozen.count, frozen.index });
+    case TAG::String: return ThawStruct(TagPayload::String{ static_cast<uint16_t>(frozen.count), frozen.index });
+    case TAG::List: return ThawStruct(TagPayload::List{ frozen.elementType, frozen.shaped != 0, frozen.count, frozen.index });
+    case TAG::Compound: return ThawStruct(TagPayload::Compound{ frozen.index, frozen.count });
+    default:
+    {
+      TagPayload payload;
+      // lists and compounds are handled above, so only number tags are left
+      Internal::WithPayloadType(type, [&](auto payloadType) {
+        using T = typename decltype(payloadType)::Type;
+        if constexpr (!std::is_same_v<T, TagPayload::List> && !std::is_same_v<T, TagPayload::Compound>)
+        {
+          T value;
+          std::memcpy(&value, &frozen.index, sizeof(T));
+          payload.Set<T>(value);
+        }
+      });
+      return payload;
+    }
+  }
+}
+
+// a read only mapping of a whole file, unmapped once nothing refers to it
+struct FileMapping
+{
+  uint8_t const* data = nullptr;
+  size_t size = 0;
+
+  FileMapping() = default;
+  FileMapping(FileMapping const&) = delete;
+  FileMapping& operator=(FileMapping const&) = delete;
+  ~FileMapping()
+  {
+    if (!data)
+      return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+#endif
+  }
+
+  static std::shared_ptr<FileMapping const> Open(StringView filepath)
+  {
+    auto mapping = std::make_shared<FileMapping>();
+#if defined(_WIN32)
+    HANDLE const file = CreateFileA(std::string(filepath).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return nullptr;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+      // the view keeps the file and the mapping object open on its own
+      if (HANDLE const fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+      {
+        mapping->data = static_cast<uint8_t const*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+        mapping->size = static_cast<size_t>(size.QuadPart);
+        CloseHandle(fileMapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    int const file = open(std::string(filepath).c_str(), O_RDONLY);
+    if (file < 0)
+      return nullptr;
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+      size_t const size = static_cast<size_t>(status.st_size);
+      void* const view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (view != MAP_FAILED)
+      {
+        mapping->data = static_cast<uint8_t const*>(view);
+        mapping->size = size;
+      }
+    }
+    close(file);
+#endif
+    return mapping->data ? mapping : nullptr;
+  }
+};
+
+bool IsPayloadType(TAG type)
+{
+  return type >= TAG::Byte && type <= TAG::Long_Array;
+}
+
+class ImageWriter
+{
+public:
+  explicit ImageWriter(std::vector<uint8_t>& out) : out(out)
+  {
+    out.assign(sizeof(FrozenHeader), 0);
+  }
+
+  template<typename T>
+  void Add(Section section, T const* data, size_t count)
+  {
+    out.resize((out.size() + FrozenAlignment - 1) / FrozenAlignment * FrozenAlignment, 0);
+    sections[section] = { out.size(), count };
+    out.insert(out.end(), reinterpret_cast<uint8_t const*>(data), reinterpret_cast<uint8_t const*>(data + count));
+  }
+
+  void Finish()
+  {
+    FrozenHeader header{};
+    std::memcpy(header.magic, FrozenMagic, sizeof(FrozenMagic));
+    header.version = FrozenVersion;
+    header.byteOrder = FrozenByteOrder;
+    header.headerSize = sizeof(FrozenHeader);
+    header.sectionCount = SectionCount;
+    header.imageSize = out.size();
+    std::memcpy(header.sections, sections, sizeof(sections));
+    std::memcpy(out.data(), &header, sizeof(header));
+  }
+
+private:
+  std::vector<uint8_t>& out;
+  FrozenSection sections[SectionCount] = {};
+};
+
+// gives the sections of an image whose header has been checked
+class ImageReader
+{
+public:
+  ImageReader(uint8_t const* image, FrozenHeader const& header) : image(image), header(header) {}
+
+  template<typename T>
+  T const* Get(Section section) const
+  {
+    return reinterpret_cast<T const*>(image + header.sections[section].offset);
+  }
+  uint64_t Count(Section section) const { return header.sections[section].count; }
+
+  // reads the pool in place if owner keeps the image alive, or copies it otherwise. Sections are aligned for any pool type
+  template<typename T>
+  void ThawPool(Section section, Internal::SharedPool<T>& pool, std::shared_ptr<void const> const& owner) const
+  {
+    T const* data = Get<T>(section);
+    if (owner)
+      pool = Internal::SharedPool<T>::Borrow(data, Count(section), owner);
+    else
+      pool.assign(data, data + Count(section));
+  }
+
+private:
+  uint8_t const* image;
+  FrozenHeader const& header;
+};
+
+size_t SectionElementSize(Section section)
+{
+  switch (section)
+  {
+    case Tags: return sizeof(FrozenTag);
+    case Names: case Chars: case Bytes: return 1;
+    case StorageOffsets: case StorageEntries: case Columns: case Longs: case Doubles: case SharedCompounds: return 8;
+    case Schemas: return sizeof(FrozenSchema);
+    case SchemaFields: return sizeof(FrozenName);
+    case ShapedLists: return sizeof(FrozenShapedList);
+    case Shorts: return 2;
+    case Ints: case Floats: return 4;
+    default: return sizeof(FrozenPayload);
+  }
+}
+
+// true if no compound or list of a store holds itself, which exports and hashes would recurse into forever.
+// Compounds and the lists in the list pool are visited depth first, without recursing, and each only once
+bool IsAcyclic(DataStore const& store)
+{
+  size_t const compoundCount = store.compoundStorage.size();
+  auto const& lists = store.Pool<TagPayload::List>();
+  auto const& compounds = store.Pool<TagPayload::Compound>();
+  // nodes are compounds by storage index, then lists by pool index
+  std::vector<uint8_t> state(compoundCount + lists.size(), 0);
+  enum : uint8_t { Unvisited, Open, Closed };
+  std::vector<size_t> children;
+  auto const addChildren = [&](TAG type, TagPayload const& payload) {
+    if (type == TAG::Compound)
+    {
+      children.push_back(payload.As<TagPayload::Compound>().storageIndex_);
+      return;
+    }
+    if (type != TAG::List)
+      return;
+    auto const& list = payload.As<TagPayload::List>();
+    auto const addElements = [&](TAG elementType, size_t first) {
+      for (size_t element = first; element < first + list.count_; ++element)
+      {
+        if (elementType == TAG::Compound)
+          children.push_back(compounds[element].storageIndex_);
+        else if (elementType == TAG::List)
+          children.push_back(compoundCount + element);
+      }
+    };
+    if (!list.shaped_)
+      addElements(list.elementType_, list.poolIndex_);
+    else
+    {
+      Internal::ShapedList const& shaped = store.shapedLists[list.poolIndex_];
+      Internal::CompoundSchema const& schema = store.schemas[shaped.schemaIndex];
+      for (size_t field = 0; field < schema.types.size(); ++field)
+        addElements(schema.types[field], shaped.columns[field]);
+    }
+  };
+
+  struct Frame
+  {
+    size_t firstChild;
+    size_t nextChild;
+    size_t node;
+  };
+  std::vector<Frame> stack;
+  auto const enter = [&](size_t node) {
+    state[node] = Open;
+    size_t const firstChild = children.size();
+    if (node < compoundCount)
+    {
+      for (Internal::NamedDataTagIndex tagIndex : store.compoundStorage[node])
+      {
+        DataTag const& tag = store.namedTags[tagIndex].dataTag;
+        addChildren(tag.type, tag.payload);
+      }
+    }
+    else
+    {
+      TagPayload payload;
+      payload.Set(lists[node - compoundCount]);
+      addChildren(TAG::List, payload);
+    }
+    stack.push_back({ firstChild, firstChild, node });
+  };
+  for (size_t root = 0; root < state.size(); ++root)
+  {
+    if (state[root] != Unvisited)
+      continue;
+    enter(root);
+    while (!stack.empty())
+    {
+      Frame& frame = stack.back();
+      if (frame.nextChild == children.size())
+      {
+        state[frame.node] = Closed;
+        children.resize(frame.firstChild);
+        stack.pop_back();
+        continue;
+      }
+      size_t const child = children[frame.nextChild++];
+      if (state[child] == Open)
+        return false;
+      if (state[child] == Unvisited)
+        enter(child);
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+void DataStore::Freeze(std::vector<uint8_t>& out) const
+{
+  ImageWriter writer{ out };
+
+  // names are stored once however many tags and schemas share them
+  std::string names;
+  std::unordered_map<StringView, uint64_t> nameOffsets;
+  auto const freezeName = [&](StringView name, uint32_t hash, TAG type) {
+    auto const it = nameOffsets.find(name);
+    uint64_t offset;
+    if (it != nameOffsets.end())
+      offset = it->second;
+    else
+    {
+      offset = names.size();
+      names.append(name.data(), name.size());
+      nameOffsets.emplace(name, offset);
+    }
+    return FrozenName{ offset, hash, static_cast<uint16_t>(name.size()), type, 0 };
+  };
+
+  std::vector<FrozenTag> tags;
+  tags.reserve(namedTags.size());
+  for (NamedDataTag const& tag : namedTags)
+  {
+    TAG const type = tag.dataTag.type;
+    tags.push_back({ freezeName(tag.GetName(), tag.GetNameHash(), type), IsPayloadType(type) ? FreezePayload(type, tag.dataTag.payload) : FrozenPayload{} });
+  }
+
+  std::vector<uint64_t> storageOffsets{ 0 };
+  std::vector<uint64_t> storageEntries;
+  for (auto const& storage : compoundStorage)
+  {
+    storageEntries.insert(storageEntries.end(), storage.begin(), storage.end());
+    storageOffsets.push_back(storageEntries.size());
+  }
+
+  std::vector<FrozenSchema> frozenSchemas;
+  std::vector<FrozenName> schemaFields;
+  for (Internal::CompoundSchema const& schema : schemas)
+  {
+    frozenSchemas.push_back({ schemaFields.size(), schema.names.size() });
+    for (size_t field = 0; field < schema.names.size(); ++field)
+      schemaFields.push_back(freezeName(schema.names[field], schema.nameHashes[field], schema.types[field]));
+  }
+
+  std::vector<FrozenShapedList> frozenShapedLists;
+  std::vector<uint64_t> columns;
+  for (Internal::ShapedList const& list : shapedLists)
+  {
+    frozenShapedLists.push_back({ list.schemaIndex, columns.size() });
+    columns.insert(columns.end(), list.columns.begin(), list.columns.end());
+  }
+
+  std::vector<uint64_t> shared;
+  for (size_t index = 0; index < sharedCompounds.size(); ++index)
+  {
+    if (sharedCompounds[index] != 0)
+      shared.push_back(index);
+  }
+
+  auto const freezePool = [&](Section section, TAG type, auto const& pool) {
+    std::vector<FrozenPayload> frozen;
+    frozen.reserve(pool.size());
+    for (auto const& element : pool)
+      frozen.push_back(FreezePayload(type, ThawStruct(element)));
+    writer.Add(section, frozen.data(), frozen.size());
+  };
+
+  writer.Add(Tags, tags.data(), tags.size());
+  writer.Add(Names, names.data(), names.size());
+  writer.Add(StorageOffsets, storageOffsets.data(), storageOffsets.size());
+  writer.Add(StorageEntries, storageEntries.data(), storageEntries.size());
+  writer.Add(Schemas, frozenSchemas.data(), frozenSchemas.size());
+  writer.Add(SchemaFields, schemaFields.data(), schemaFields.size());
+  writer.Add(ShapedLists, frozenShapedLists.data(), frozenShapedLists.size());
+  writer.Add(Columns, columns.data(), columns.size());
+  writer.Add(Bytes, Pool<byte>().data(), Pool<byte>().size());
+  writer.Add(Shorts, Pool<int16_t>().data(), Pool<int16_t>().size());
+  writer.Add(Ints, Pool<int32_t>().data(), Pool<int32_t>().size());
+  writer.Add(Longs, Pool<int64_t>().data(), Pool<int64_t>().size());
+  writer.Add(Floats, Pool<float>().data(), Pool<float>().size());
+  writer.Add(Doubles, Pool<double>().data(), Pool<double>().size());
+  writer.Add(Chars, Pool<char>().data(), Pool<char>().size());
+  freezePool(ByteArrays, TAG::Byte_Array, Pool<TagPayload::ByteArray>());
+  freezePool(IntArrays, TAG::Int_Array, Pool<TagPayload::IntArray>());
+  freezePool(LongArrays, TAG::Long_Array, Pool<TagPayload::LongArray>());
+  freezePool(Strings, TAG::String, Pool<TagPayload::String>());
+  freezePool(Lists, TAG::List, Pool<TagPayload::List>());
+  freezePool(Compounds, TAG::Compound, Pool<TagPayload::Compound>());
+  writer.Add(SharedCompounds, shared.data(), shared.size());
+  writer.Finish();
+}
+
+bool DataStore::Thaw(uint8_t const* data, size_t length, std::shared_ptr<void const> image)
+{
+  Clear();
+  FrozenHeader header;
+  if (length < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, FrozenMagic, sizeof(FrozenMagic)) != 0 || header.version != FrozenVersion || header.byteOrder != FrozenByteOrder ||
+      header.headerSize != sizeof(FrozenHeader) || header.sectionCount != SectionCount || header.imageSize != length)
+    return false;
+  for (uint32_t section = 0; section < SectionCount; ++section)
+  {
+    FrozenSection const& bounds = header.sections[section];
+    size_t const elementSize = SectionElementSize(static_cast<Section>(section));
+    if (bounds.offset % FrozenAlignment != 0 || bounds.offset > length || bounds.count > (length - bounds.offset) / elementSize)
+      return false;
+  }
+  ImageReader const in{ data, header };
+  uint64_t const tagCount = in.Count(Tags);
+  uint64_t const compoundCount = in.Count(StorageOffsets) == 0 ? 0 : in.Count(StorageOffsets) - 1;
+  char const* const names = in.Get<char>(Names);
+  uint64_t const namesLength = in.Count(Names);
+  auto const validName = [&](FrozenName const& name) {
+    return name.offset <= namesLength && name.length <= namesLength - name.offset && IsPayloadType(name.type);
+  };
+
+  in.ThawPool(Bytes, Pool<byte>(), image);
+  in.ThawPool(Shorts, Pool<int16_t>(), image);
+  in.ThawPool(Ints, Pool<int32_t>(), image);
+  in.ThawPool(Longs, Pool<int64_t>(), image);
+  in.ThawPool(Floats, Pool<float>(), image);
+  in.ThawPool(Doubles, Pool<double>(), image);
+  in.ThawPool(Chars, Pool<char>(), image);
+  // sized up front, so payloads can be checked against pools that are filled later
+  Pool<TagPayload::ByteArray>().resize(in.Count(ByteArrays));
+  Pool<TagPayload::IntArray>().resize(in.Count(IntArrays));
+  Pool<TagPayload::LongArray>().resize(in.Count(LongArrays));
+  Pool<TagPayload::String>().resize(in.Count(Strings));
+  Pool<TagPayload::List>().resize(in.Count(Lists));
+  Pool<TagPayload::Compound>().resize(in.Count(Compounds));
+
+  FrozenSchema const* frozenSchemas = in.Get<FrozenSchema>(Schemas);
+  FrozenName const* schemaFields = in.Get<FrozenName>(SchemaFields);
+  schemas.resize(in.Count(Schemas));
+  for (size_t i = 0; i < schemas.size(); ++i)
+  {
+    FrozenSchema const& frozen = frozenSchemas[i];
+    if (frozen.firstField > in.Count(SchemaFields) || frozen.fieldCount > in.Count(SchemaFields) - frozen.firstField)
+      return Clear(), false;
+    for (uint64_t field = frozen.firstField; field < frozen.firstField + frozen.fieldCount; ++field)
+    {
+      FrozenName const& name = schemaFields[field];
+      if (!validName(name))
+        return Clear(), false;
+      schemas[i].names.emplace_back(names + name.offset, name.length);
+      schemas[i].nameHashes.push_back(name.hash);
+      schemas[i].types.push_back(name.type);
+    }
+  }
+
+  FrozenShapedList const* frozenShapedLists = in.Get<FrozenShapedList>(ShapedLists);
+  uint64_t const* columns = in.Get<uint64_t>(Columns);
+  shapedLists.resize(in.Count(ShapedLists));
+  for (size_t i = 0; i < shapedLists.size(); ++i)
+  {
+    FrozenShapedList const& frozen = frozenShapedLists[i];
+    if (frozen.schemaIndex >= schemas.size())
+      return Clear(), false;
+    size_t const fieldCount = schemas[frozen.schemaIndex].names.size();
+    if (frozen.firstColumn > in.Count(Columns) || fieldCount > in.Count(Columns) - frozen.firstColumn)
+      return Clear(), false;
+    shapedLists[i].schemaIndex = frozen.schemaIndex;
+    shapedLists[i].columns.assign(columns + frozen.firstColumn, columns + frozen.firstColumn + fieldCount);
+  }
+
+  auto const poolSize = [this](TAG type) {
+    return Internal::WithPayloadType(type, [this](auto payloadType) { return Pool<typename decltype(payloadType)::Type>().size(); });
+  };
+  auto const fits = [](uint64_t index, int64_t count, size_t size) {
+    return count >= 0 && index <= size && uint64_t(count) <= size - index;
+  };
+  auto const validPayload = [&](TAG type, FrozenPayload const& frozen) {
+    switch (type)
+    {
+      case TAG::Byte_Array: return fits(frozen.index, frozen.count, Pool<byte>().size());
+      case TAG::Int_Array: return fits(frozen.index, frozen.count, Pool<int32_t>().size());
+      case TAG::Long_Array: return fits(frozen.index, frozen.count, Pool<int64_t>().size());
+      case TAG::String: return frozen.count <= std::numeric_limits<uint16_t>::max() && fits(frozen.index, frozen.count, Pool<char>().size());
+      // compounds of shaped lists are made when they are read, and never stored
+      case TAG::Compound: return frozen.count == -1 && frozen.index < compoundCount;
+      case TAG::List:
+      {
+        if (frozen.count < 0)
+          return false;
+        if (frozen.count == 0 || frozen.elementType == TAG::End)
+          return frozen.count == 0 && (frozen.elementType == TAG::End || IsPayloadType(frozen.elementType)) && !frozen.shaped;
+        if (!IsPayloadType(frozen.elementType))
+          return false;
+        if (!frozen.shaped)
+          return fits(frozen.index, frozen.count, poolSize(frozen.elementType));
+        if (frozen.elementType != TAG::Compound || frozen.index >= shapedLists.size())
+          return false;
+        Internal::ShapedList const& list = shapedLists[frozen.index];
+        Internal::CompoundSchema const& schema = schemas[list.schemaIndex];
+        for (size_t field = 0; field < schema.types.size(); ++field)
+        {
+          if (!fits(list.columns[field], frozen.count, poolSize(schema.types[field])))
+            return false;
+        }
+        return true;
+      }
+      default: return true;
+    }
+  };
+
+  auto const thawPool = [&](Section section, TAG type, auto& pool) {
+    using T = typename std::decay_t<decltype(pool)>::value_type;
+    FrozenPayload const* frozen = in.Get<FrozenPayload>(section);
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+      if (!validPayload(type, frozen[i]))
+        return false;
+      pool[i] = ThawPayload(type, frozen[i]).template As<T>();
+    }
+    return true;
+  };
+  if (!thawPool(ByteArrays, TAG::Byte_Array, Pool<TagPayload::ByteArray>()) || !thawPool(IntArrays, TAG::Int_Array, Pool<TagPayload::IntArray>()) ||
+      !thawPool(LongArrays, TAG::Long_Array, Pool<TagPayload::LongArray>()) || !thawPool(Strings, TAG::String, Pool<TagPayload::String>()) ||
+      !thawPool(Lists, TAG::List, Pool<TagPayload::List>()) || !thawPool(Compounds, TAG::Compound, Pool<TagPayload::Compound>()))
+    return Clear(), false;
+
+  uint64_t const* storageOffsets = in.Get<uint64_t>(StorageOffsets);
+  uint64_t const* storageEntries = in.Get<uint64_t>(StorageEntries);
+  compoundStorage.resize(compoundCount);
+  for (size_t i = 0; i < compoundStorage.size(); ++i)
+  {
+    uint64_t const first = storageOffsets[i], last = storageOffsets[i + 1];
+    if (first > last || last > in.Count(StorageEntries))
+      return Clear(), false;
+    compoundStorage[i].reserve(last - first);
+    for (uint64_t entry = first; entry < last; ++entry)
+    {
+      if (storageEntries[entry] >= tagCount)
+        return Clear(), false;
+      compoundStorage[i].emplace_back(storageEntries[entry]);
+    }
+  }
+  uint64_t const* shared = in.Get<uint64_t>(SharedCompounds);
+  for (uint64_t i = 0; i < in.Count(SharedCompounds); ++i)
+  {
+    if (shared[i] >= compoundCount)
+      return Clear(), false;
+    MarkShared(TagPayload::Compound{ shared[i] });
+  }
+
+  // the root compound is always the first tag of a document
+  FrozenTag const* tags = in.Get<FrozenTag>(Tags);
+  if (tagCount == 0 || tags[0].name.type != TAG::Compound)
+    return Clear(), false;
+  namedTags.resize(tagCount);
+  for (size_t i = 0; i < namedTags.size(); ++i)
+  {
+    FrozenTag const& frozen = tags[i];
+    if (!validName(frozen.name) || !validPayload(frozen.name.type, frozen.payload))
+      return Clear(), false;
+    NamedDataTag& tag = namedTags[i];
+    StringView const name{ names + frozen.name.offset, frozen.name.length };
+    if (image)
+      tag.BorrowName(name, frozen.name.hash);
+    else
+      tag.SetName(name, frozen.name.hash);
+    tag.dataTag.type = frozen.name.type;
+    tag.dataTag.payload = ThawPayload(frozen.name.type, frozen.payload);
+  }
+  if (!IsAcyclic(*this))
+    return Clear(), false;
+  frozenImage = std::move(image);
+  return true;
+}
+
+bool Reader::ImportFrozen(uint8_t const* data, size_t length)
+{
+  return ImportFrozen(data, length, nullptr);
+}
+
+bool Reader::ImportFrozen(uint8_t const* data, size_t length, std::shared_ptr<void const> image)
+{
+  memoryStream.Clear();
+  Clear();
+  if (!dataStore.Thaw(data, length, std::move(image)))
+    return false;
+  ContainerInfo root{};
+  root.named = true;
+  root.Type() = TAG::Compound;
+  root.namedContainer.tagIndex = 0;
+  containers.push(root);
+  return true;
+}
+
+bool Reader::ImportFrozenFile(StringView filepath)
+{
+  std::shared_ptr<FileMapping const> const mapping = FileMapping::Open(filepath);
+  if (!mapping || !ImportFrozen(mapping->data, mapping->size, mapping))
+    return false;
+  this->filepath = filepath;
+  return true;
+}
+
+bool Reader::ExportFrozen(std::vector<uint8_t>& out)
+{
+  if (dataStore.namedTags.empty())
+    return false;
+  if (lazyPending)
+    MaterializeAll();
+  dataStore.Freeze(out);
+  return true;
+}
+
+bool Reader::ExportFrozenFile(StringView filepath)
+{
+  std::vector<uint8_t> image;
+  if (!ExportFrozen(image))
+    return false;
+  FILE* file = fopen(std::string(filepath).c_str(), "wb");
+  if (!file)
+    return false;
+  size_t const written = fwrite(image.data(), sizeof(uint8_t), image.size(), file);
+  fclose(file);
+  return written == image.size();
+}
+
+} // namespace ImNBT
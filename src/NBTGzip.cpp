@@ -0,0 +1,146 @@
+#include "gzipmembers.h"
+#include "parallel.h"
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace ImNBT::Internal
+{
+
+namespace
+{
+
+// a member header: the gzip magic, deflate, an extra field and no other flags, no time, unknown system.
+// The extra field holds one subfield, "IN", with the compressed size of the whole member
+constexpr size_t HeaderSize = 20;
+constexpr size_t TrailerSize = 8;
+constexpr uint8_t HeaderStart[] = { 0x1f, 0x8b, 8, 0x04, 0, 0, 0, 0, 0, 255, 8, 0, 'I', 'N', 4, 0 };
+// deflate codes at most 258 bytes in a match of about 2 bits, so no member inflates to more than this many times its deflate data
+constexpr size_t MaxDeflateRatio = 1032;
+
+void StoreLittleEndian(uint8_t* out, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t LoadLittleEndian(uint8_t const* in)
+{
+  return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+bool CompressMember(uint8_t const* data, size_t size, std::vector<uint8_t>& member)
+{
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  size_t const bound = deflateBound(&zs, static_cast<unsigned long>(size));
+  member.resize(HeaderSize + bound + TrailerSize);
+  zs.next_in = const_cast<Bytef*>(data);
+  zs.avail_in = static_cast<uInt>(size);
+  zs.next_out = member.data() + HeaderSize;
+  zs.avail_out = static_cast<uInt>(bound);
+  int const result = deflate(&zs, Z_FINISH);
+  deflateEnd(&zs);
+  if (result != Z_STREAM_END)
+    return false;
+  member.resize(HeaderSize + zs.total_out + TrailerSize);
+  std::memcpy(member.data(), HeaderStart, sizeof(HeaderStart));
+  StoreLittleEndian(member.data() + sizeof(HeaderStart), static_cast<uint32_t>(member.size()));
+  uint8_t* const trailer = member.data() + member.size() - TrailerSize;
+  StoreLittleEndian(trailer, static_cast<uint32_t>(crc32(0, data, static_cast<uInt>(size))));
+  StoreLittleEndian(trailer + 4, static_cast<uint32_t>(size));
+  return true;
+}
+
+bool DecompressMember(uint8_t const* member, size_t size, uint8_t* out, size_t outSize)
+{
+  z_stream zs{};
+  if (inflateInit2(&zs, -15) != Z_OK)
+    return false;
+  zs.next_in = const_cast<Bytef*>(member + HeaderSize);
+  zs.avail_in = static_cast<uInt>(size - HeaderSize - TrailerSize);
+  zs.next_out = out;
+  zs.avail_out = static_cast<uInt>(outSize);
+  int const result = inflate(&zs, Z_FINISH);
+  inflateEnd(&zs);
+  // the deflate data must fill the member and its output exactly
+  if (result != Z_STREAM_END || zs.avail_in != 0 || zs.avail_out != 0)
+    return false;
+  return crc32(0, out, static_cast<uInt>(outSize)) == LoadLittleEndian(member + size - TrailerSize);
+}
+
+} // namespace
+
+std::vector<std::vector<uint8_t>> CompressGzipMembers(uint8_t const* data, size_t size, unsigned threads)
+{
+  std::vector<std::vector<uint8_t>> members((size + GzipMemberSize - 1) / GzipMemberSize);
+  std::atomic<bool> failed{ false };
+  ParallelFor(members.size(), threads, [&](size_t member) {
+    size_t const first = member * GzipMemberSize;
+    if (!CompressMember(data + first, std::min(GzipMemberSize, size - first), members[member]))
+      failed = true;
+  });
+  if (failed)
+    members.clear();
+  return members;
+}
+
+bool IsGzipMembers(uint8_t const* data)
+{
+  static_assert(sizeof(HeaderStart) == GzipMembersSignatureSize);
+  return std::memcmp(data, HeaderStart, sizeof(HeaderStart)) == 0;
+}
+
+bool DecompressGzipMembers(uint8_t const* data, size_t size, std::vector<uint8_t>& out, unsigned threads)
+{
+  struct Member
+  {
+    size_t offset;
+    size_t size;
+    size_t outOffset;
+    size_t outSize;
+  };
+  // every member must have been written by CompressGzipMembers(), so its size is known from its header
+  std::vector<Member> members;
+  size_t outSize = 0;
+  for (size_t offset = 0; offset < size;)
+  {
+    if (size - offset < HeaderSize + TrailerSize || std::memcmp(data + offset, HeaderStart, sizeof(HeaderStart)) != 0)
+      return false;
+    size_t const memberSize = LoadLittleEndian(data + offset + sizeof(HeaderStart));
+    if (memberSize < HeaderSize + TrailerSize || memberSize > size - offset)
+      return false;
+    // the sizes in the trailers are checked before anything is allocated for them, only the last member may be short
+    size_t const memberOutSize = LoadLittleEndian(data + offset + memberSize - 4);
+    if (memberOutSize > GzipMemberSize || memberOutSize > (memberSize - HeaderSize - TrailerSize) * MaxDeflateRatio)
+      return false;
+    if (!members.empty() && members.back().outSize != GzipMemberSize)
+      return false;
+    members.push_back({ offset, memberSize, outSize, memberOutSize });
+    outSize += memberOutSize;
+    offset += memberSize;
+  }
+  if (members.empty())
+    return false;
+
+  size_t const base = out.size();
+  out.resize(base + outSize);
+  std::atomic<bool> failed{ false };
+  ParallelFor(members.size(), threads, [&](size_t index) {
+    Member const& member = members[index];
+    if (!DecompressMember(data + member.offset, member.size, out.data() + base + member.outOffset, member.outSize))
+      failed = true;
+  });
+  if (failed)
+  {
+    out.resize(base);
+    return false;
+  }
+  return true;
+}
+
+} // namespace ImNBT::Internal
@@ -0,0 +1,421 @@
+#include <ImNBT/NBTRepresentation.hpp>
+
+#include "byteswapping.h"
+#include "hashbytes.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace ImNBT
+{
+
+namespace
+{
+
+// xxHash64 (https://github.com/Cyan4973/xxHash), which hashes 32 bytes per round
+
+constexpr uint64_t Prime1 = 11400714785074694791ull;
+constexpr uint64_t Prime2 = 14029467366897019727ull;
+constexpr uint64_t Prime3 = 1609587929392839161ull;
+constexpr uint64_t Prime4 = 9650029242287828579ull;
+constexpr uint64_t Prime5 = 2870177450012600261ull;
+
+uint64_t RotateLeft(uint64_t x, int bits)
+{
+  return (x << bits) | (x >> (64 - bits));
+}
+
+uint64_t Load64(uint8_t const* p)
+{
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Load32(uint8_t const* p)
+{
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * Prime2;
+  return RotateLeft(accumulator, 31) * Prime1;
+}
+
+uint64_t Merge(uint64_t hash, uint64_t accumulator)
+{
+  hash ^= Round(0, accumulator);
+  return hash * Prime1 + Prime4;
+}
+
+// mixes one more 8 byte value into a hash, in an order-sensitive way
+uint64_t Step(uint64_t hash, uint64_t value)
+{
+  hash ^= Round(0, value);
+  return RotateLeft(hash, 27) * Prime1 + Prime4;
+}
+
+uint64_t Avalanche(uint64_t hash)
+{
+  hash ^= hash >> 33;
+  hash *= Prime2;
+  hash ^= hash >> 29;
+  hash *= Prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+} // namespace
+
+uint64_t Internal::HashBytes(void const* data, size_t size, uint64_t seed)
+{
+  uint8_t const* p = static_cast<uint8_t const*>(data);
+  uint8_t const* const end = p + size;
+  uint64_t hash;
+  if (size >= 32)
+  {
+    uint64_t v1 = seed + Prime1 + Prime2;
+    uint64_t v2 = seed + Prime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - Prime1;
+    do
+    {
+      v1 = Round(v1, Load64(p));
+      v2 = Round(v2, Load64(p + 8));
+      v3 = Round(v3, Load64(p + 16));
+      v4 = Round(v4, Load64(p + 24));
+      p += 32;
+    } while (end - p >= 32);
+    hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+    hash = Merge(hash, v1);
+    hash = Merge(hash, v2);
+    hash = Merge(hash, v3);
+    hash = Merge(hash, v4);
+  }
+  else
+  {
+    hash = seed + Prime5;
+  }
+  hash += size;
+  for (; end - p >= 8; p += 8)
+    hash = Step(hash, Load64(p));
+  if (end - p >= 4)
+  {
+    hash ^= Load32(p) * Prime1;
+    hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+    p += 4;
+  }
+  for (; p < end; ++p)
+  {
+    hash ^= *p * Prime5;
+    hash = RotateLeft(hash, 11) * Prime1;
+  }
+  return Avalanche(hash);
+}
+
+namespace
+{
+
+using Internal::HashBytes;
+
+int32_t Swapped(int32_t value) { return swap_i32(value); }
+int64_t Swapped(int64_t value) { return swap_i64(value); }
+
+Internal::ContentHashes CachedHashes(DataStore const& store, TagPayload::Compound const& compound)
+{
+  if (compound.shapedRow_ >= 0)
+  {
+    auto const& rowHashes = store.shapedLists[compound.storageIndex_].rowHashes;
+    return static_cast<size_t>(compound.shapedRow_) < rowHashes.size() ? rowHashes[compound.shapedRow_] : Internal::ContentHashes{};
+  }
+  if (compound.storageIndex_ >= store.compoundHashes.size())
+    return {};
+  return store.compoundHashes[compound.storageIndex_];
+}
+
+/**
+ * Hashes tags from their type and contents, so equal tags hash equal whichever store holds them and however it keeps them.
+ * Compounds hash their entries in stored order, or sorted by name for canonical hashes.
+ */
+
+struct Hasher
+{
+  DataStore const& store;
+  // if set, the store the compound hashes computed are cached in
+  DataStore* cache;
+  bool canonical;
+
+  uint64_t Hash(DataTag const& tag) const
+  {
+    uint64_t const seed = static_cast<uint64_t>(tag.type);
+    switch (tag.type)
+    {
+      case TAG::String: {
+        auto const& string = tag.payload.As<TagPayload::String>();
+        return HashBytes(store.Pool<char>().data() + string.poolIndex_, string.length_, seed);
+      }
+      case TAG::Byte_Array: {
+        auto const& array = tag.payload.As<TagPayload::ByteArray>();
+        return Values<byte>(array.poolIndex_, array.count_, seed);
+      }
+      case TAG::Int_Array: {
+        auto const& array = tag.payload.As<TagPayload::IntArray>();
+        return BigEndian<int32_t>(array.poolIndex_, array.count_, seed);
+      }
+      case TAG::Long_Array: {
+        auto const& array = tag.payload.As<TagPayload::LongArray>();
+        return BigEndian<int64_t>(array.poolIndex_, array.count_, seed);
+      }
+      case TAG::List: return List(tag.payload.As<TagPayload::List>());
+      case TAG::Compound: return Compound(tag.payload.As<TagPayload::Compound>());
+      default:
+        return Internal::WithPayloadType(tag.type, [&](auto type) {
+          using T = typename decltype(type)::Type;
+          T const& value = tag.payload.As<T>();
+          return HashBytes(&value, sizeof(T), seed);
+        });
+    }
+  }
+
+  template<typename T>
+  uint64_t Values(size_t poolIndex, int32_t count, uint64_t seed) const
+  {
+    if (count == 0)
+      return HashBytes(nullptr, 0, seed);
+    return HashBytes(store.Pool<T>().data() + poolIndex, sizeof(T) * count, seed);
+  }
+
+  // int and long arrays hash as they are in files, whichever order the store keeps them in
+  template<typename T>
+  uint64_t BigEndian(size_t poolIndex, int32_t count, uint64_t seed) const
+  {
+    if (store.bigEndianArrays || count == 0)
+      return Values<T>(poolIndex, count, seed);
+    T const* values = store.Pool<T>().data() + poolIndex;
+    std::vector<T> swapped(count);
+    for (int32_t i = 0; i < count; ++i)
+      swapped[i] = Swapped(values[i]);
+    return HashBytes(swapped.data(), sizeof(T) * count, seed);
+  }
+
+  uint64_t List(TagPayload::List const& list) const
+  {
+    // empty lists are written with no element type
+    TAG const elementType = list.count_ == 0 ? TAG::End : list.elementType_;
+    uint64_t hash = Step(Step(static_cast<uint64_t>(TAG::List) + Prime5, static_cast<uint64_t>(elementType)), list.count_);
+    switch (elementType)
+    {
+      case TAG::Byte: return Values<byte>(list.poolIndex_, list.count_, hash);
+      case TAG::Short: return Values<int16_t>(list.poolIndex_, list.count_, hash);
+      case TAG::Int: return Values<int32_t>(list.poolIndex_, list.count_, hash);
+      case TAG::Long: return Values<int64_t>(list.poolIndex_, list.count_, hash);
+      case TAG::Float: return Values<float>(list.poolIndex_, list.count_, hash);
+      case TAG::Double: return Values<double>(list.poolIndex_, list.count_, hash);
+      default:
+        for (int32_t i = 0; i < list.count_; ++i)
+          hash = Step(hash, Hash(store.ListElement(list, i)));
+        return Avalanche(hash);
+    }
+  }
+
+  uint64_t Compound(TagPayload::Compound const& compound) const
+  {
+    Internal::ContentHashes const cached = CachedHashes(store, compound);
+    if ((canonical ? cached.canonical : cached.stored) != 0)
+      return canonical ? cached.canonical : cached.stored;
+
+    uint64_t hash = Step(static_cast<uint64_t>(TAG::Compound) + Prime5, store.EntryCount(compound));
+    auto const addEntry = [&](StringView name, DataTag const& entry) {
+      hash = Step(hash, HashBytes(name.data(), name.size(), Hash(entry)));
+    };
+    if (canonical)
+    {
+      for (auto const& [name, entry] : store.SortedEntries(compound))
+        addEntry(name, entry);
+    }
+    else if (compound.shapedRow_ >= 0)
+    {
+      // hashing a field may cache hashes in shapedLists, which can move the list, so it is looked up for each field
+      size_t const fieldCount = store.EntryCount(compound);
+      for (size_t field = 0; field < fieldCount; ++field)
+      {
+        Internal::ShapedList const& list = store.shapedLists[compound.storageIndex_];
+        addEntry(store.schemas[list.schemaIndex].names[field], store.ShapedEntry(list, compound.shapedRow_, field));
+      }
+    }
+    else
+    {
+      store.ForEachEntry(compound, addEntry);
+    }
+    // 0 marks hashes that are not cached yet
+    hash = Avalanche(hash);
+    if (hash == 0)
+      hash = 1;
+
+    if (cache)
+    {
+      Internal::ContentHashes* hashes;
+      if (compound.shapedRow_ >= 0)
+      {
+        auto& rowHashes = cache->shapedLists[compound.storageIndex_].rowHashes;
+        if (rowHashes.size() <= static_cast<size_t>(compound.shapedRow_))
+          rowHashes.resize(compound.shapedRow_ + 1);
+        hashes = &rowHashes[compound.shapedRow_];
+      }
+      else
+      {
+        if (store.compoundHashes.size() <= compound.storageIndex_)
+          cache->compoundHashes.resize(store.compoundStorage.size());
+        hashes = &cache->compoundHashes[compound.storageIndex_];
+      }
+      (canonical ? hashes->canonical : hashes->stored) = hash;
+    }
+    return hash;
+  }
+};
+
+struct Comparer
+{
+  DataStore const& a;
+  DataStore const& b;
+  // compound entries must be in the same order
+  bool ordered;
+
+  bool Equal(DataTag const& x, DataTag const& y) const
+  {
+    if (x.type != y.type)
+      return false;
+    switch (x.type)
+    {
+      case TAG::String: {
+        auto const& first = x.payload.As<TagPayload::String>();
+        auto const& second = y.payload.As<TagPayload::String>();
+        return first.length_ == second.length_ && Values<char>(first.poolIndex_, second.poolIndex_, first.length_);
+      }
+      case TAG::Byte_Array: {
+        auto const& first = x.payload.As<TagPayload::ByteArray>();
+        auto const& second = y.payload.As<TagPayload::ByteArray>();
+        return first.count_ == second.count_ && Values<byte>(first.poolIndex_, second.poolIndex_, first.count_);
+      }
+      case TAG::Int_Array: {
+        auto const& first = x.payload.As<TagPayload::IntArray>();
+        auto const& second = y.payload.As<TagPayload::IntArray>();
+        return first.count_ == second.count_ && Arrays<int32_t>(first.poolIndex_, second.poolIndex_, first.count_);
+      }
+      case TAG::Long_Array: {
+        auto const& first = x.payload.As<TagPayload::LongArray>();
+        auto const& second = y.payload.As<TagPayload::LongArray>();
+        return first.count_ == second.count_ && Arrays<int64_t>(first.poolIndex_, second.poolIndex_, first.count_);
+      }
+      case TAG::List: return List(x.payload.As<TagPayload::List>(), y.payload.As<TagPayload::List>());
+      case TAG::Compound: return Compound(x.payload.As<TagPayload::Compound>(), y.payload.As<TagPayload::Compound>());
+      default:
+        return Internal::WithPayloadType(x.type, [&](auto type) {
+          using T = typename decltype(type)::Type;
+          return std::memcmp(&x.payload.As<T>(), &y.payload.As<T>(), sizeof(T)) == 0;
+        });
+    }
+  }
+
+  template<typename T>
+  bool Values(size_t first, size_t second, size_t count) const
+  {
+    if (count == 0 || (&a == &b && first == second))
+      return true;
+    return std::memcmp(a.Pool<T>().data() + first, b.Pool<T>().data() + second, sizeof(T) * count) == 0;
+  }
+
+  template<typename T>
+  bool Arrays(size_t first, size_t second, int32_t count) const
+  {
+    if (a.bigEndianArrays == b.bigEndianArrays)
+      return Values<T>(first, second, count);
+    T const* firstValues = a.Pool<T>().data() + first;
+    T const* secondValues = b.Pool<T>().data() + second;
+    for (int32_t i = 0; i < count; ++i)
+    {
+      if (firstValues[i] != Swapped(secondValues[i]))
+        return false;
+    }
+    return true;
+  }
+
+  bool List(TagPayload::List const& x, TagPayload::List const& y) const
+  {
+    if (x.count_ != y.count_)
+      return false;
+    if (x.count_ == 0)
+      return true;
+    if (x.elementType_ != y.elementType_)
+      return false;
+    if (&a == &b && x.poolIndex_ == y.poolIndex_ && x.shaped_ == y.shaped_)
+      return true;
+    switch (x.elementType_)
+    {
+      case TAG::Byte: return Values<byte>(x.poolIndex_, y.poolIndex_, x.count_);
+      case TAG::Short: return Values<int16_t>(x.poolIndex_, y.poolIndex_, x.count_);
+      case TAG::Int: return Values<int32_t>(x.poolIndex_, y.poolIndex_, x.count_);
+      case TAG::Long: return Values<int64_t>(x.poolIndex_, y.poolIndex_, x.count_);
+      case TAG::Float: return Values<float>(x.poolIndex_, y.poolIndex_, x.count_);
+      case TAG::Double: return Values<double>(x.poolIndex_, y.poolIndex_, x.count_);
+      default:
+        for (int32_t i = 0; i < x.count_; ++i)
+        {
+          if (!Equal(a.ListElement(x, i), b.ListElement(y, i)))
+            return false;
+        }
+        return true;
+    }
+  }
+
+  bool Compound(TagPayload::Compound const& x, TagPayload::Compound const& y) const
+  {
+    if (&a == &b && x.storageIndex_ == y.storageIndex_ && x.shapedRow_ == y.shapedRow_)
+      return true;
+    if (a.EntryCount(x) != b.EntryCount(y))
+      return false;
+    // compounds hashed by an editor are told apart without visiting their entries
+    Internal::ContentHashes const first = CachedHashes(a, x);
+    Internal::ContentHashes const second = CachedHashes(b, y);
+    if (first.canonical != 0 && second.canonical != 0 && first.canonical != second.canonical)
+      return false;
+    if (ordered && first.stored != 0 && second.stored != 0 && first.stored != second.stored)
+      return false;
+
+    bool equal = true;
+    size_t positionHint = 0;
+    a.ForEachEntry(x, [&](StringView name, DataTag const& entry) {
+      if (!equal)
+        return;
+      // compounds of the same kind tend to keep their entries in the same order
+      size_t const position = positionHint;
+      Internal::EntryLocation const other = b.Locate(y, name, positionHint);
+      equal = other.type == entry.type && (!ordered || positionHint == position) && Equal(entry, b.EntryTag(other));
+      ++positionHint;
+    });
+    return equal;
+  }
+};
+
+} // namespace
+
+uint64_t DataStore::ContentHash(DataTag const& tag, bool canonical) const
+{
+  return Hasher{ *this, nullptr, canonical }.Hash(tag);
+}
+
+uint64_t DataStore::ContentHash(DataTag const& tag, bool canonical)
+{
+  return Hasher{ std::as_const(*this), this, canonical }.Hash(tag);
+}
+
+bool DataStore::ContentEquals(DataTag const& tag, DataStore const& other, DataTag const& otherTag, bool ordered) const
+{
+  return Comparer{ *this, other, ordered }.Equal(tag, otherTag);
+}
+
+} // namespace ImNBT
@@ -0,0 +1,619 @@
+#include <ImNBT/NBTIndex.hpp>
+#include <ImNBT/NBTVisitor.hpp>
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
+
+namespace ImNBT
+{
+
+namespace
+{
+
+constexpr char IndexMagic[8] = { 'I', 'M', 'N', 'B', 'T', 'I', 'D', 'X' };
+constexpr uint32_t IndexVersion = 1;
+
+// the file hash covers this many evenly spaced blocks, including the first and last
+constexpr uint64_t HashSamples = 18;
+constexpr size_t HashSampleSize = 4096;
+
+uint64_t HashBytes(uint64_t hash, uint8_t const* data, size_t length)
+{
+  // 64 bit FNV-1a
+  for (size_t i = 0; i < length; ++i)
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  return hash;
+}
+
+// seeks to an offset from the start of the file, which may lie past 2 GiB where long is 32 bits
+bool SeekTo(FILE* file, uint64_t offset)
+{
+#if defined(_WIN32)
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+std::string QuoteKey(StringView key)
+{
+  if (!key.empty() && key != "*" && key.find_first_of(".[]\"") == StringView::npos)
+    return std::string(key);
+  std::string quoted = "\"";
+  for (char c : key)
+  {
+    if (c == '"' || c == '\\')
+      quoted += '\\';
+    quoted += c;
+  }
+  return quoted + '"';
+}
+
+// index files are little endian
+template<typename T>
+void Put(std::vector<uint8_t>& out, T value)
+{
+  for (size_t i = 0; i < sizeof(T); ++i)
+    out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+}
+
+struct IndexInput
+{
+  std::vector<uint8_t> const& data;
+  size_t position = 0;
+
+  template<typename T>
+  bool Get(T& value)
+  {
+    if (data.size() - position < sizeof(T))
+      return false;
+    uint64_t bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+      bits |= uint64_t(data[position + i]) << (8 * i);
+    value = static_cast<T>(bits);
+    position += sizeof(T);
+    return true;
+  }
+  uint8_t const* Bytes(size_t count)
+  {
+    if (data.size() - position < count)
+      return nullptr;
+    position += count;
+    return data.data() + position - count;
+  }
+};
+
+bool ReadFile(StringView filepath, std::vector<uint8_t>& out)
+{
+  FILE* file = fopen(std::string(filepath).c_str(), "rb");
+  if (!file)
+    return false;
+  std::array<uint8_t, 8192> buffer;
+  size_t read;
+  while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0)
+    out.insert(out.end(), buffer.begin(), buffer.begin() + read);
+  bool const failed = ferror(file) != 0;
+  fclose(file);
+  return !failed;
+}
+
+// records the offsets of the tags near the root while a file is visited
+template<typename Source>
+struct IndexingVisitor : VisitorBase
+{
+  struct Open
+  {
+    std::string path;
+    uint64_t offset;
+    bool list;
+    int32_t nextElement;
+  };
+
+  Source& source;
+  int depth;
+  std::unordered_map<std::string, OffsetIndex::Entry>& entries;
+  std::vector<Open> open;
+
+  IndexingVisitor(Source& source, int depth, std::unordered_map<std::string, OffsetIndex::Entry>& entries)
+    : source(source), depth(depth), entries(entries)
+  {
+  }
+
+  // path of the next tag of the innermost container, empty if it is too deep to be indexed
+  std::string ChildPath(StringView name)
+  {
+    Open& parent = open.back();
+    if (parent.list)
+      return parent.path + '[' + std::to_string(parent.nextElement++) + ']';
+    if (parent.path.empty())
+      return QuoteKey(name);
+    return parent.path + '.' + QuoteKey(name);
+  }
+
+  // the visitor is called before a tag's header is consumed, so the source is at its start
+  Visit Add(TAG type, StringView name, uint64_t size)
+  {
+    if (static_cast<int>(open.size()) > depth)
+      return Visit::Continue;
+    bool const named = !open.back().list;
+    entries[ChildPath(name)] = { source.Position(), size + (named ? 3 + name.size() : 0), type, named };
+    return Visit::Continue;
+  }
+
+  Visit Begin(TAG type, StringView name)
+  {
+    if (open.empty())
+    {
+      open.push_back({ std::string(), source.Position(), false, 0 });
+      return Visit::Continue;
+    }
+    if (static_cast<int>(open.size()) > depth)
+      return Visit::Skip;
+    std::string path = ChildPath(name);
+    open.push_back({ std::move(path), source.Position(), type == TAG::List, 0 });
+    return Visit::Continue;
+  }
+  Visit End(TAG type)
+  {
+    Open const closed = open.back();
+    open.pop_back();
+    if (open.empty())
+      return Visit::Stop;
+    bool const named = !open.back().list;
+    entries[closed.path] = { closed.offset, source.Position() - closed.offset, type, named };
+    return Visit::Continue;
+  }
+
+  Visit BeginCompound(StringView name) { return Begin(TAG::Compound, name); }
+  Visit EndCompound() { return End(TAG::Compound); }
+  Visit BeginList(StringView name, TAG, int32_t) { return Begin(TAG::List, name); }
+  Visit EndList() { return End(TAG::List); }
+
+  Visit Byte(StringView name, int8_t) { return Add(TAG::Byte, name, 1); }
+  Visit Short(StringView name, int16_t) { return Add(TAG::Short, name, 2); }
+  Visit Int(StringView name, int32_t) { return Add(TAG::Int, name, 4); }
+  Visit Long(StringView name, int64_t) { return Add(TAG::Long, name, 8); }
+  Visit Float(StringView name, float) { return Add(TAG::Float, name, 4); }
+  Visit Double(StringView name, double) { return Add(TAG::Double, name, 8); }
+  Visit String(StringView name, StringView value) { return Add(TAG::String, name, 2 + value.size()); }
+  Visit ByteArray(StringView name, ArrayView<int8_t> value) { return Add(TAG::Byte_Array, name, 4 + value.Size()); }
+  Visit IntArray(StringView name, ArrayView<int32_t> value) { return Add(TAG::Int_Array, name, 4 + 4 * uint64_t(value.Size())); }
+  Visit LongArray(StringView name, ArrayView<int64_t> value) { return Add(TAG::Long_Array, name, 4 + 8 * uint64_t(value.Size())); }
+};
+
+using InputBuffer = std::array<uint8_t, 16384>;
+
+// moves the unread input to the front of the buffer and reads after it until at least count bytes are available
+bool RefillInput(z_stream& stream, InputBuffer& input, FILE* file, size_t count)
+{
+  if (stream.avail_in > 0)
+    std::memmove(input.data(), stream.next_in, stream.avail_in);
+  stream.next_in = input.data();
+  while (stream.avail_in < count)
+  {
+    size_t const read = fread(input.data() + stream.avail_in, 1, input.size() - stream.avail_in, file);
+    if (read == 0)
+      return false;
+    stream.avail_in += static_cast<uInt>(read);
+  }
+  return true;
+}
+
+// starts on the next member of a gzip file once a member has ended, as a file saved on several threads holds one per MiB.
+// A raw stream has not read the trailer of the member yet. Returns false at the end of the file or after a zlib stream
+bool NextMember(z_stream& stream, InputBuffer& input, FILE* file, bool raw)
+{
+  size_t const trailer = raw ? 8 : 0;
+  if (!RefillInput(stream, input, file, trailer + 2))
+    return false;
+  stream.next_in += trailer;
+  stream.avail_in -= static_cast<uInt>(trailer);
+  if (stream.next_in[0] != 0x1f || stream.next_in[1] != 0x8b)
+    return false;
+  return (raw ? inflateReset2(&stream, 31) : inflateReset(&stream)) == Z_OK;
+}
+
+} // namespace
+
+// inflates a gzip or zlib stream for the visitor, adding a checkpoint at the first block boundary after every spacing bytes of output
+class OffsetIndex::InflateSource
+{
+public:
+  InflateSource(FILE* file, size_t spacing, std::vector<Checkpoint>& checkpoints)
+    : file(file), spacing(spacing), checkpoints(checkpoints)
+  {
+    // 32 + 15 detects a gzip or zlib header
+    initialized = inflateInit2(&stream, 47) == Z_OK;
+  }
+  ~InflateSource()
+  {
+    if (initialized)
+      inflateEnd(&stream);
+  }
+  InflateSource(InflateSource const&) = delete;
+  InflateSource& operator=(InflateSource const&) = delete;
+
+  uint8_t const* Peek(size_t count)
+  {
+    if (end - begin < count && !Fill(count))
+      return nullptr;
+    return buffer.data() + begin;
+  }
+  void Advance(size_t count) { begin += count; }
+  bool Skip(size_t count)
+  {
+    while (count > 0)
+    {
+      if (begin == end && !Fill(1))
+        return false;
+      size_t const buffered = std::min(count, end - begin);
+      begin += buffered;
+      count -= buffered;
+    }
+    return true;
+  }
+  size_t Position() const { return consumed + begin; }
+
+private:
+  FILE* file;
+  size_t spacing;
+  std::vector<Checkpoint>& checkpoints;
+  z_stream stream{};
+  bool initialized = false;
+  bool finished = false;
+  InputBuffer input;
+  std::vector<uint8_t> window = std::vector<uint8_t>(WindowSize);
+  uint64_t totalIn = 0;
+  uint64_t totalOut = 0;
+
+  std::vector<uint8_t> buffer;
+  size_t begin = 0;
+  size_t end = 0;
+  size_t consumed = 0;
+
+  bool Fill(size_t count)
+  {
+    consumed += begin;
+    std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+    end -= begin;
+    begin = 0;
+    while (end < count)
+    {
+      if (!Inflate())
+        return false;
+    }
+    return true;
+  }
+
+  bool Inflate()
+  {
+    if (!initialized || finished)
+      return false;
+    if (stream.avail_in == 0)
+    {
+      stream.avail_in = static_cast<uInt>(fread(input.data(), 1, input.size(), file));
+      stream.next_in = input.data();
+      if (stream.avail_in == 0)
+        return false;
+    }
+    // the output goes round the window, so it always holds the last 32 KiB for a checkpoint
+    if (stream.avail_out == 0)
+    {
+      stream.avail_out = static_cast<uInt>(WindowSize);
+      stream.next_out = window.data();
+    }
+    uint8_t* const from = stream.next_out;
+    uInt const availableIn = stream.avail_in;
+    int const result = inflate(&stream, Z_BLOCK);
+    if (result != Z_OK && result != Z_STREAM_END)
+      return false;
+    totalIn += availableIn - stream.avail_in;
+    size_t const produced = stream.next_out - from;
+    totalOut += produced;
+    if (buffer.size() < end + produced)
+      buffer.resize(std::max(end + produced, buffer.size() * 2));
+    std::copy(from, stream.next_out, buffer.begin() + end);
+    end += produced;
+
+    if (result == Z_STREAM_END)
+      finished = !NextMember(stream, input, file, false);
+    // at the end of a block that is not the last one, also right after the header
+    else if ((stream.data_type & 128) && !(stream.data_type & 64) && (checkpoints.empty() || totalOut - checkpoints.back().out >= spacing))
+      AddCheckpoint();
+    return true;
+  }
+
+  void AddCheckpoint()
+  {
+    Checkpoint checkpoint{ totalIn, totalOut, static_cast<uint8_t>(stream.data_type & 7), std::vector<uint8_t>(WindowSize) };
+    size_t const left = stream.avail_out;
+    std::copy(window.end() - left, window.end(), checkpoint.window.begin());
+    std::copy(window.begin(), window.end() - left, checkpoint.window.begin() + left);
+    checkpoints.push_back(std::move(checkpoint));
+  }
+};
+
+Optional<OffsetIndex> OffsetIndex::Build(StringView filepath, int depth, size_t checkpointSpacing)
+{
+  OffsetIndex index;
+  index.filepath = std::string(filepath);
+  FILE* file = fopen(index.filepath.c_str(), "rb");
+  if (!file)
+    return std::nullopt;
+  uint8_t header[2] = {};
+  size_t const headerLength = fread(header, 1, 2, file);
+  rewind(file);
+  bool const gzip = headerLength == 2 && header[0] == 0x1f && header[1] == 0x8b;
+  bool const zlib = headerLength == 2 && (header[0] & 0x0f) == Z_DEFLATED && (header[0] * 256 + header[1]) % 31 == 0;
+  index.compressed = gzip || zlib;
+
+  bool visited;
+  if (index.compressed)
+  {
+    InflateSource source{ file, checkpointSpacing, index.checkpoints };
+    IndexingVisitor<InflateSource> visitor{ source, depth, index.entries };
+    visited = Internal::BinaryVisit<InflateSource, IndexingVisitor<InflateSource>>{ source, visitor }.Run();
+    fclose(file);
+  }
+  else
+  {
+    fclose(file);
+    FileSource source{ filepath };
+    IndexingVisitor<FileSource> visitor{ source, depth, index.entries };
+    visited = source.IsOpen() && Internal::BinaryVisit<FileSource, IndexingVisitor<FileSource>>{ source, visitor }.Run();
+  }
+  if (!visited)
+    return std::nullopt;
+
+  Optional<FileStamp> const stamp = StampFile(filepath, true);
+  if (!stamp)
+    return std::nullopt;
+  index.stamp = *stamp;
+  return index;
+}
+
+Optional<OffsetIndex::FileStamp> OffsetIndex::StampFile(StringView filepath, bool hash)
+{
+  std::error_code error;
+  std::filesystem::path const path{ std::string(filepath) };
+  FileStamp stamp;
+  stamp.size = std::filesystem::file_size(path, error);
+  if (error)
+    return std::nullopt;
+  stamp.modified = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+  if (error)
+    return std::nullopt;
+  if (!hash)
+    return stamp;
+
+  FILE* file = fopen(std::string(filepath).c_str(), "rb");
+  if (!file)
+    return std::nullopt;
+  stamp.hash = 0xcbf29ce484222325ull;
+  std::array<uint8_t, HashSampleSize> sample;
+  uint64_t const last = stamp.size > HashSampleSize ? stamp.size - HashSampleSize : 0;
+  for (uint64_t i = 0; i < HashSamples; ++i)
+  {
+    if (!SeekTo(file, last * i / (HashSamples - 1)))
+      break;
+    size_t const read = fread(sample.data(), 1, sample.size(), file);
+    stamp.hash = HashBytes(stamp.hash, sample.data(), read);
+  }
+  fclose(file);
+  return stamp;
+}
+
+bool OffsetIndex::IsCurrent() const
+{
+  Optional<FileStamp> const current = StampFile(filepath, true);
+  return current && *current == stamp;
+}
+
+OffsetIndex::Entry const* OffsetIndex::Find(StringView path) const
+{
+  auto const it = entries.find(std::string(path));
+  return it != entries.end() ? &it->second : nullptr;
+}
+
+bool OffsetIndex::Read(Entry const& entry, std::vector<uint8_t>& out) const
+{
+  FILE* file = fopen(filepath.c_str(), "rb");
+  if (!file)
+    return false;
+  out.resize(entry.size);
+  if (!compressed)
+  {
+    bool const read = SeekTo(file, entry.offset) && fread(out.data(), 1, out.size(), file) == out.size();
+    fclose(file);
+    return read;
+  }
+
+  auto const next = std::upper_bound(checkpoints.begin(), checkpoints.end(), entry.offset, [](uint64_t offset, Checkpoint const& checkpoint) { return offset < checkpoint.out; });
+  if (next == checkpoints.begin())
+  {
+    fclose(file);
+    return false;
+  }
+  Checkpoint const& checkpoint = *(next - 1);
+
+  // resume raw inflation at the checkpoint, priming the bits of its first byte that belong to the next block
+  z_stream stream{};
+  bool ok = inflateInit2(&stream, -15) == Z_OK;
+  if (ok && !SeekTo(file, checkpoint.in - (checkpoint.bits ? 1 : 0)))
+    ok = false;
+  if (ok && checkpoint.bits)
+  {
+    int const byte = getc(file);
+    ok = byte != EOF && inflatePrime(&stream, checkpoint.bits, byte >> (8 - checkpoint.bits)) == Z_OK;
+  }
+  ok = ok && inflateSetDictionary(&stream, checkpoint.window.data(), static_cast<uInt>(checkpoint.window.size())) == Z_OK;
+
+  InputBuffer input;
+  std::vector<uint8_t> discard(WindowSize);
+  bool raw = true;
+  uint64_t skip = entry.offset - checkpoint.out;
+  size_t produced = 0;
+  while (ok && produced < out.size())
+  {
+    if (stream.avail_in == 0)
+    {
+      stream.avail_in = static_cast<uInt>(fread(input.data(), 1, input.size(), file));
+      stream.next_in = input.data();
+      if (stream.avail_in == 0)
+      {
+        ok = false;
+        break;
+      }
+    }
+    if (skip > 0)
+    {
+      stream.next_out = discard.data();
+      stream.avail_out = static_cast<uInt>(std::min<uint64_t>(skip, discard.size()));
+    }
+    else
+    {
+      stream.next_out = out.data() + produced;
+      stream.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - produced, 1u << 30));
+    }
+    uInt const availableOut = stream.avail_out;
+    int const result = inflate(&stream, Z_NO_FLUSH);
+    if (result != Z_OK && result != Z_STREAM_END)
+      ok = false;
+    size_t const written = availableOut - stream.avail_out;
+    if (skip > 0)
+      skip -= written;
+    else
+      produced += written;
+    if (result == Z_STREAM_END && produced < out.size())
+    {
+      ok = ok && NextMember(stream, input, file, raw);
+      raw = false;
+    }
+  }
+  inflateEnd(&stream);
+  fclose(file);
+  return ok;
+}
+
+bool OffsetIndex::Save(StringView indexPath) const
+{
+  std::vector<uint8_t> data(std::begin(IndexMagic), std::end(IndexMagic));
+  Put<uint32_t>(data, IndexVersion);
+  Put<uint8_t>(data, compressed);
+  Put<uint64_t>(data, stamp.size);
+  Put<int64_t>(data, stamp.modified);
+  Put<uint64_t>(data, stamp.hash);
+  Put<uint32_t>(data, static_cast<uint32_t>(checkpoints.size()));
+  for (Checkpoint const& checkpoint : checkpoints)
+  {
+    Put<uint64_t>(data, checkpoint.in);
+    Put<uint64_t>(data, checkpoint.out);
+    Put<uint8_t>(data, checkpoint.bits);
+    data.insert(data.end(), checkpoint.window.begin(), checkpoint.window.end());
+  }
+  Put<uint32_t>(data, static_cast<uint32_t>(entries.size()));
+  for (auto const& [path, entry] : entries)
+  {
+    Put<uint64_t>(data, entry.offset);
+    Put<uint64_t>(data, entry.size);
+    Put<uint8_t>(data, static_cast<uint8_t>(entry.type));
+    Put<uint8_t>(data, entry.named);
+    Put<uint32_t>(data, static_cast<uint32_t>(path.size()));
+    data.insert(data.end(), path.begin(), path.end());
+  }
+
+  FILE* file = fopen(std::string(indexPath).c_str(), "wb");
+  if (!file)
+    return false;
+  size_t const written = fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  return written == data.size();
+}
+
+Optional<OffsetIndex> OffsetIndex::Load(StringView indexPath, StringView filepath)
+{
+  std::vector<uint8_t> data;
+  if (!ReadFile(indexPath, data))
+    return std::nullopt;
+  IndexInput in{ data };
+  uint8_t const* magic = in.Bytes(sizeof(IndexMagic));
+  uint32_t version = 0;
+  if (!magic || std::memcmp(magic, IndexMagic, sizeof(IndexMagic)) != 0 || !in.Get(version) || version != IndexVersion)
+    return std::nullopt;
+
+  OffsetIndex index;
+  index.filepath = std::string(filepath);
+  uint8_t compressed = 0;
+  uint32_t checkpointCount = 0;
+  if (!in.Get(compressed) || !in.Get(index.stamp.size) || !in.Get(index.stamp.modified) || !in.Get(index.stamp.hash) || !in.Get(checkpointCount))
+    return std::nullopt;
+  index.compressed = compressed != 0;
+  for (uint32_t i = 0; i < checkpointCount; ++i)
+  {
+    Checkpoint checkpoint;
+    if (!in.Get(checkpoint.in) || !in.Get(checkpoint.out) || !in.Get(checkpoint.bits) || checkpoint.bits > 7)
+      return std::nullopt;
+    uint8_t const* window = in.Bytes(WindowSize);
+    if (!window)
+      return std::nullopt;
+    checkpoint.window.assign(window, window + WindowSize);
+    index.checkpoints.push_back(std::move(checkpoint));
+  }
+  uint32_t entryCount = 0;
+  if (!in.Get(entryCount))
+    return std::nullopt;
+  for (uint32_t i = 0; i < entryCount; ++i)
+  {
+    Entry entry{};
+    uint8_t type = 0, named = 0;
+    uint32_t pathLength = 0;
+    if (!in.Get(entry.offset) || !in.Get(entry.size) || !in.Get(type) || !in.Get(named) || !in.Get(pathLength) || type > static_cast<uint8_t>(TAG::Long_Array))
+      return std::nullopt;
+    uint8_t const* path = in.Bytes(pathLength);
+    if (!path)
+      return std::nullopt;
+    entry.type = static_cast<TAG>(type);
+    entry.named = named != 0;
+    index.entries.emplace(std::string(reinterpret_cast<char const*>(path), pathLength), entry);
+  }
+
+  if (!index.IsCurrent())
+    return std::nullopt;
+  return index;
+}
+
+bool Reader::ImportIndexedSubtree(OffsetIndex const& index, StringView path)
+{
+  OffsetIndex::Entry const* entry = index.Find(path);
+  if (!entry)
+    return false;
+  // the hash is left to OffsetIndex::Load(), checking it on every import would read the file
+  Optional<OffsetIndex::FileStamp> const stamp = OffsetIndex::StampFile(index.filepath, false);
+  if (!stamp || stamp->size != index.stamp.size || stamp->modified != index.stamp.modified)
+    return false;
+  std::vector<uint8_t> bytes;
+  if (!index.Read(*entry, bytes))
+    return false;
+
+  // give the subtree the header of a named tag, inside an unnamed root unless it is a compound
+  std::vector<uint8_t> document;
+  if (entry->type != TAG::Compound)
+    document.insert(document.end(), { static_cast<uint8_t>(TAG::Compound), 0, 0 });
+  if (!entry->named)
+    document.insert(document.end(), { static_cast<uint8_t>(entry->type), 0, 0 });
+  document.insert(document.end(), bytes.begin(), bytes.end());
+  if (entry->type != TAG::Compound)
+    document.push_back(static_cast<uint8_t>(TAG::End));
+  return ImportBinary(document.data(), static_cast<uint32_t>(document.size()));
+}
+
+} // namespace ImNBT
@@ -0,0 +1,695 @@
+#include <ImNBT/NBTPatch.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+namespace ImNBT
+{
+
+namespace
+{
+
+constexpr uint8_t PatchVersion = 1;
+
+enum class Edit : uint8_t
+{
+  Set = 1,
+  SetRanges,
+  Insert,
+  Append,
+  Remove,
+};
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// values are encoded big endian, as in binary NBT
+template<typename T>
+void PutBigEndian(std::vector<uint8_t>& out, T value)
+{
+  uint8_t bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  std::reverse(bytes, bytes + sizeof(T));
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+T FromBigEndian(uint8_t const* bytes)
+{
+  uint8_t reversed[sizeof(T)];
+  std::reverse_copy(bytes, bytes + sizeof(T), reversed);
+  T value;
+  std::memcpy(&value, reversed, sizeof(T));
+  return value;
+}
+
+void AppendKey(std::string& path, StringView key)
+{
+  if (!path.empty())
+    path += '.';
+  if (!key.empty() && key != "*" && key.find_first_of(".[]\"\\") == StringView::npos)
+  {
+    path += key;
+    return;
+  }
+  path += '"';
+  for (char c : key)
+  {
+    if (c == '"' || c == '\\')
+      path += '\\';
+    path += c;
+  }
+  path += '"';
+}
+
+void AppendIndex(std::string& path, int32_t index)
+{
+  path += '[';
+  path += std::to_string(index);
+  path += ']';
+}
+
+} // namespace
+
+struct Patch::Differ
+{
+  std::vector<uint8_t>& out;
+
+  // the path to the tag being compared: a key, or an index if key is not set
+  struct Step
+  {
+    StringView key;
+    int32_t index = -1;
+  };
+  std::vector<Step> path;
+
+  void Begin(Edit edit)
+  {
+    out.push_back(static_cast<uint8_t>(edit));
+    PutVarint(out, path.size());
+    for (Step const& step : path)
+    {
+      if (step.index >= 0)
+      {
+        PutVarint(out, static_cast<uint64_t>(step.index) * 2 + 1);
+        continue;
+      }
+      PutVarint(out, step.key.size() * 2);
+      out.insert(out.end(), step.key.begin(), step.key.end());
+    }
+  }
+
+  // the values of an array as they are encoded: big endian, as in the pools of parsed documents. Documents built in memory
+  // keep int and long arrays in native order, so those are swapped into the given vector first
+  template<typename T>
+  static T const* ArrayData(TagRef const& tag, std::vector<T>& swapped)
+  {
+    using Payload = std::conditional_t<std::is_same_v<T, byte>, TagPayload::ByteArray, std::conditional_t<std::is_same_v<T, int32_t>, TagPayload::IntArray, TagPayload::LongArray>>;
+    T const* values = tag.dataStore->Pool<T>().data() + tag.tag.payload.As<Payload>().poolIndex_;
+    if (sizeof(T) == 1 || tag.dataStore->bigEndianArrays)
+      return values;
+    swapped.resize(tag.Size());
+    for (size_t i = 0; i < swapped.size(); ++i)
+      swapped[i] = FromBigEndian<T>(reinterpret_cast<uint8_t const*>(values + i));
+    return swapped.data();
+  }
+
+  template<typename T>
+  void PutArray(T const* values, size_t count)
+  {
+    uint8_t const* bytes = reinterpret_cast<uint8_t const*>(values);
+    out.insert(out.end(), bytes, bytes + count * sizeof(T));
+  }
+
+  template<typename T>
+  void PutArrayValue(TagRef const& tag)
+  {
+    std::vector<T> swapped;
+    PutVarint(out, tag.Size());
+    PutArray(ArrayData<T>(tag, swapped), tag.Size());
+  }
+
+  void PutValue(TagRef const& tag)
+  {
+    out.push_back(static_cast<uint8_t>(tag.Type()));
+    switch (tag.Type())
+    {
+      case TAG::Byte: out.push_back(static_cast<uint8_t>(*tag.As<int8_t>())); break;
+      case TAG::Short: PutBigEndian(out, *tag.As<int16_t>()); break;
+      case TAG::Int: PutBigEndian(out, *tag.As<int32_t>()); break;
+      case TAG::Long: PutBigEndian(out, *tag.As<int64_t>()); break;
+      case TAG::Float: PutBigEndian(out, *tag.As<float>()); break;
+      case TAG::Double: PutBigEndian(out, *tag.As<double>()); break;
+      case TAG::String: {
+        StringView const string = *tag.As<StringView>();
+        PutVarint(out, string.size());
+        out.insert(out.end(), string.begin(), string.end());
+      }
+      break;
+      case TAG::Byte_Array: PutArrayValue<byte>(tag); break;
+      case TAG::Int_Array: PutArrayValue<int32_t>(tag); break;
+      case TAG::Long_Array: PutArrayValue<int64_t>(tag); break;
+      default:
+        break;
+    }
+  }
+
+  // adds a tag as a compound entry or list element, followed by the edits adding its contents
+  void Add(Edit edit, Step const& step, TagRef const& tag)
+  {
+    Begin(edit);
+    if (edit == Edit::Insert)
+    {
+      PutVarint(out, step.key.size());
+      out.insert(out.end(), step.key.begin(), step.key.end());
+    }
+    else
+    {
+      PutVarint(out, static_cast<uint64_t>(step.index));
+    }
+    PutValue(tag);
+    if (!Internal::IsContainer(tag.Type()))
+      return;
+    path.push_back(step);
+    if (tag.Type() == TAG::Compound)
+    {
+      tag.dataStore->ForEachEntry(tag.tag.payload.As<TagPayload::Compound>(), [&](StringView name, DataTag const& entry) {
+        Add(Edit::Insert, Step{ name }, TagRef{ tag.dataStore, entry });
+      });
+    }
+    else
+    {
+      for (int32_t i = 0; i < tag.Size(); ++i)
+        Add(Edit::Append, Step{ {}, i }, tag[i]);
+    }
+    path.pop_back();
+  }
+
+  void Compound(TagRef const& from, TagRef const& to)
+  {
+    TagPayload::Compound const& fromCompound = from.tag.payload.As<TagPayload::Compound>();
+    TagPayload::Compound const& toCompound = to.tag.payload.As<TagPayload::Compound>();
+    // entries in the same order are found at the position of the entry before
+    size_t position = 0;
+    to.dataStore->ForEachEntry(toCompound, [&](StringView name, DataTag const& entry) {
+      size_t hint = position++;
+      Internal::EntryLocation const location = from.dataStore->Locate(fromCompound, name, hint);
+      TagRef const next{ to.dataStore, entry };
+      if (location.type == entry.type)
+      {
+        path.push_back(Step{ name });
+        bool const changedInPlace = Tag(TagRef{ from.dataStore, from.dataStore->EntryTag(location) }, next);
+        path.pop_back();
+        if (changedInPlace)
+          return;
+      }
+      Add(Edit::Insert, Step{ name }, next);
+    });
+    position = 0;
+    from.dataStore->ForEachEntry(fromCompound, [&](StringView name, DataTag const&) {
+      size_t hint = position++;
+      if (to.dataStore->Locate(toCompound, name, hint).type != TAG::End)
+        return;
+      path.push_back(Step{ name });
+      Begin(Edit::Remove);
+      path.pop_back();
+    });
+  }
+
+  // false if the list has to be added again, as its elements changed type
+  bool List(TagRef const& from, TagRef const& to)
+  {
+    TagPayload::List const& fromList = from.tag.payload.As<TagPayload::List>();
+    TagPayload::List const& toList = to.tag.payload.As<TagPayload::List>();
+    if (fromList.count_ > 0 && toList.count_ > 0 && fromList.elementType_ != toList.elementType_)
+      return false;
+    size_t const mark = out.size();
+    int32_t const common = std::min(fromList.count_, toList.count_);
+    for (int32_t i = 0; i < common; ++i)
+    {
+      path.push_back(Step{ {}, i });
+      bool const changedInPlace = Tag(from[i], to[i]);
+      path.pop_back();
+      if (!changedInPlace)
+      {
+        out.resize(mark);
+        return false;
+      }
+    }
+    // removed from the end, so the indices of the elements before stay the same
+    for (int32_t i = fromList.count_ - 1; i >= common; --i)
+    {
+      path.push_back(Step{ {}, i });
+      Begin(Edit::Remove);
+      path.pop_back();
+    }
+    for (int32_t i = common; i < toList.count_; ++i)
+      Add(Edit::Append, Step{ {}, i }, to[i]);
+    return true;
+  }
+
+  template<typename T>
+  void Array(TAG type, TagRef const& from, TagRef const& to)
+  {
+    std::vector<T> fromSwapped;
+    std::vector<T> toSwapped;
+    T const* fromValues = ArrayData<T>(from, fromSwapped);
+    T const* toValues = ArrayData<T>(to, toSwapped);
+    int32_t const fromCount = from.Size();
+    int32_t const toCount = to.Size();
+    // versions of a document made by one editor share the arrays that were not changed
+    if (fromValues == toValues && fromCount == toCount)
+      return;
+    int32_t const common = std::min(fromCount, toCount);
+    auto const differ = [](T const& a, T const& b) { return std::memcmp(&a, &b, sizeof(T)) != 0; };
+    auto const same = [](T const& a, T const& b) { return std::memcmp(&a, &b, sizeof(T)) == 0; };
+    // ranges of elements that differ. Ranges closer than the few bytes a range takes to encode are joined
+    constexpr int32_t gap = std::max<int32_t>(1, 8 / static_cast<int32_t>(sizeof(T)));
+    std::vector<std::pair<int32_t, int32_t>> ranges;
+    auto const add = [&](int32_t begin, int32_t end) {
+      if (!ranges.empty() && begin - ranges.back().second <= gap)
+        ranges.back().second = end;
+      else
+        ranges.emplace_back(begin, end);
+    };
+    for (int32_t i = 0; i < common;)
+    {
+      i = static_cast<int32_t>(std::mismatch(fromValues + i, fromValues + common, toValues + i, same).first - fromValues);
+      if (i == common)
+        break;
+      int32_t const end = static_cast<int32_t>(std::mismatch(fromValues + i, fromValues + common, toValues + i, differ).first - fromValues);
+      add(i, end);
+      i = end;
+    }
+    if (toCount > common)
+      add(common, toCount);
+    if (ranges.empty() && fromCount == toCount)
+      return;
+    Begin(Edit::SetRanges);
+    out.push_back(static_cast<uint8_t>(type));
+    PutVarint(out, static_cast<uint64_t>(toCount));
+    PutVarint(out, ranges.size());
+    for (auto const& [begin, end] : ranges)
+    {
+      PutVarint(out, static_cast<uint64_t>(begin));
+      PutVarint(out, static_cast<uint64_t>(end - begin));
+      PutArray(toValues + begin, static_cast<size_t>(end - begin));
+    }
+  }
+
+  // compares tags of the same type, false if the tag has to be added again
+  bool Tag(TagRef const& from, TagRef const& to)
+  {
+    switch (to.Type())
+    {
+      case TAG::Compound:
+        Compound(from, to);
+        return true;
+      case TAG::List:
+        return List(from, to);
+      case TAG::Byte_Array:
+        Array<byte>(TAG::Byte_Array, from, to);
+        return true;
+      case TAG::Int_Array:
+        Array<int32_t>(TAG::Int_Array, from, to);
+        return true;
+      case TAG::Long_Array:
+        Array<int64_t>(TAG::Long_Array, from, to);
+        return true;
+      default:
+        break;
+    }
+    size_t const mark = out.size();
+    PutValue(from);
+    size_t const valueSize = out.size() - mark;
+    PutValue(to);
+    bool const equal = out.size() - mark == valueSize * 2 && std::equal(out.begin() + mark, out.begin() + mark + valueSize, out.begin() + mark + valueSize);
+    out.resize(mark);
+    if (!equal)
+    {
+      Begin(Edit::Set);
+      PutValue(to);
+    }
+    return true;
+  }
+};
+
+struct Patch::Decoder
+{
+  uint8_t const* at;
+  uint8_t const* end;
+
+  bool Varint(uint64_t& value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 64 && at != end; shift += 7)
+    {
+      uint8_t const next = *at++;
+      value |= static_cast<uint64_t>(next & 0x7f) << shift;
+      if ((next & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  bool Count(int32_t& count)
+  {
+    uint64_t value;
+    if (!Varint(value) || value > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+      return false;
+    count = static_cast<int32_t>(value);
+    return true;
+  }
+
+  bool Bytes(size_t size, uint8_t const*& bytes)
+  {
+    if (static_cast<size_t>(end - at) < size)
+      return false;
+    bytes = at;
+    at += size;
+    return true;
+  }
+
+  bool Name(StringView& name)
+  {
+    uint64_t size;
+    uint8_t const* bytes;
+    if (!Varint(size) || size > std::numeric_limits<uint16_t>::max() || !Bytes(size, bytes))
+      return false;
+    name = StringView{ reinterpret_cast<char const*>(bytes), size };
+    return true;
+  }
+
+  bool ReadPath(Path& path, std::string& text)
+  {
+    uint64_t steps;
+    if (!Varint(steps) || steps > static_cast<uint64_t>(end - at))
+      return false;
+    for (uint64_t i = 0; i < steps; ++i)
+    {
+      uint64_t value;
+      if (!Varint(value))
+        return false;
+      Path::Step step{};
+      if (value & 1)
+      {
+        if ((value >> 1) > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+          return false;
+        step.kind = Path::Step::Kind::Index;
+        step.index = static_cast<int32_t>(value >> 1);
+        AppendIndex(text, step.index);
+      }
+      else
+      {
+        uint8_t const* bytes;
+        if ((value >> 1) > std::numeric_limits<uint16_t>::max() || !Bytes(value >> 1, bytes))
+          return false;
+        step.kind = Path::Step::Kind::Key;
+        step.key.assign(reinterpret_cast<char const*>(bytes), value >> 1);
+        step.keyHash = Internal::HashName(step.key);
+        AppendKey(text, step.key);
+      }
+      path.steps.push_back(std::move(step));
+    }
+    return true;
+  }
+
+  template<typename T>
+  bool BigEndian(T& value)
+  {
+    uint8_t const* bytes;
+    if (!Bytes(sizeof(T), bytes))
+      return false;
+    value = FromBigEndian<T>(bytes);
+    return true;
+  }
+
+  template<typename T>
+  bool Values(int32_t count, std::vector<T>& values)
+  {
+    uint8_t const* bytes;
+    if (!Bytes(static_cast<size_t>(count) * sizeof(T), bytes))
+      return false;
+    values.resize(count);
+    for (int32_t i = 0; i < count; ++i)
+      values[i] = FromBigEndian<T>(bytes + i * sizeof(T));
+    return true;
+  }
+
+  template<typename T>
+  bool Array(std::vector<T>& values)
+  {
+    int32_t count;
+    return Count(count) && Values(count, values);
+  }
+};
+
+Optional<Patch> Patch::Diff(TagRef const& from, TagRef const& to)
+{
+  if (from.Type() != TAG::Compound || to.Type() != TAG::Compound)
+    return std::nullopt;
+  Patch patch;
+  patch.bytes.push_back(PatchVersion);
+  Differ{ patch.bytes, {} }.Compound(from, to);
+  return patch;
+}
+
+Optional<Patch> Patch::Decode(uint8_t const* data, size_t size)
+{
+  Patch patch;
+  patch.bytes.assign(data, data + size);
+  if (!patch.Run(nullptr, nullptr))
+    return std::nullopt;
+  return patch;
+}
+
+bool Patch::Empty() const
+{
+  return bytes.size() <= 1;
+}
+
+std::vector<Patch::Change> Patch::Changes() const
+{
+  std::vector<Change> changes;
+  Run(nullptr, &changes);
+  return changes;
+}
+
+bool Patch::Apply(Editor& editor) const
+{
+  // edits are made to a copy, which is O(1), so a patch that does not fit leaves the editor as it was
+  Editor edited = editor;
+  if (!Run(&edited, nullptr))
+    return false;
+  editor = std::move(edited);
+  return true;
+}
+
+bool Patch::Run(Editor* editor, std::vector<Change>* changes) const
+{
+  if (bytes.empty() || bytes.front() != PatchVersion)
+    return false;
+  Decoder decoder{ bytes.data() + 1, bytes.data() + bytes.size() };
+  // the contents of an added container are reported with it
+  std::string added;
+  while (decoder.at != decoder.end)
+  {
+    Edit const edit = static_cast<Edit>(*decoder.at++);
+    Path path;
+    std::string text;
+    if (!decoder.ReadPath(path, text))
+      return false;
+    StringView name;
+    int32_t index = 0;
+    if (edit == Edit::Insert)
+    {
+      if (!decoder.Name(name))
+        return false;
+      AppendKey(text, name);
+    }
+    else if (edit == Edit::Append)
+    {
+      if (!decoder.Count(index))
+        return false;
+      AppendIndex(text, index);
+      // elements are appended in order, so a patch made from another document does not put them elsewhere
+      if (editor && path.Evaluate(editor->Root()).Size() != index)
+        return false;
+    }
+
+    if (changes)
+    {
+      bool const inside = !added.empty() && text.size() > added.size() && text.compare(0, added.size(), added) == 0 && (text[added.size()] == '.' || text[added.size()] == '[');
+      if (!inside)
+      {
+        Change::Kind const kind = edit == Edit::Remove ? Change::Kind::Removed : edit == Edit::Insert || edit == Edit::Append ? Change::Kind::Added : Change::Kind::Changed;
+        changes->push_back({ kind, text });
+        added = kind == Change::Kind::Added ? text : std::string{};
+      }
+    }
+
+    if (edit == Edit::Remove)
+    {
+      if (editor && !editor->Remove(path))
+        return false;
+      continue;
+    }
+    if (decoder.at == decoder.end)
+      return false;
+    TAG const type = static_cast<TAG>(*decoder.at++);
+
+    if (edit == Edit::SetRanges)
+    {
+      int32_t length;
+      uint64_t rangeCount;
+      if (!decoder.Count(length) || !decoder.Varint(rangeCount))
+        return false;
+      TagRef const current = editor ? path.Evaluate(editor->Root()) : TagRef{};
+      auto const patchArray = [&](auto values, auto set) {
+        using T = typename decltype(values)::value_type::value_type;
+        if (editor && !values)
+          return false;
+        // the length is only checked against the ranges while decoding, the array is only built when it is applied
+        std::vector<T> patched;
+        if (editor)
+        {
+          patched = *values;
+          patched.resize(length);
+        }
+        std::vector<T> range;
+        for (uint64_t i = 0; i < rangeCount; ++i)
+        {
+          int32_t first;
+          int32_t count;
+          if (!decoder.Count(first) || !decoder.Count(count) || first > length || count > length - first || !decoder.Values(count, range))
+            return false;
+          if (editor)
+            std::copy(range.begin(), range.end(), patched.begin() + first);
+        }
+        return !editor || set(patched.data(), length);
+      };
+      bool patched = false;
+      switch (type)
+      {
+        case TAG::Byte_Array:
+          patched = patchArray(current.AsByteArray(), [&](int8_t const* values, int32_t count) { return editor->SetByteArray(path, values, count); });
+          break;
+        case TAG::Int_Array:
+          patched = patchArray(current.AsIntArray(), [&](int32_t const* values, int32_t count) { return editor->SetIntArray(path, values, count); });
+          break;
+        case TAG::Long_Array:
+          patched = patchArray(current.AsLongArray(), [&](int64_t const* values, int32_t count) { return editor->SetLongArray(path, values, count); });
+          break;
+        default:
+          break;
+      }
+      if (!patched)
+        return false;
+      continue;
+    }
+    if (edit != Edit::Set && edit != Edit::Insert && edit != Edit::Append)
+      return false;
+
+    // the value, written with the function of the edit
+    auto const write = [&](auto value) {
+      if (!editor)
+        return true;
+      switch (edit)
+      {
+        case Edit::Set: return editor->Set(path, value);
+        case Edit::Insert: return editor->Insert(path, name, value);
+        default: return editor->Append(path, value);
+      }
+    };
+    auto const writeArray = [&](auto const& values, auto set, auto insert, auto append) {
+      if (!editor)
+        return true;
+      int32_t const count = static_cast<int32_t>(values.size());
+      switch (edit)
+      {
+        case Edit::Set: return (editor->*set)(path, values.data(), count);
+        case Edit::Insert: return (editor->*insert)(path, name, values.data(), count);
+        default: return (editor->*append)(path, values.data(), count);
+      }
+    };
+    bool written = false;
+    switch (type)
+    {
+      case TAG::Byte: {
+        int8_t value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::Short: {
+        int16_t value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::Int: {
+        int32_t value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::Long: {
+        int64_t value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::Float: {
+        float value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::Double: {
+        double value;
+        written = decoder.BigEndian(value) && write(value);
+      }
+      break;
+      case TAG::String: {
+        StringView value;
+        written = decoder.Name(value) && write(value);
+      }
+      break;
+      case TAG::Byte_Array: {
+        std::vector<int8_t> values;
+        written = decoder.Array(values) && writeArray(values, &Editor::SetByteArray, &Editor::InsertByteArray, &Editor::AppendByteArray);
+      }
+      break;
+      case TAG::Int_Array: {
+        std::vector<int32_t> values;
+        written = decoder.Array(values) && writeArray(values, &Editor::SetIntArray, &Editor::InsertIntArray, &Editor::AppendIntArray);
+      }
+      break;
+      case TAG::Long_Array: {
+        std::vector<int64_t> values;
+        written = decoder.Array(values) && writeArray(values, &Editor::SetLongArray, &Editor::InsertLongArray, &Editor::AppendLongArray);
+      }
+      break;
+      case TAG::List:
+      case TAG::Compound: {
+        if (edit == Edit::Set)
+          return false;
+        bool const compound = type == TAG::Compound;
+        written = !editor || (edit == Edit::Insert ? (compound ? editor->InsertCompound(path, name) : editor->InsertList(path, name))
+                                                   : (compound ? editor->AppendCompound(path) : editor->AppendList(path)));
+      }
+      break;
+      default:
+        break;
+    }
+    if (!written)
+      return false;
+  }
+  return true;
+}
+
+} // namespace ImNBT
@@ -0,0 +1,264 @@
+#include <ImNBT/NBTPath.hpp>
+
+#include "byteswapping.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace ImNBT
+{
+
+TagRef Reader::Root() const
+{
+  if (lazyPending)
+    const_cast<Reader*>(this)->MaterializeAll();
+  if (dataStore.namedTags.empty())
+    return {};
+  // the root compound is always the first tag of a document
+  return TagRef{ &dataStore, dataStore.namedTags.front().dataTag };
+}
+
+TagRef Reader::Current() const
+{
+  if (lazyPending && containers.size() == 1)
+    const_cast<Reader*>(this)->MaterializeAll();
+  if (containers.empty() || dataStore.namedTags.empty())
+    return {};
+  ContainerInfo const& container = containers.top();
+  DataTag tag{ container.Type() };
+  if (container.Type() == TAG::List)
+    tag.payload.Set(container.ListPayload(dataStore));
+  else
+    tag.payload.Set(container.CompoundPayload(dataStore));
+  return TagRef{ &dataStore, tag };
+}
+
+int32_t TagRef::Size() const
+{
+  switch (Type())
+  {
+    case TAG::Byte_Array: return tag.payload.As<TagPayload::ByteArray>().count_;
+    case TAG::Int_Array: return tag.payload.As<TagPayload::IntArray>().count_;
+    case TAG::Long_Array: return tag.payload.As<TagPayload::LongArray>().count_;
+    case TAG::String: return tag.payload.As<TagPayload::String>().length_;
+    case TAG::List: return tag.payload.As<TagPayload::List>().count_;
+    case TAG::Compound: return static_cast<int32_t>(dataStore->EntryCount(tag.payload.As<TagPayload::Compound>()));
+    default: return 0;
+  }
+}
+
+TagRef TagRef::operator[](StringView name) const
+{
+  if (Type() != TAG::Compound)
+    return {};
+  size_t positionHint = 0;
+  Internal::EntryLocation const entry = dataStore->Locate(tag.payload.As<TagPayload::Compound>(), name, positionHint);
+  if (entry.type == TAG::End)
+    return {};
+  return TagRef{ dataStore, dataStore->EntryTag(entry) };
+}
+
+TagRef TagRef::operator[](int32_t index) const
+{
+  if (Type() != TAG::List)
+    return {};
+  TagPayload::List const& list = tag.payload.As<TagPayload::List>();
+  if (index < 0 || index >= list.count_)
+    return {};
+  return TagRef{ dataStore, dataStore->ListElement(list, index) };
+}
+
+uint64_t TagRef::Hash(HashOrder order) const
+{
+  if (!IsValid())
+    return 0;
+  return dataStore->ContentHash(tag, order == HashOrder::Canonical);
+}
+
+bool TagRef::Equals(TagRef const& other) const
+{
+  if (!IsValid() || !other.IsValid())
+    return IsValid() == other.IsValid();
+  return dataStore->ContentEquals(tag, *other.dataStore, other.tag);
+}
+
+template<typename T>
+Optional<T> TagRef::As() const
+{
+  using Traits = Internal::TagTraits<T>;
+  if (Type() != Traits::Tag)
+    return std::nullopt;
+  if constexpr (std::is_same_v<T, StringView>)
+  {
+    auto const& string = tag.payload.As<TagPayload::String>();
+    return StringView{ dataStore->Pool<char>().data() + string.poolIndex_, string.length_ };
+  }
+  else
+  {
+    return tag.payload.As<typename Traits::Payload>();
+  }
+}
+
+template Optional<int8_t> TagRef::As() const;
+template Optional<int16_t> TagRef::As() const;
+template Optional<int32_t> TagRef::As() const;
+template Optional<int64_t> TagRef::As() const;
+template Optional<float> TagRef::As() const;
+template Optional<double> TagRef::As() const;
+template Optional<StringView> TagRef::As() const;
+
+Optional<std::vector<int8_t>> TagRef::AsByteArray() const
+{
+  if (Type() != TAG::Byte_Array)
+    return std::nullopt;
+  auto const& byteArray = tag.payload.As<TagPayload::ByteArray>();
+  auto const* bytePool = dataStore->Pool<byte>().data() + byteArray.poolIndex_;
+  return std::vector<int8_t>(bytePool, bytePool + byteArray.count_);
+}
+
+// arrays are kept big endian in the reader's pools
+Optional<std::vector<int32_t>> TagRef::AsIntArray() const
+{
+  if (Type() != TAG::Int_Array)
+    return std::nullopt;
+  auto const& intArray = tag.payload.As<TagPayload::IntArray>();
+  auto const* intPool = dataStore->Pool<int32_t>().data() + intArray.poolIndex_;
+  std::vector<int32_t> ret(intArray.count_);
+  std::transform(intPool, intPool + intArray.count_, ret.begin(), swap_i32);
+  return ret;
+}
+
+Optional<std::vector<int64_t>> TagRef::AsLongArray() const
+{
+  if (Type() != TAG::Long_Array)
+    return std::nullopt;
+  auto const& longArray = tag.payload.As<TagPayload::LongArray>();
+  auto const* longPool = dataStore->Pool<int64_t>().data() + longArray.poolIndex_;
+  std::vector<int64_t> ret(longArray.count_);
+  std::transform(longPool, longPool + longArray.count_, ret.begin(), swap_i64);
+  return ret;
+}
+
+Optional<Path> Path::Compile(StringView expression)
+{
+  Path path;
+  size_t position = 0;
+  bool expectKey = true;
+  while (position < expression.size())
+  {
+    char const c = expression[position];
+    if (c == '[')
+    {
+      size_t const close = expression.find(']', position);
+      if (close == StringView::npos)
+        return std::nullopt;
+      StringView const index = expression.substr(position + 1, close - position - 1);
+      Step step{};
+      if (index == "*")
+      {
+        step.kind = Step::Kind::AnyIndex;
+      }
+      else
+      {
+        step.kind = Step::Kind::Index;
+        auto const [end, error] = std::from_chars(index.data(), index.data() + index.size(), step.index);
+        if (index.empty() || error != std::errc{} || end != index.data() + index.size())
+          return std::nullopt;
+      }
+      path.steps.push_back(std::move(step));
+      position = close + 1;
+      expectKey = false;
+      continue;
+    }
+    if (c == '.')
+    {
+      if (expectKey)
+        return std::nullopt;
+      ++position;
+      expectKey = true;
+      continue;
+    }
+    if (!expectKey)
+      return std::nullopt;
+    Step step{};
+    step.kind = Step::Kind::Key;
+    if (c == '"')
+    {
+      ++position;
+      bool closed = false;
+      while (position < expression.size())
+      {
+        char const k = expression[position++];
+        if (k == '"')
+        {
+          closed = true;
+          break;
+        }
+        if (k == '\\' && position < expression.size())
+          step.key += expression[position++];
+        else
+          step.key += k;
+      }
+      if (!closed)
+        return std::nullopt;
+    }
+    else
+    {
+      size_t const end = std::min(expression.find_first_of(".[\"", position), expression.size());
+      step.key = std::string(expression.substr(position, end - position));
+      if (step.key.empty() || step.key.find(']') != std::string::npos)
+        return std::nullopt;
+      if (step.key == "*")
+        step.kind = Step::Kind::AnyKey;
+      position = end;
+    }
+    step.keyHash = Internal::HashName(step.key);
+    path.steps.push_back(std::move(step));
+    expectKey = false;
+  }
+  // a trailing '.'
+  if (expectKey && !path.steps.empty())
+    return std::nullopt;
+  return path;
+}
+
+TagRef Path::Evaluate(Reader const& reader) const
+{
+  return Evaluate(reader.Root());
+}
+
+TagRef Path::Evaluate(TagRef const& from) const
+{
+  TagRef result;
+  ForEach(from, [&result](TagRef const& match) {
+    result = match;
+    return false;
+  });
+  return result;
+}
+
+std::vector<TagRef> Path::All(Reader const& reader) const
+{
+  std::vector<TagRef> results;
+  ForEach(reader, [&results](TagRef const& match) { results.push_back(match); });
+  return results;
+}
+
+TagRef Path::Child(TagRef const& node, Step const& step) const
+{
+  if (step.kind == Step::Kind::Key)
+  {
+    if (node.tag.type != TAG::Compound)
+      return {};
+    Internal::EntryLocation const entry = node.dataStore->Locate(node.tag.payload.As<TagPayload::Compound>(), step.key, step.keyHash, step.positionHint);
+    if (entry.type == TAG::End)
+      return {};
+    return TagRef{ node.dataStore, node.dataStore->EntryTag(entry) };
+  }
+  if (node.tag.type != TAG::List)
+    return {};
+  int32_t const count = node.tag.payload.As<TagPayload::List>().count_;
+  return node[step.index < 0 ? count + step.index : step.index];
+}
+
+} // namespace ImNBT
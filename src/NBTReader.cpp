@@ -1,6 +1,11 @@
 #include <ImNBT/NBTReader.hpp>
 
+#include <ImNBT/NBTPath.hpp>
+#include <ImNBT/NBTVisitor.hpp>
+
 #include "byteswapping.h"
+#include "gzipmembers.h"
+#include "parallel.h"
 
 #include "zlib.h"
 
@@ -9,6 +14,7 @@
 #include <cassert>
 #include <charconv>
 #include <iostream>
+#include <utility>
 
 namespace ImNBT
 {
@@ -58,6 +64,7 @@ bool Reader::ImportString(char const* data, uint32_t length)
 {
   std::vector<uint8_t> mem(data, data + length);
   memoryStream.SetContents(std::move(mem));
+  Clear();
   return ParseTextStream();
 }
 
@@ -65,9 +72,289 @@ bool Reader::ImportBinary(uint8_t const* data, uint32_t length)
 {
   std::vector mem(data, data + length);
   memoryStream.SetContents(std::move(mem));
+  Clear();
   return ParseBinaryStream();
 }
 
+void Reader::SetLazyImport(bool enabled)
+{
+  lazyImport = enabled;
+}
+
+void Reader::SetSourcePassthrough(bool enabled)
+{
+  sourcePassthrough = enabled;
+}
+
+void Reader::SetImportThreads(unsigned threads)
+{
+  importThreads = threads;
+}
+
+bool Reader::SetProjection(std::vector<StringView> const& paths)
+{
+  Optional<std::vector<ProjectionNode>> nodes = BuildProjection(paths);
+  if (!nodes)
+    return false;
+  projection = std::move(*nodes);
+  return true;
+}
+
+Optional<std::vector<Reader::ProjectionNode>> Reader::BuildProjection(std::vector<StringView> const& paths)
+{
+  std::vector<Path> compiled;
+  for (StringView path : paths)
+  {
+    Optional<Path> const maybePath = Path::Compile(path);
+    if (!maybePath)
+      return std::nullopt;
+    compiled.push_back(*maybePath);
+  }
+  std::vector<ProjectionNode> nodes;
+  if (compiled.empty())
+    return nodes;
+  // child links of 0 mean none, as the root is never a child
+  nodes.emplace_back();
+  for (Path const& path : compiled)
+  {
+    size_t node = 0;
+    for (Path::Step const& step : path.steps)
+    {
+      if (nodes[node].whole)
+        break;
+      size_t child = 0;
+      if (step.kind == Path::Step::Kind::Key)
+      {
+        auto& children = nodes[node].children;
+        auto const it = std::find_if(children.begin(), children.end(), [&step](auto const& entry) { return entry.first == step.key; });
+        if (it != children.end())
+          child = it->second;
+        else
+        {
+          child = nodes.size();
+          children.emplace_back(step.key, child);
+          nodes.emplace_back();
+        }
+      }
+      else
+      {
+        size_t& link = step.kind == Path::Step::Kind::AnyKey ? nodes[node].anyKey : nodes[node].anyIndex;
+        if (link == 0)
+        {
+          link = nodes.size();
+          nodes.emplace_back();
+        }
+        child = link;
+      }
+      node = child;
+    }
+    nodes[node].whole = true;
+  }
+  return nodes;
+}
+
+size_t Reader::ProjectedChild(std::vector<ProjectionNode> const& nodes, size_t node, TAG type, StringView name)
+{
+  size_t child = nodes[node].anyKey;
+  for (auto const& [key, index] : nodes[node].children)
+  {
+    if (key == name)
+    {
+      child = index;
+      break;
+    }
+  }
+  if (child == 0 || nodes[child].whole)
+    return child;
+  // the paths continue below this tag, which is only kept if they can reach into it
+  if (type == TAG::Compound || (type == TAG::List && nodes[child].anyIndex != 0))
+    return child;
+  return 0;
+}
+
+// builds the projected parts of a visited document into the reader, and stops the visit once every path is resolved
+struct Reader::ExtractionVisitor : VisitorBase
+{
+  static constexpr size_t Whole = std::numeric_limits<size_t>::max();
+
+  struct Open
+  {
+    // node selecting the container's contents, or Whole
+    size_t node;
+    // node that is resolved when the container closes, 0 for none
+    size_t resolves;
+    bool list;
+  };
+
+  Reader& reader;
+  std::vector<ProjectionNode> const& nodes;
+  std::vector<bool> underWildcard;
+  std::vector<bool> resolved;
+  size_t unresolved = 0;
+  std::vector<Open> open;
+
+  ExtractionVisitor(Reader& reader, std::vector<ProjectionNode> const& nodes)
+    : reader(reader)
+    , nodes(nodes)
+    , underWildcard(nodes.size(), false)
+    , resolved(nodes.size(), false)
+  {
+    // children are always created after their parents
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+      for (auto const& child : nodes[node].children)
+        underWildcard[child.second] = underWildcard[node];
+      if (nodes[node].anyKey)
+        underWildcard[nodes[node].anyKey] = true;
+      if (nodes[node].anyIndex)
+        underWildcard[nodes[node].anyIndex] = true;
+      if (nodes[node].whole)
+        ++unresolved;
+    }
+  }
+
+  void Resolve(size_t node)
+  {
+    if (nodes[node].whole && !resolved[node])
+    {
+      resolved[node] = true;
+      --unresolved;
+    }
+    for (auto const& child : nodes[node].children)
+      Resolve(child.second);
+    if (nodes[node].anyKey)
+      Resolve(nodes[node].anyKey);
+    if (nodes[node].anyIndex)
+      Resolve(nodes[node].anyIndex);
+  }
+
+  // the node selecting a tag in the innermost open container, 0 if it is not selected
+  size_t Select(TAG type, StringView name) const
+  {
+    Open const& parent = open.back();
+    if (parent.node == Whole)
+      return Whole;
+    if (parent.list)
+    {
+      size_t const element = nodes[parent.node].anyIndex;
+      return element == 0 ? Whole : element;
+    }
+    return ProjectedChild(nodes, parent.node, type, name);
+  }
+
+  Visit Finish(size_t node)
+  {
+    if (node != 0 && node != Whole && !underWildcard[node])
+      Resolve(node);
+    return unresolved == 0 ? Visit::Stop : Visit::Continue;
+  }
+
+  template<typename Write>
+  Visit Value(TAG type, StringView name, Write write)
+  {
+    size_t const node = Select(type, name);
+    if (node == 0)
+      return Visit::Continue;
+    write();
+    return Finish(node);
+  }
+
+  Visit BeginCompound(StringView name)
+  {
+    if (open.empty())
+    {
+      reader.Begin(name);
+      open.push_back({ nodes[0].whole ? Whole : 0, 0, false });
+      return Visit::Continue;
+    }
+    size_t const node = Select(TAG::Compound, name);
+    if (node == 0)
+      return Visit::Skip;
+    reader.BeginCompound(name);
+    open.push_back({ node == Whole || nodes[node].whole ? Whole : node, node, false });
+    return Visit::Continue;
+  }
+  Visit EndCompound()
+  {
+    Open const closed = open.back();
+    open.pop_back();
+    // the root stays open, as after a full import
+    if (open.empty())
+      return Visit::Stop;
+    reader.EndCompound();
+    return Finish(closed.resolves);
+  }
+  Visit BeginList(StringView name, TAG, int32_t)
+  {
+    size_t const node = Select(TAG::List, name);
+    if (node == 0)
+      return Visit::Skip;
+    reader.BeginList(name);
+    open.push_back({ node == Whole || nodes[node].whole ? Whole : node, node, true });
+    return Visit::Continue;
+  }
+  Visit EndList()
+  {
+    Open const closed = open.back();
+    open.pop_back();
+    reader.EndList();
+    return Finish(closed.resolves);
+  }
+
+  Visit Byte(StringView name, int8_t value) { return Value(TAG::Byte, name, [&] { reader.WriteByte(value, name); }); }
+  Visit Short(StringView name, int16_t value) { return Value(TAG::Short, name, [&] { reader.WriteShort(value, name); }); }
+  Visit Int(StringView name, int32_t value) { return Value(TAG::Int, name, [&] { reader.WriteInt(value, name); }); }
+  Visit Long(StringView name, int64_t value) { return Value(TAG::Long, name, [&] { reader.WriteLong(value, name); }); }
+  Visit Float(StringView name, float value) { return Value(TAG::Float, name, [&] { reader.WriteFloat(value, name); }); }
+  Visit Double(StringView name, double value) { return Value(TAG::Double, name, [&] { reader.WriteDouble(value, name); }); }
+  Visit String(StringView name, StringView value) { return Value(TAG::String, name, [&] { reader.WriteString(value, name); }); }
+  // the reader's pools keep int and long arrays big endian, as they are in the input
+  Visit ByteArray(StringView name, ArrayView<int8_t> value)
+  {
+    return Value(TAG::Byte_Array, name, [&] { reader.WriteByteArray(reinterpret_cast<int8_t const*>(value.data), value.count, name); });
+  }
+  Visit IntArray(StringView name, ArrayView<int32_t> value)
+  {
+    return Value(TAG::Int_Array, name, [&] { reader.WriteIntArray(reinterpret_cast<int32_t const*>(value.data), value.count, name); });
+  }
+  Visit LongArray(StringView name, ArrayView<int64_t> value)
+  {
+    return Value(TAG::Long_Array, name, [&] { reader.WriteLongArray(reinterpret_cast<int64_t const*>(value.data), value.count, name); });
+  }
+};
+
+bool Reader::ImportBinaryFileFields(StringView filepath, std::vector<StringView> const& paths)
+{
+  Optional<std::vector<ProjectionNode>> const nodes = BuildProjection(paths);
+  if (!nodes || nodes->empty())
+    return false;
+
+  memoryStream.Clear();
+  Clear();
+  ExtractionVisitor visitor{ *this, *nodes };
+  bool const visited = VisitBinaryFile(filepath, visitor);
+  if (containers.empty())
+    return false;
+  // a visit stopped early leaves the containers it was in open
+  while (visitor.open.size() > 1)
+  {
+    if (visitor.open.back().list)
+      EndList();
+    else
+      EndCompound();
+    visitor.open.pop_back();
+  }
+  return visited;
+}
+
+bool Reader::SkipBinaryPayload(TAG type)
+{
+  MemorySource source{ memoryStream.Data() + memoryStream.Position(), memoryStream.Size() - memoryStream.Position() };
+  bool const skipped = Internal::SkipBinaryPayload(source, type);
+  memoryStream.Seek(memoryStream.Position() + source.Position());
+  return skipped;
+}
+
 bool Reader::OpenCompound(StringView name)
 {
   if (!HandleNesting(name, TAG::Compound))
@@ -312,34 +599,91 @@ Optional<StringView> Reader::MaybeReadString(StringView name)
 
 int32_t Reader::Count() const
 {
+  // decoding the rest of a lazy import does not change the document the reader presents
+  if (lazyPending && containers.size() == 1)
+    const_cast<Reader*>(this)->MaterializeAll();
   ContainerInfo const& container = containers.top();
   return container.Count(dataStore);
 }
 
 Reader::CompoundView Reader::Names()
 {
+  if (lazyPending && containers.size() == 1)
+    MaterializeAll();
   ContainerInfo const& container = containers.top();
   if (container.Type() != TAG::Compound)
-    return CompoundView{ nullptr, nullptr };
+    return CompoundView{ nullptr, static_cast<std::vector<Internal::NamedDataTagIndex> const*>(nullptr) };
+
+  TagPayload::Compound const compound = container.CompoundPayload(dataStore);
+  if (compound.shapedRow_ >= 0)
+    return CompoundView{ &dataStore, &dataStore.schemas[dataStore.shapedLists[compound.storageIndex_].schemaIndex].names };
+  return CompoundView { &dataStore, &dataStore.compoundStorage[compound.storageIndex_] };
+}
+
+Reader::ListRange Reader::Compounds(StringView name)
+{
+  return ListRange(this, name, TAG::Compound);
+}
+
+Reader::ListRange Reader::Lists(StringView name)
+{
+  return ListRange(this, name, TAG::List);
+}
+
+Reader::ListRange::ListRange(Reader* reader, StringView name, TAG elementType)
+  : reader(reader)
+  , elementType(elementType)
+{
+  if (!reader->OpenList(name))
+    return;
+  list = &reader->containers.top();
+  if (list->ElementType(reader->dataStore) != elementType)
+    return;
+  count = list->Count(reader->dataStore);
+  if (count == 0)
+    return;
+  // std::stack is backed by a deque, so these pointers stay valid while the loop body opens and closes containers above them
+  reader->containers.push(reader->ListElementContainer(*list, elementType, 0));
+  element = &reader->containers.top();
+  list->currentIndex = 1;
+}
+
+Reader::ListRange::~ListRange()
+{
+  if (element)
+    reader->containers.pop();
+  if (list)
+    reader->CloseList();
+}
 
-  return CompoundView { &dataStore, &dataStore.compoundStorage[container.Storage(dataStore)] };
+void Reader::ListRange::Seek(int32_t index)
+{
+  if (index >= count)
+    return;
+  assert(element == &reader->containers.top() && "Reader : List Iteration Mismatch - A container opened inside the loop body was not closed.");
+  *element = reader->ListElementContainer(*list, elementType, index);
+  list->currentIndex = index + 1;
 }
 
 void Reader::MemoryStream::SetContents(std::vector<uint8_t>&& inData)
 {
-  Clear();
-  data = std::move(inData);
+  position = 0;
+  contents = std::make_shared<std::vector<uint8_t>>(std::move(inData));
+  data = contents->data();
+  size = contents->size();
 }
 
 void Reader::MemoryStream::Clear()
 {
   position = 0;
-  data.clear();
+  contents.reset();
+  data = nullptr;
+  size = 0;
 }
 
 bool Reader::MemoryStream::HasContents() const
 {
-  return position < data.size();
+  return position < size;
 }
 
 char Reader::MemoryStream::CurrentByte() const
@@ -350,7 +694,7 @@ char Reader::MemoryStream::CurrentByte() const
 
 char Reader::MemoryStream::LookaheadByte(int bytes) const
 {
-  assert(position + bytes < data.size());
+  assert(position + bytes < size);
   return data[position + bytes];
 }
 
@@ -528,11 +872,42 @@ Optional<Reader::Token> Reader::TextTokenizer::TryParseString()
 void Reader::Clear()
 {
   dataStore.Clear();
+  dataStore.bigEndianArrays = true;
   decltype(containers)().swap(containers);
+  inVirtualRootCompound = false;
+  lazyPending = false;
+  lazyEntries.clear();
+  deduplicated.clear();
+  deduplicatedByHash.clear();
+  deduplicationMarks.clear();
+  deduplicationStats = {};
 }
 
 bool Reader::ImportCompressedFile(StringView filepath)
 {
+  // files compressed in members on several threads are inflated the same way, any other file as a single stream.
+  // Only the start of the file is read to tell them apart, so other files are read once
+  unsigned const threads = Internal::ThreadCount(importThreads);
+  bool members = false;
+  if (threads > 1)
+  {
+    if (FILE* file = fopen(filepath.data(), "rb"))
+    {
+      std::array<uint8_t, Internal::GzipMembersSignatureSize> signature;
+      members = fread(signature.data(), sizeof(uint8_t), signature.size(), file) == signature.size() && Internal::IsGzipMembers(signature.data());
+      fclose(file);
+    }
+  }
+  if (members && ImportUncompressedFile(filepath))
+  {
+    std::vector<uint8_t> inflated;
+    if (Internal::DecompressGzipMembers(memoryStream.Data(), memoryStream.Size(), inflated, threads))
+    {
+      memoryStream.SetContents(std::move(inflated));
+      return true;
+    }
+  }
+
   gzFile infile = gzopen(filepath.data(), "rb");
   if (!infile) return false;
 
@@ -633,21 +1008,154 @@ bool Reader::ParseBinaryStream()
   if (type != TAG::Compound)
     return false;
   Begin(RetrieveBinaryStr());
+  if (sourcePassthrough)
+    dataStore.sourceBytes = memoryStream.Share();
 
-  do {
-  } while (ParseBinaryNamedTag() != TAG::End);
+  if (lazyImport)
+  {
+    lazyPending = true;
+    lazyScanPosition = memoryStream.Position();
+    return true;
+  }
+
+  size_t const begin = memoryStream.Position();
+  projectionNode = projection.empty() || projection.front().whole ? std::numeric_limits<size_t>::max() : 0;
+  bool const whole = projectionNode == std::numeric_limits<size_t>::max();
+  bool const parsed = ParseBinaryEntries();
+  projectionNode = std::numeric_limits<size_t>::max();
+  if (!parsed)
+    return false;
+  if (dataStore.sourceBytes && whole)
+    dataStore.SetSource(containers.top().CompoundPayload(dataStore), { begin, memoryStream.Position() });
 
   return true;
 }
 
+bool Reader::IndexNextEntry()
+{
+  if (lazyScanPosition >= memoryStream.Size())
+    return false;
+  MemorySource source{ memoryStream.Data() + lazyScanPosition, memoryStream.Size() - lazyScanPosition };
+  uint8_t const* header = source.Peek(3);
+  if (!header || static_cast<TAG>(header[0]) == TAG::End)
+  {
+    lazyScanPosition = memoryStream.Size();
+    return false;
+  }
+  TAG const type = static_cast<TAG>(header[0]);
+  uint16_t const nameLength = Internal::LoadBigEndian<uint16_t>(header + 1);
+  header = source.Peek(3 + size_t(nameLength));
+  if (!header)
+  {
+    lazyScanPosition = memoryStream.Size();
+    return false;
+  }
+  StringView const name{ reinterpret_cast<char const*>(header + 3), nameLength };
+  source.Advance(3 + size_t(nameLength));
+  if (!Internal::SkipBinaryPayload(source, type))
+  {
+    lazyScanPosition = memoryStream.Size();
+    return false;
+  }
+  lazyEntries.push_back({ name, Internal::HashName(name), lazyScanPosition, false, std::nullopt });
+  lazyScanPosition += source.Position();
+  return true;
+}
+
+void Reader::Materialize(StringView name, uint32_t nameHash)
+{
+  for (size_t i = 0;; ++i)
+  {
+    if (i == lazyEntries.size() && !IndexNextEntry())
+      return;
+    LazyEntry& entry = lazyEntries[i];
+    if (entry.nameHash != nameHash || entry.name != name)
+      continue;
+    if (!entry.materialized)
+      DecodeLazyEntry(entry);
+    return;
+  }
+}
+
+void Reader::MaterializeAll()
+{
+  while (IndexNextEntry())
+  {
+  }
+  for (LazyEntry& entry : lazyEntries)
+  {
+    if (!entry.materialized)
+      DecodeLazyEntry(entry);
+  }
+  // entries read on demand were added to the root in the order they were read, so they are put back in the order of the file
+  std::vector<Internal::NamedDataTagIndex> entries;
+  entries.reserve(lazyEntries.size());
+  for (LazyEntry const& entry : lazyEntries)
+  {
+    if (entry.tagIndex)
+      entries.emplace_back(*entry.tagIndex);
+  }
+  dataStore.compoundStorage[RootStorage()] = std::move(entries);
+  lazyPending = false;
+}
+
+uint64_t Reader::RootStorage() const
+{
+  return dataStore.namedTags.front().dataTag.payload.As<TagPayload::Compound>().storageIndex_;
+}
+
+void Reader::DecodeLazyEntry(LazyEntry& entry)
+{
+  // the entry is decoded into the root compound, with whatever the reader has open set aside meanwhile.
+  // swapping the stacks keeps their elements in place, so references into them stay valid
+  decltype(containers) open;
+  open.swap(containers);
+  ContainerInfo root{};
+  root.named = true;
+  root.Type() = TAG::Compound;
+  root.namedContainer.tagIndex = 0;
+  containers.push(root);
+  memoryStream.Seek(entry.offset);
+  size_t const count = std::as_const(dataStore.compoundStorage)[RootStorage()].size();
+  projectionNode = projection.empty() || projection.front().whole ? std::numeric_limits<size_t>::max() : 0;
+  ParseBinaryNamedTag();
+  projectionNode = std::numeric_limits<size_t>::max();
+  containers.swap(open);
+  entry.materialized = true;
+  auto const& rootEntries = std::as_const(dataStore.compoundStorage)[RootStorage()];
+  if (rootEntries.size() > count)
+    entry.tagIndex = rootEntries.back();
+}
+
 TAG Reader::ParseBinaryNamedTag()
 {
   TAG const type = RetrieveBinaryTag();
   if (type == TAG::End)
     return type;
-  auto const name = RetrieveBinaryStr();
-  ParseBinaryPayload(type, name);
-  return type;
+  // names of skipped tags are never copied
+  StringView const name = RetrieveBinaryStrView();
+  if (projectionNode == std::numeric_limits<size_t>::max())
+    return ParseBinaryPayload(type, name) ? type : TAG::INVALID;
+  size_t const child = ProjectedChild(projection, projectionNode, type, name);
+  if (child == 0)
+    return SkipBinaryPayload(type) ? type : TAG::INVALID;
+  size_t const parent = projectionNode;
+  projectionNode = projection[child].whole ? std::numeric_limits<size_t>::max() : child;
+  bool const parsed = ParseBinaryPayload(type, name);
+  projectionNode = parent;
+  return parsed ? type : TAG::INVALID;
+}
+
+bool Reader::ParseBinaryEntries()
+{
+  for (;;)
+  {
+    TAG const type = ParseBinaryNamedTag();
+    if (type == TAG::End)
+      return true;
+    if (type == TAG::INVALID)
+      return false;
+  }
 }
 
 bool Reader::ParseBinaryPayload(TAG type, StringView name)
@@ -691,26 +1199,48 @@ bool Reader::ParseBinaryPayload(TAG type, StringView name)
     }
     break;
     case TAG::List: {
+      size_t const begin = memoryStream.Position();
+      size_t const shapedLists = dataStore.shapedLists.size();
+      bool const whole = projectionNode == std::numeric_limits<size_t>::max();
       if (BeginList(name))
       {
         auto const elementType = RetrieveBinaryTag();
         auto const count = RetrieveBinaryArrayLen();
-        for (int i = 0; i < count; ++i)
+        size_t const parent = projectionNode;
+        if (projectionNode != std::numeric_limits<size_t>::max())
         {
-          ParseBinaryPayload(elementType);
+          // elements cannot be left out without changing the indices of the others, so they are all kept
+          size_t const element = projection[projectionNode].anyIndex;
+          projectionNode = element == 0 || projection[element].whole ? std::numeric_limits<size_t>::max() : element;
         }
+        bool parsed = true;
+        for (int i = 0; parsed && i < count; ++i)
+        {
+          parsed = ParseBinaryPayload(elementType);
+        }
+        projectionNode = parent;
         EndList();
+        if (!parsed)
+          return false;
+        // a list shaped as it ended is passed through as a whole, its elements are no compounds of their own
+        if (dataStore.sourceBytes && whole && dataStore.shapedLists.size() > shapedLists)
+          dataStore.shapedLists[shapedLists].source = { begin, memoryStream.Position() };
       }
       else
         return false;
     }
     break;
     case TAG::Compound: {
+      size_t const begin = memoryStream.Position();
+      bool const whole = projectionNode == std::numeric_limits<size_t>::max();
       if (BeginCompound(name))
       {
-        do {
-        } while (ParseBinaryNamedTag() != TAG::End);
+        bool const parsed = ParseBinaryEntries();
+        if (parsed && dataStore.sourceBytes && whole)
+          dataStore.SetSource(containers.top().CompoundPayload(dataStore), { begin, memoryStream.Position() });
         EndCompound();
+        if (!parsed)
+          return false;
       }
       else
         return false;
@@ -917,6 +1447,12 @@ std::string Reader::RetrieveBinaryStr()
   return str;
 }
 
+StringView Reader::RetrieveBinaryStrView()
+{
+  auto const len = swap_u16(memoryStream.Retrieve<uint16_t>());
+  return { memoryStream.RetrieveRangeView<char>(len), len };
+}
+
 bool Reader::HandleNesting(StringView name, TAG t)
 {
   auto& container = containers.top();
@@ -969,19 +1505,7 @@ bool Reader::OpenContainer(TAG t, StringView name)
   auto& container = containers.top();
   if (container.Type() == TAG::List)
   {
-    ContainerInfo newContainer{};
-    newContainer.named = false;
-    newContainer.type = t;
-    if (t == TAG::List)
-    {
-      newContainer.anonContainer.list.poolIndex_ = dataStore.Pool<TagPayload::List>()[(container.currentIndex - 1) + container.PoolIndex(dataStore)].poolIndex_;
-    }
-    if (t == TAG::Compound)
-    {
-      newContainer.anonContainer.compound.storageIndex_ = dataStore.Pool<TagPayload::Compound>()[(container.currentIndex - 1) + container.PoolIndex(dataStore)].storageIndex_;
-    }
-    containers.push(newContainer);
-
+    containers.push(ListElementContainer(container, t, container.currentIndex - 1));
     return true;
   }
   if (container.Type() == TAG::Compound)
@@ -991,30 +1515,205 @@ bool Reader::OpenContainer(TAG t, StringView name)
       inVirtualRootCompound = true;
       return true;
     }
-    for (Internal::NamedDataTagIndex tagIndex : dataStore.compoundStorage[container.Storage(dataStore)])
-    {
-      NamedDataTag const& tag = dataStore.namedTags[tagIndex];
-      // TODO: if this ever becomes a performance issue, look at changing the vector to a set
-      if (tag.GetName() == name && tag.dataTag.type == t)
-      {
-        ContainerInfo newContainer{};
-        newContainer.named = true;
-        newContainer.type = t;
-        newContainer.namedContainer.tagIndex = tagIndex;
-        containers.push(newContainer);
+    Internal::EntryLocation const entry = LocateNamed(container, name);
+    if (entry.type != t)
+      return false;
+    return OpenEntry(entry);
+  }
+  return false;
+}
 
-        return true;
-      }
+Internal::EntryLocation Reader::LocateNamed(ContainerInfo& container, StringView name)
+{
+  // bounds the plan of a compound that is read from over and over, like the root of a long session
+  constexpr uint32_t MaxDecodeSteps = 256;
+  // bounds the plans of input with ever more shapes. Compounds of shapes seen after that are searched without a plan
+  constexpr size_t MaxDecodePlans = 4096;
+  constexpr int32_t Unplanned = -2;
+  if (lazyPending && containers.size() == 1)
+    Materialize(name, Internal::HashName(name));
+  TagPayload::Compound const compound = container.CompoundPayload(dataStore);
+  if (container.decodePlan == -1)
+  {
+    uint64_t const fingerprint = dataStore.ShapeFingerprint(compound);
+    auto const it = decodePlanIndices.find(fingerprint);
+    if (it != decodePlanIndices.end())
+      container.decodePlan = it->second;
+    else if (decodePlans.size() < MaxDecodePlans)
+    {
+      container.decodePlan = static_cast<int32_t>(decodePlans.size());
+      decodePlanIndices.emplace(fingerprint, container.decodePlan);
+      decodePlans.emplace_back();
     }
+    else
+      container.decodePlan = Unplanned;
   }
-  return false;
+  if (container.decodePlan == Unplanned)
+  {
+    ++decodePlanStats.misses;
+    size_t positionHint = std::numeric_limits<uint32_t>::max();
+    return dataStore.Locate(compound, name, positionHint);
+  }
+  std::vector<uint32_t>& plan = decodePlans[container.decodePlan];
+  uint32_t const step = container.decodeStep++;
+  bool const planned = step < plan.size();
+  size_t positionHint = planned ? plan[step] : std::numeric_limits<uint32_t>::max();
+  size_t const predicted = positionHint;
+  Internal::EntryLocation const entry = dataStore.Locate(compound, name, positionHint);
+  if (planned && entry.type != TAG::End && positionHint == predicted)
+  {
+    ++decodePlanStats.hits;
+    return entry;
+  }
+  ++decodePlanStats.misses;
+  // absent names are recorded too, so that the steps after them stay aligned
+  uint32_t const position = entry.type != TAG::End ? static_cast<uint32_t>(positionHint) : std::numeric_limits<uint32_t>::max();
+  if (planned)
+    plan[step] = position;
+  else if (step < MaxDecodeSteps && step == plan.size())
+    plan.push_back(position);
+  return entry;
+}
+
+DecodePlanStats Reader::GetDecodePlanStats() const
+{
+  return decodePlanStats;
+}
+
+void Reader::ResetDecodePlanStats()
+{
+  decodePlanStats = {};
+}
+
+Internal::EntryLocation Reader::LocateEntry(StringView name, uint32_t nameHash, size_t& positionHint)
+{
+  ContainerInfo const& container = containers.top();
+  if (container.Type() != TAG::Compound)
+    return {};
+  if (lazyPending && containers.size() == 1)
+    Materialize(name, nameHash);
+  return dataStore.Locate(container.CompoundPayload(dataStore), name, nameHash, positionHint);
+}
+
+bool Reader::OpenEntry(Internal::EntryLocation const& entry)
+{
+  if (!Internal::IsContainer(entry.type))
+    return false;
+  ContainerInfo newContainer{};
+  newContainer.type = entry.type;
+  if (entry.shaped)
+  {
+    // elements of shaped lists never hold compounds, only lists
+    newContainer.named = false;
+    newContainer.anonContainer.list = dataStore.Pool<TagPayload::List>()[entry.index];
+  }
+  else
+  {
+    newContainer.named = true;
+    newContainer.namedContainer.tagIndex = entry.index;
+  }
+  containers.push(newContainer);
+  return true;
+}
+
+void Reader::CloseEntry()
+{
+  containers.pop();
+}
+
+TAG Reader::ListElementType() const
+{
+  ContainerInfo const& container = containers.top();
+  if (container.Type() != TAG::List)
+    return TAG::INVALID;
+  return container.ListPayload(dataStore).elementType_;
+}
+
+template<typename T>
+bool Reader::ReadEntry(Internal::EntryLocation const& entry, T& value) const
+{
+  if constexpr (std::is_same_v<T, std::string>)
+  {
+    if (entry.type != TAG::String)
+      return false;
+    auto const& string = dataStore.Payload<TagPayload::String>(entry);
+    value.assign(dataStore.Pool<char>().data() + string.poolIndex_, string.length_);
+  }
+  else if constexpr (std::is_same_v<T, std::vector<int8_t>>)
+  {
+    if (entry.type != TAG::Byte_Array)
+      return false;
+    auto const& byteArray = dataStore.Payload<TagPayload::ByteArray>(entry);
+    auto const* bytePool = dataStore.Pool<byte>().data() + byteArray.poolIndex_;
+    value.assign(bytePool, bytePool + byteArray.count_);
+  }
+  else if constexpr (std::is_same_v<T, std::vector<int32_t>>)
+  {
+    if (entry.type != TAG::Int_Array)
+      return false;
+    auto const& intArray = dataStore.Payload<TagPayload::IntArray>(entry);
+    auto const* intPool = dataStore.Pool<int32_t>().data() + intArray.poolIndex_;
+    value.resize(intArray.count_);
+    std::transform(intPool, intPool + intArray.count_, value.begin(), swap_i32);
+  }
+  else if constexpr (std::is_same_v<T, std::vector<int64_t>>)
+  {
+    if (entry.type != TAG::Long_Array)
+      return false;
+    auto const& longArray = dataStore.Payload<TagPayload::LongArray>(entry);
+    auto const* longPool = dataStore.Pool<int64_t>().data() + longArray.poolIndex_;
+    value.resize(longArray.count_);
+    std::transform(longPool, longPool + longArray.count_, value.begin(), swap_i64);
+  }
+  else if constexpr (std::is_same_v<T, bool>)
+  {
+    if (entry.type != TAG::Byte)
+      return false;
+    value = dataStore.Payload<byte>(entry) != 0;
+  }
+  else
+  {
+    using Traits = Internal::TagTraits<T>;
+    if (entry.type != Traits::Tag)
+      return false;
+    value = dataStore.Payload<typename Traits::Payload>(entry);
+  }
+  return true;
+}
+
+template bool Reader::ReadEntry(Internal::EntryLocation const&, bool&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, int8_t&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, int16_t&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, int32_t&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, int64_t&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, float&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, double&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, std::string&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, std::vector<int8_t>&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, std::vector<int32_t>&) const;
+template bool Reader::ReadEntry(Internal::EntryLocation const&, std::vector<int64_t>&) const;
+
+Builder::ContainerInfo Reader::ListElementContainer(ContainerInfo& list, TAG t, int32_t index)
+{
+  ContainerInfo element{};
+  element.named = false;
+  element.type = t;
+  if (t == TAG::List)
+  {
+    element.anonContainer.list = dataStore.Pool<TagPayload::List>()[list.PoolIndex(dataStore) + index];
+  }
+  if (t == TAG::Compound)
+  {
+    element.anonContainer.compound = dataStore.ListCompound(list.ListPayload(dataStore), index);
+  }
+  return element;
 }
 
 template<typename T>
 T Reader::MemoryStream::Retrieve()
 {
-  assert(position + sizeof(T) <= data.size());
-  T const* valueAddress = reinterpret_cast<T*>(data.data() + position);
+  assert(position + sizeof(T) <= size);
+  T const* valueAddress = reinterpret_cast<T const*>(data + position);
   position += sizeof(T);
   return *valueAddress;
 }
@@ -1022,8 +1721,8 @@ T Reader::MemoryStream::Retrieve()
 template<typename T>
 T const* Reader::MemoryStream::RetrieveRangeView(size_t count)
 {
-  assert(position + sizeof(T) * count <= data.size());
-  T const* valueAddress = reinterpret_cast<T*>(data.data() + position);
+  assert(position + sizeof(T) * count <= size);
+  T const* valueAddress = reinterpret_cast<T const*>(data + position);
   position += sizeof(T) * count;
   return valueAddress;
 }
@@ -1055,7 +1754,7 @@ bool Reader::CheckByte(char byte)
 }
 
 template<typename T>
-T& Reader::ReadValue(TAG t, StringView name)
+T const& Reader::ReadValue(TAG t, StringView name)
 {
   ContainerInfo& container = containers.top();
   if (container.type == TAG::List)
@@ -1064,15 +1763,11 @@ T& Reader::ReadValue(TAG t, StringView name)
   }
   if (container.type == TAG::Compound)
   {
-    // TODO: if this ever becomes a performance issue, look at changing the vector to a set
-    for (auto tagIndex : dataStore.compoundStorage[container.Storage(dataStore)])
+    Internal::EntryLocation const entry = LocateNamed(container, name);
+    if (entry.type != TAG::End)
     {
-      auto& tag = dataStore.namedTags[tagIndex];
-      if (tag.GetName() == name)
-      {
-        assert(tag.dataTag.type == t);
-        return tag.dataTag.payload.As<T>();
-      }
+      assert(entry.type == t);
+      return dataStore.Payload<T>(entry);
     }
   }
 
@@ -1091,17 +1786,10 @@ Optional<T> Reader::MaybeReadValue(TAG t, StringView name)
   }
   if (container.type == TAG::Compound)
   {
-    // TODO: if this ever becomes a performance issue, look at changing the vector to a set
-    for (Internal::NamedDataTagIndex tagIndex : dataStore.compoundStorage[container.Storage(dataStore)])
-    {
-      auto& tag = dataStore.namedTags[tagIndex];
-      if (tag.GetName() == name)
-      {
-        if (tag.dataTag.type != t)
-          return {};
-        return tag.dataTag.payload.As<T>();
-      }
-    }
+    Internal::EntryLocation const entry = LocateNamed(container, name);
+    if (entry.type != t)
+      return std::nullopt;
+    return dataStore.Payload<T>(entry);
   }
   return std::nullopt;
 }
@@ -1,5 +1,11 @@
 #include <ImNBT/NBTRepresentation.hpp>
 
+#include "byteswapping.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
 namespace ImNBT
 {
 
@@ -8,16 +14,49 @@ namespace Internal
 
 bool IsContainer(TAG t) { return t == TAG::List || t == TAG::Compound; }
 
+size_t CompoundSchema::Find(StringView name, uint32_t nameHash, size_t& positionHint) const
+{
+  if (positionHint < names.size() && nameHashes[positionHint] == nameHash && names[positionHint] == name)
+    return positionHint;
+  for (size_t field = 0; field < names.size(); ++field)
+  {
+    if (nameHashes[field] == nameHash && names[field] == name)
+    {
+      positionHint = field;
+      return field;
+    }
+  }
+  return std::numeric_limits<size_t>::max();
+}
+
 } // namespace Internal
 
 StringView NamedDataTag::GetName() const
 {
+  if (borrowedName)
+    return { borrowedName, borrowedLength };
   return { name.data(), name.size() };
 }
 
 void NamedDataTag::SetName(StringView inName)
+{
+  SetName(inName, Internal::HashName(inName));
+}
+
+void NamedDataTag::SetName(StringView inName, uint32_t inNameHash)
 {
   name.assign(inName.data(), inName.size());
+  borrowedName = nullptr;
+  borrowedLength = 0;
+  nameHash = inNameHash;
+}
+
+void NamedDataTag::BorrowName(StringView inName, uint32_t inNameHash)
+{
+  name.clear();
+  borrowedName = inName.data();
+  borrowedLength = static_cast<uint32_t>(inName.size());
+  nameHash = inNameHash;
 }
 
 Internal::NamedDataTagIndex DataStore::AddNamedDataTag(TAG type, StringView name)
@@ -30,11 +69,573 @@ Internal::NamedDataTagIndex DataStore::AddNamedDataTag(TAG type, StringView name
   return namedTags.size() - 1;
 }
 
+size_t DataStore::AddSchema(Internal::CompoundSchema&& schema)
+{
+  // lists with the same key set share one schema
+  for (size_t i = 0; i < schemas.size(); ++i)
+  {
+    if (schemas[i].types == schema.types && schemas[i].names == schema.names)
+      return i;
+  }
+  schemas.push_back(std::move(schema));
+  return schemas.size() - 1;
+}
+
+Internal::EntryLocation DataStore::Locate(TagPayload::Compound const& compound, StringView name, size_t& positionHint) const
+{
+  return Locate(compound, name, Internal::HashName(name), positionHint);
+}
+
+Internal::EntryLocation DataStore::Locate(TagPayload::Compound const& compound, StringView name, uint32_t nameHash, size_t& positionHint) const
+{
+  Internal::EntryLocation entry;
+  if (compound.shapedRow_ >= 0)
+  {
+    Internal::ShapedList const& list = shapedLists[compound.storageIndex_];
+    Internal::CompoundSchema const& schema = schemas[list.schemaIndex];
+    size_t const field = schema.Find(name, nameHash, positionHint);
+    if (field < schema.names.size())
+    {
+      entry.type = schema.types[field];
+      entry.index = list.columns[field] + compound.shapedRow_;
+      entry.shaped = true;
+    }
+    return entry;
+  }
+  auto const& entries = compoundStorage[compound.storageIndex_];
+  auto const matches = [&](NamedDataTag const& tag) {
+    return tag.GetNameHash() == nameHash && tag.GetName() == name;
+  };
+  if (positionHint < entries.size() && matches(namedTags[entries[positionHint]]))
+  {
+    entry.index = entries[positionHint];
+    entry.type = namedTags[entry.index].dataTag.type;
+    return entry;
+  }
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    if (matches(namedTags[entries[i]]))
+    {
+      positionHint = i;
+      entry.index = entries[i];
+      entry.type = namedTags[entry.index].dataTag.type;
+      return entry;
+    }
+  }
+  return entry;
+}
+
+size_t DataStore::EntryCount(TagPayload::Compound const& compound) const
+{
+  if (compound.shapedRow_ >= 0)
+    return schemas[shapedLists[compound.storageIndex_].schemaIndex].names.size();
+  return compoundStorage[compound.storageIndex_].size();
+}
+
+uint64_t DataStore::ShapeFingerprint(TagPayload::Compound const& compound) const
+{
+  size_t const count = EntryCount(compound);
+  if (count == 0)
+    return 0;
+  uint32_t firstHash, lastHash;
+  TAG firstType, lastType;
+  if (compound.shapedRow_ >= 0)
+  {
+    Internal::CompoundSchema const& schema = schemas[shapedLists[compound.storageIndex_].schemaIndex];
+    firstHash = schema.nameHashes.front();
+    lastHash = schema.nameHashes.back();
+    firstType = schema.types.front();
+    lastType = schema.types.back();
+  }
+  else
+  {
+    auto const& entries = compoundStorage[compound.storageIndex_];
+    NamedDataTag const& first = namedTags[entries.front()];
+    NamedDataTag const& last = namedTags[entries.back()];
+    firstHash = first.GetNameHash();
+    lastHash = last.GetNameHash();
+    firstType = first.dataTag.type;
+    lastType = last.dataTag.type;
+  }
+  uint64_t fingerprint = 14695981039346656037ull;
+  for (uint64_t part : { uint64_t(count), uint64_t(firstHash), uint64_t(lastHash), uint64_t(firstType) << 8 | uint64_t(lastType) })
+  {
+    fingerprint ^= part;
+    fingerprint *= 1099511628211ull;
+  }
+  return fingerprint;
+}
+
+std::vector<std::pair<StringView, DataTag>> DataStore::SortedEntries(TagPayload::Compound const& compound) const
+{
+  std::vector<std::pair<StringView, DataTag>> entries;
+  entries.reserve(EntryCount(compound));
+  ForEachEntry(compound, [&](StringView name, DataTag const& tag) { entries.emplace_back(name, tag); });
+  std::stable_sort(entries.begin(), entries.end(), [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+  return entries;
+}
+
+TagPayload::Compound DataStore::ListCompound(TagPayload::List const& list, int32_t index) const
+{
+  assert(list.elementType_ == TAG::Compound);
+  if (list.shaped_)
+    return TagPayload::Compound{ list.poolIndex_, index };
+  return Pool<TagPayload::Compound>()[list.poolIndex_ + index];
+}
+
+DataTag DataStore::ShapedEntry(Internal::ShapedList const& list, int32_t row, size_t field) const
+{
+  DataTag tag{ schemas[list.schemaIndex].types[field] };
+  Internal::WithPayloadType(tag.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    tag.payload.Set<T>(Pool<T>()[list.columns[field] + row]);
+  });
+  return tag;
+}
+
+DataTag DataStore::EntryTag(Internal::EntryLocation const& entry) const
+{
+  if (!entry.shaped)
+    return namedTags[entry.index].dataTag;
+  DataTag tag{ entry.type };
+  Internal::WithPayloadType(tag.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    tag.payload.Set<T>(Pool<T>()[entry.index]);
+  });
+  return tag;
+}
+
+DataTag DataStore::ListElement(TagPayload::List const& list, int32_t index) const
+{
+  DataTag tag{ list.elementType_ };
+  if (tag.type == TAG::Compound)
+  {
+    tag.payload.Set<TagPayload::Compound>(ListCompound(list, index));
+    return tag;
+  }
+  Internal::WithPayloadType(tag.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    tag.payload.Set<T>(Pool<T>()[list.poolIndex_ + index]);
+  });
+  return tag;
+}
+
+Internal::SourceRange DataStore::Source(TagPayload::Compound const& compound) const
+{
+  if (!sourceBytes || compound.shapedRow_ >= 0 || compound.storageIndex_ >= compoundSources.size())
+    return {};
+  return compoundSources[compound.storageIndex_];
+}
+
+Internal::SourceRange DataStore::Source(TagPayload::List const& list) const
+{
+  if (!sourceBytes || !list.shaped_ || list.count_ == 0)
+    return {};
+  return shapedLists[list.poolIndex_].source;
+}
+
+void DataStore::SetSource(TagPayload::Compound const& compound, Internal::SourceRange source)
+{
+  if (compoundSources.size() <= compound.storageIndex_)
+    compoundSources.resize(compound.storageIndex_ + 1);
+  compoundSources[compound.storageIndex_] = source;
+}
+
+void DataStore::MarkChanged(DataTag const& tag)
+{
+  // ranges and hashes are only written when set, so changes do not copy the segments of tables shared with other stores
+  if (tag.type == TAG::Compound)
+  {
+    TagPayload::Compound const& compound = tag.payload.As<TagPayload::Compound>();
+    if (compound.shapedRow_ >= 0 && !std::as_const(*this).shapedLists[compound.storageIndex_].source.empty())
+      shapedLists[compound.storageIndex_].source = {};
+    else if (!Source(compound).empty())
+      compoundSources[compound.storageIndex_] = {};
+    if (compound.shapedRow_ >= 0)
+    {
+      auto const& rowHashes = std::as_const(*this).shapedLists[compound.storageIndex_].rowHashes;
+      size_t const row = static_cast<size_t>(compound.shapedRow_);
+      if (row < rowHashes.size() && (rowHashes[row].stored != 0 || rowHashes[row].canonical != 0))
+        shapedLists[compound.storageIndex_].rowHashes[row] = {};
+    }
+    else if (compound.storageIndex_ < compoundHashes.size())
+    {
+      Internal::ContentHashes const& hashes = std::as_const(compoundHashes)[compound.storageIndex_];
+      if (hashes.stored != 0 || hashes.canonical != 0)
+        compoundHashes[compound.storageIndex_] = {};
+    }
+  }
+  else if (tag.type == TAG::List && !Source(tag.payload.As<TagPayload::List>()).empty())
+  {
+    shapedLists[tag.payload.As<TagPayload::List>().poolIndex_].source = {};
+  }
+}
+
+bool DataStore::IsShared(TagPayload::Compound const& compound) const
+{
+  return compound.shapedRow_ < 0 && compound.storageIndex_ < sharedCompounds.size() && sharedCompounds[compound.storageIndex_] != 0;
+}
+
+void DataStore::MarkShared(TagPayload::Compound const& compound)
+{
+  if (IsShared(compound))
+    return;
+  if (sharedCompounds.size() <= compound.storageIndex_)
+    sharedCompounds.resize(compound.storageIndex_ + 1);
+  sharedCompounds[compound.storageIndex_] = 1;
+}
+
+namespace
+{
+
+// the pool holding the values of an array or string payload, and how many values it holds
+template<typename Payload>
+struct PooledValues
+{
+  using Value = void;
+};
+template<>
+struct PooledValues<TagPayload::ByteArray>
+{
+  using Value = byte;
+  static size_t Length(TagPayload::ByteArray const& array) { return array.count_; }
+};
+template<>
+struct PooledValues<TagPayload::IntArray>
+{
+  using Value = int32_t;
+  static size_t Length(TagPayload::IntArray const& array) { return array.count_; }
+};
+template<>
+struct PooledValues<TagPayload::LongArray>
+{
+  using Value = int64_t;
+  static size_t Length(TagPayload::LongArray const& array) { return array.count_; }
+};
+template<>
+struct PooledValues<TagPayload::String>
+{
+  using Value = char;
+  static size_t Length(TagPayload::String const& string) { return string.length_; }
+};
+
+// copies the values a payload refers to from one store to another, and returns the payload of the copy
+struct PayloadCopier
+{
+  DataStore& to;
+  DataStore const& from;
+  // ranges are kept for copies within stores of the same source document
+  bool const sameSource = to.sourceBytes && to.sourceBytes == from.sourceBytes;
+  // int and long arrays change byte order between a Reader's store and a Writer's
+  bool const swapArrays = to.bigEndianArrays != from.bigEndianArrays;
+
+  template<typename T>
+  T Copy(T const& value)
+  {
+    return value;
+  }
+
+  // appends length values of the pool of Value starting at first, and returns where the copies start
+  template<typename Value>
+  size_t CopyValues(size_t first, size_t length)
+  {
+    auto& pool = to.Pool<Value>();
+    size_t const copied = pool.size();
+    Value const* values = from.Pool<Value>().data() + first;
+    if constexpr (std::is_same_v<Value, int32_t> || std::is_same_v<Value, int64_t>)
+    {
+      if (swapArrays)
+      {
+        std::vector<Value> swapped(values, values + length);
+        std::transform(swapped.begin(), swapped.end(), swapped.begin(), [](Value value) {
+          if constexpr (sizeof(Value) == sizeof(int32_t))
+            return swap_i32(value);
+          else
+            return swap_i64(value);
+        });
+        pool.append(swapped.data(), swapped.data() + length);
+        return copied;
+      }
+    }
+    pool.append(values, values + length);
+    return copied;
+  }
+
+  template<typename Payload>
+  Payload CopyPooled(Payload payload)
+  {
+    payload.poolIndex_ = CopyValues<typename PooledValues<Payload>::Value>(payload.poolIndex_, PooledValues<Payload>::Length(payload));
+    return payload;
+  }
+
+  // values of strings and arrays a copy appends, counted first so each pool grows once instead of doubling along the way
+  size_t neededBytes = 0;
+  size_t neededInts = 0;
+  size_t neededLongs = 0;
+  size_t neededChars = 0;
+
+  template<typename T>
+  void Count(T const&)
+  {
+  }
+
+  void Count(TagPayload::ByteArray const& array) { neededBytes += array.count_; }
+  void Count(TagPayload::IntArray const& array) { neededInts += array.count_; }
+  void Count(TagPayload::LongArray const& array) { neededLongs += array.count_; }
+  void Count(TagPayload::String const& string) { neededChars += string.length_; }
+
+  void Count(DataTag const& tag)
+  {
+    Internal::WithPayloadType(tag.type, [&](auto type) {
+      using T = typename decltype(type)::Type;
+      Count(tag.payload.As<T>());
+    });
+  }
+
+  template<typename T>
+  void CountColumn(size_t first, int32_t count)
+  {
+    if constexpr (!std::is_arithmetic_v<T> && !std::is_same_v<T, byte>)
+    {
+      for (int32_t i = 0; i < count; ++i)
+        Count(from.Pool<T>()[first + i]);
+    }
+  }
+
+  void Count(TagPayload::List const& list)
+  {
+    if (list.count_ == 0)
+      return;
+    if (list.shaped_)
+    {
+      Internal::ShapedList const& shaped = from.shapedLists[list.poolIndex_];
+      Internal::CompoundSchema const& schema = from.schemas[shaped.schemaIndex];
+      for (size_t field = 0; field < shaped.columns.size(); ++field)
+      {
+        Internal::WithPayloadType(schema.types[field], [&](auto type) {
+          CountColumn<typename decltype(type)::Type>(shaped.columns[field], list.count_);
+        });
+      }
+      return;
+    }
+    Internal::WithPayloadType(list.elementType_, [&](auto type) {
+      CountColumn<typename decltype(type)::Type>(list.poolIndex_, list.count_);
+    });
+  }
+
+  void Count(TagPayload::Compound const& compound)
+  {
+    if (compound.shapedRow_ >= 0)
+    {
+      Internal::ShapedList const& list = from.shapedLists[compound.storageIndex_];
+      for (size_t field = 0; field < list.columns.size(); ++field)
+        Count(from.ShapedEntry(list, compound.shapedRow_, field));
+      return;
+    }
+    for (Internal::NamedDataTagIndex tagIndex : from.compoundStorage[compound.storageIndex_])
+      Count(from.namedTags[tagIndex].dataTag);
+  }
+
+  void Reserve(DataTag const& tag)
+  {
+    Count(tag);
+    to.Pool<byte>().reserve(to.Pool<byte>().size() + neededBytes);
+    to.Pool<int32_t>().reserve(to.Pool<int32_t>().size() + neededInts);
+    to.Pool<int64_t>().reserve(to.Pool<int64_t>().size() + neededLongs);
+    to.Pool<char>().reserve(to.Pool<char>().size() + neededChars);
+  }
+
+  TagPayload::ByteArray Copy(TagPayload::ByteArray const& array) { return CopyPooled(array); }
+  TagPayload::IntArray Copy(TagPayload::IntArray const& array) { return CopyPooled(array); }
+  TagPayload::LongArray Copy(TagPayload::LongArray const& array) { return CopyPooled(array); }
+  TagPayload::String Copy(TagPayload::String const& string) { return CopyPooled(string); }
+
+  // copies count values of the pool of T starting at first, and returns where the copies start
+  template<typename T>
+  size_t CopyColumn(size_t first, int32_t count)
+  {
+    auto& pool = to.Pool<T>();
+    T const* values = from.Pool<T>().data() + first;
+    std::vector<T> copies;
+    if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, byte>)
+    {
+      size_t const copied = pool.size();
+      pool.append(values, values + count);
+      return copied;
+    }
+    else if constexpr (!std::is_void_v<typename PooledValues<T>::Value>)
+    {
+      // strings and arrays read or written one after another keep their values adjacent, so each run of them is copied as one range
+      copies.assign(values, values + count);
+      for (int32_t run = 0; run < count;)
+      {
+        size_t const begin = copies[run].poolIndex_;
+        size_t end = begin + PooledValues<T>::Length(copies[run]);
+        int32_t next = run + 1;
+        for (; next < count && copies[next].poolIndex_ == end; ++next)
+          end += PooledValues<T>::Length(copies[next]);
+        size_t const moved = CopyValues<typename PooledValues<T>::Value>(begin, end - begin);
+        for (int32_t i = run; i < next; ++i)
+          copies[i].poolIndex_ = copies[i].poolIndex_ - begin + moved;
+        run = next;
+      }
+    }
+    else
+    {
+      // nested values are copied first, so the copied payloads can be appended as one range
+      copies.reserve(count);
+      for (int32_t i = 0; i < count; ++i)
+        copies.push_back(Copy(values[i]));
+    }
+    size_t const copied = pool.size();
+    pool.append(copies.begin(), copies.end());
+    return copied;
+  }
+
+  TagPayload::List Copy(TagPayload::List list)
+  {
+    if (list.count_ == 0)
+      return list;
+    if (list.shaped_)
+    {
+      Internal::ShapedList const& shaped = from.shapedLists[list.poolIndex_];
+      Internal::CompoundSchema schema = from.schemas[shaped.schemaIndex];
+      Internal::ShapedList copy;
+      copy.columns.reserve(shaped.columns.size());
+      for (size_t field = 0; field < shaped.columns.size(); ++field)
+      {
+        copy.columns.push_back(Internal::WithPayloadType(schema.types[field], [&](auto type) {
+          return CopyColumn<typename decltype(type)::Type>(shaped.columns[field], list.count_);
+        }));
+      }
+      copy.schemaIndex = to.AddSchema(std::move(schema));
+      if (sameSource)
+        copy.source = shaped.source;
+      to.shapedLists.push_back(std::move(copy));
+      list.poolIndex_ = to.shapedLists.size() - 1;
+      return list;
+    }
+    list.poolIndex_ = Internal::WithPayloadType(list.elementType_, [&](auto type) {
+      return CopyColumn<typename decltype(type)::Type>(list.poolIndex_, list.count_);
+    });
+    return list;
+  }
+
+  // copies of the shared compounds copied so far, by storage index
+  std::unordered_map<size_t, TagPayload::Compound> sharedCopies{};
+
+  TagPayload::Compound Copy(TagPayload::Compound const& compound)
+  {
+    bool const shared = from.IsShared(compound);
+    if (shared)
+    {
+      auto const copied = sharedCopies.find(compound.storageIndex_);
+      if (copied != sharedCopies.end())
+      {
+        to.MarkShared(copied->second);
+        return copied->second;
+      }
+    }
+    std::vector<Internal::NamedDataTagIndex> entries;
+    auto const add = [&](StringView name, uint32_t nameHash, DataTag const& tag) {
+      NamedDataTag entry;
+      entry.dataTag = tag;
+      Internal::WithPayloadType(tag.type, [&](auto type) {
+        using T = typename decltype(type)::Type;
+        entry.dataTag.payload.Set<T>(Copy(tag.payload.As<T>()));
+      });
+      entry.SetName(name, nameHash);
+      entries.push_back(to.namedTags.size());
+      to.namedTags.push_back(std::move(entry));
+    };
+    if (compound.shapedRow_ >= 0)
+    {
+      Internal::ShapedList const& list = from.shapedLists[compound.storageIndex_];
+      Internal::CompoundSchema const& schema = from.schemas[list.schemaIndex];
+      for (size_t field = 0; field < schema.names.size(); ++field)
+        add(schema.names[field], schema.nameHashes[field], from.ShapedEntry(list, compound.shapedRow_, field));
+    }
+    else
+    {
+      for (Internal::NamedDataTagIndex tagIndex : from.compoundStorage[compound.storageIndex_])
+      {
+        NamedDataTag const& tag = from.namedTags[tagIndex];
+        add(tag.GetName(), tag.GetNameHash(), tag.dataTag);
+      }
+    }
+    TagPayload::Compound copy{ to.compoundStorage.size() };
+    to.compoundStorage.push_back(std::move(entries));
+    if (sameSource && !from.Source(compound).empty())
+      to.SetSource(copy, from.Source(compound));
+    if (shared)
+      sharedCopies.emplace(compound.storageIndex_, copy);
+    return copy;
+  }
+};
+
+} // namespace
+
+DataTag DataStore::CopyTag(DataStore const& source, DataTag const& tag)
+{
+  DataTag copy{ tag.type };
+  PayloadCopier copier{ *this, source };
+  copier.Reserve(tag);
+  Internal::WithPayloadType(tag.type, [&](auto type) {
+    using T = typename decltype(type)::Type;
+    copy.payload.Set<T>(copier.Copy(tag.payload.As<T>()));
+  });
+  return copy;
+}
+
+size_t DataStore::MemoryUsage() const
+{
+  size_t usage = sizeof(DataStore);
+  std::apply([&usage](auto const&... pools) { ((usage += pools.Borrowed() ? 0 : pools.capacity() * sizeof(typename std::decay_t<decltype(pools)>::value_type)), ...); }, this->pools);
+  usage += namedTags.capacity() * sizeof(NamedDataTag);
+  for (NamedDataTag const& tag : namedTags)
+  {
+    // names beyond the small string buffer are held separately
+    if (!tag.BorrowsName() && tag.GetName().size() >= sizeof(std::string))
+      usage += tag.GetName().size() + 1;
+  }
+  usage += compoundStorage.capacity() * sizeof(compoundStorage.front());
+  for (auto const& storage : compoundStorage)
+    usage += storage.capacity() * sizeof(Internal::NamedDataTagIndex);
+  usage += schemas.capacity() * sizeof(Internal::CompoundSchema) + shapedLists.capacity() * sizeof(Internal::ShapedList);
+  for (Internal::ShapedList const& list : shapedLists)
+    usage += list.columns.capacity() * sizeof(size_t) + list.rowHashes.capacity() * sizeof(Internal::ContentHashes);
+  usage += compoundSources.capacity() * sizeof(Internal::SourceRange);
+  usage += compoundHashes.capacity() * sizeof(Internal::ContentHashes) + sharedCompounds.capacity();
+  if (sourceBytes)
+    usage += sourceBytes->capacity();
+  return usage;
+}
+
+size_t DataStore::MemoryUsage(DataStore const& base) const
+{
+  size_t usage = 0;
+  std::apply([&](auto const&... pools) { ((usage += pools.UnsharedBytes(std::get<std::decay_t<decltype(pools)>>(base.pools))), ...); }, this->pools);
+  usage += namedTags.UnsharedBytes(base.namedTags) + compoundStorage.UnsharedBytes(base.compoundStorage);
+  usage += schemas.UnsharedBytes(base.schemas) + shapedLists.UnsharedBytes(base.shapedLists);
+  usage += compoundSources.UnsharedBytes(base.compoundSources) + compoundHashes.UnsharedBytes(base.compoundHashes);
+  usage += sharedCompounds.UnsharedBytes(base.sharedCompounds);
+  if (sourceBytes && sourceBytes != base.sourceBytes)
+    usage += sourceBytes->capacity();
+  return usage;
+}
+
 void DataStore::Clear()
 
 {
   compoundStorage.clear();
   namedTags.clear();
+  schemas.clear();
+  shapedLists.clear();
+  sourceBytes.reset();
+  compoundSources.clear();
+  frozenImage.reset();
+  compoundHashes.clear();
+  sharedCompounds.clear();
   Internal::Pools<byte, int16_t, int32_t, int64_t, float, double, char,
                   TagPayload::ByteArray, TagPayload::IntArray,
                   TagPayload::LongArray, TagPayload::String,
@@ -0,0 +1,75 @@
+#include <ImNBT/NBTVisitor.hpp>
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+namespace ImNBT
+{
+
+FileSource::FileSource(StringView filepath)
+{
+  // gzread passes files without a gzip header through unchanged
+  file = gzopen(std::string(filepath).c_str(), "rb");
+  if (file)
+    gzbuffer(static_cast<gzFile>(file), 64 * 1024);
+}
+
+FileSource::~FileSource()
+{
+  if (file)
+    gzclose(static_cast<gzFile>(file));
+}
+
+uint8_t const* FileSource::Peek(size_t count)
+{
+  if (end - begin < count && !Fill(count))
+    return nullptr;
+  return buffer.data() + begin;
+}
+
+bool FileSource::Skip(size_t count)
+{
+  size_t const buffered = std::min(count, end - begin);
+  begin += buffered;
+  count -= buffered;
+  if (count == 0)
+    return true;
+  // the buffer is drained, read the rest past it
+  consumed += end;
+  begin = end = 0;
+  std::array<uint8_t, 8192> scratch;
+  while (count > 0)
+  {
+    int const chunk = static_cast<int>(std::min(count, scratch.size()));
+    int const read = gzread(static_cast<gzFile>(file), scratch.data(), chunk);
+    if (read <= 0)
+      return false;
+    consumed += read;
+    count -= read;
+  }
+  return true;
+}
+
+bool FileSource::Fill(size_t count)
+{
+  // move the unconsumed bytes to the front, so the buffer only grows for tags larger than it
+  consumed += begin;
+  std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+  end -= begin;
+  begin = 0;
+  if (buffer.size() < std::max<size_t>(count, 64 * 1024))
+    buffer.resize(std::max<size_t>(count, 64 * 1024));
+  while (end < count)
+  {
+    int const read = gzread(static_cast<gzFile>(file), buffer.data() + end, static_cast<unsigned>(buffer.size() - end));
+    if (read <= 0)
+      return false;
+    end += read;
+  }
+  return true;
+}
+
+} // namespace ImNBT
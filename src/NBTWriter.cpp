@@ -1,12 +1,17 @@
 #include <ImNBT/NBTWriter.hpp>
 
 #include "byteswapping.h"
+#include "gzipmembers.h"
+#include "parallel.h"
 
 #include "zlib.h"
 
+#include <algorithm>
+#include <cassert>
 #include <iomanip>
 #include <sstream>
 #include <cstring>
+#include <utility>
 
 namespace ImNBT
 {
@@ -30,9 +35,33 @@ void Store(std::vector<uint8_t>& v, T const& data)
 template<typename T>
 void StoreRange(std::vector<uint8_t>& v, T* data, size_t count)
 {
-  auto const size = v.size();
-  v.resize(size + sizeof(T) * count);
-  std::memcpy(v.data() + size, data, sizeof(T) * count);
+  // inserting copies once, where resizing would clear the bytes first
+  auto const* bytes = reinterpret_cast<uint8_t const*>(data);
+  v.insert(v.end(), bytes, bytes + sizeof(T) * count);
+}
+
+// a part of the output of a parallel export, written in place. Positions are relative to the start of the document
+struct PlacedOutput
+{
+  uint8_t* data;
+  size_t position;
+
+  size_t size() const { return position; }
+  void reserve(size_t) {}
+};
+
+template<typename T>
+void Store(PlacedOutput& out, T const& data)
+{
+  std::memcpy(out.data + out.position, &data, sizeof(T));
+  out.position += sizeof(T);
+}
+
+template<typename T>
+void StoreRange(PlacedOutput& out, T* data, size_t count)
+{
+  std::memcpy(out.data + out.position, data, sizeof(T) * count);
+  out.position += sizeof(T) * count;
 }
 
 std::string EscapeQuotes(std::string_view inStr)
@@ -89,11 +118,51 @@ public:
 
 // private implementations
 
+template<typename Fn>
+void Writer::ForEachEntry(TagPayload::Compound const& compound, Fn&& fn) const
+{
+  if (!canonicalOrder)
+  {
+    dataStore.ForEachEntry(compound, fn);
+    return;
+  }
+  for (auto const& [name, entry] : dataStore.SortedEntries(compound))
+    fn(name, entry);
+}
+
 Writer::Writer()
 {
   Begin();
 }
 
+Writer::Writer(DocumentPtr document)
+{
+  if (document)
+  {
+    dataStore = document->dataStore;
+  }
+  else
+  {
+    Begin();
+    Finalize();
+  }
+}
+
+Writer::Writer(Reader& reader)
+{
+  if (reader.lazyPending)
+    reader.MaterializeAll();
+  if (!reader.dataStore.namedTags.empty())
+  {
+    dataStore = reader.dataStore;
+  }
+  else
+  {
+    Begin();
+    Finalize();
+  }
+}
+
 Writer::~Writer()
 {
   Finalize();
@@ -157,6 +226,18 @@ bool Writer::ExportBinaryFile(StringView filepath)
     return false;
   }
 
+  // large documents are compressed as independent members on several threads, which are written as they are
+  unsigned const threads = Internal::ThreadCount(exportThreads);
+  if (threads > 1 && data.size() > Internal::GzipMemberSize)
+  {
+    std::vector<std::vector<uint8_t>> const members = Internal::CompressGzipMembers(data.data(), data.size(), threads);
+    bool written = !members.empty();
+    for (std::vector<uint8_t> const& member : members)
+      written = written && fwrite(member.data(), sizeof(uint8_t), member.size(), file) == member.size();
+    fclose(file);
+    return written;
+  }
+
   z_stream zs{};
   zs.avail_in = static_cast<uint32_t>(data.size());
   zs.next_in = data.data();
@@ -185,7 +266,7 @@ bool Writer::ExportString(std::string& out, PrettyPrint prettyPrint)
     return false;
   textOutputState = {};
   textOutputState.prettyPrint = prettyPrint;
-  auto const& root = dataStore.namedTags[0];
+  auto const& root = std::as_const(dataStore).namedTags[0];
   std::stringstream outStream(out);
   OutputTextTag(outStream, root);
   out = outStream.str();
@@ -196,26 +277,65 @@ bool Writer::ExportBinary(std::vector<uint8_t>& out)
 {
   if (!Finalized())
     return false;
-  auto const& root = dataStore.namedTags[0];
+  unsigned const threads = Internal::ThreadCount(exportThreads);
+  if (threads > 1 && !encodedRanges && ExportBinaryParallel(out, threads))
+    return true;
+  auto const& root = std::as_const(dataStore).namedTags[0];
+  // a document read from binary is about the size it was read as
+  if (dataStore.sourceBytes)
+    out.reserve(out.size() + dataStore.sourceBytes->size());
   OutputBinaryTag(out, root);
   return true;
 }
 
-void Writer::OutputBinaryTag(std::vector<uint8_t>& out, NamedDataTag const& tag)
+template<typename Out>
+void Writer::OutputBinaryTag(Out& out, NamedDataTag const& tag) const
+{
+  OutputBinaryTag(out, tag.GetName(), tag.dataTag);
+}
+
+template<typename Out>
+void Writer::OutputBinaryTag(Out& out, StringView name, DataTag const& tag) const
 {
-  Store(out, tag.dataTag.type);
-  OutputBinaryStr(out, tag.GetName());
-  OutputBinaryPayload(out, tag.dataTag);
+  Store(out, tag.type);
+  OutputBinaryStr(out, name);
+  OutputBinaryPayload(out, tag);
 }
 
-void Writer::OutputBinaryStr(std::vector<uint8_t>& out, StringView str)
+template<typename Out>
+void Writer::OutputBinaryStr(Out& out, StringView str) const
 {
   uint16_t const lenBigEndian = swap_u16(static_cast<int16_t>(str.length()));
   Store(out, lenBigEndian);
   StoreRange(out, str.data(), str.length());
 }
 
-void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
+template<typename Out>
+void Writer::OutputBinaryPayload(Out& out, DataTag const& tag) const
+{
+  if (!encodedRanges || !Internal::IsContainer(tag.type))
+  {
+    OutputBinaryContents(out, tag);
+    return;
+  }
+  size_t const begin = out.size();
+  ++encodedRanges->depth;
+  OutputBinaryContents(out, tag);
+  --encodedRanges->depth;
+  Internal::SourceRange const range{ begin, out.size() };
+  Internal::SourceRange const source = canonicalOrder ? Internal::SourceRange{} : tag.type == TAG::Compound ? dataStore.Source(tag.payload.As<TagPayload::Compound>()) : dataStore.Source(tag.payload.As<TagPayload::List>());
+  if (!source.empty())
+    encodedRanges->copies.emplace_back(source, begin);
+  if (encodedRanges->depth > 1 && range.end - range.begin < encodedRanges->threshold)
+    return;
+  if (tag.type == TAG::Compound && tag.payload.As<TagPayload::Compound>().shapedRow_ < 0)
+    encodedRanges->compounds.emplace_back(tag.payload.As<TagPayload::Compound>().storageIndex_, range);
+  else if (tag.type == TAG::List && tag.payload.As<TagPayload::List>().shaped_)
+    encodedRanges->shapedLists.emplace_back(tag.payload.As<TagPayload::List>().poolIndex_, range);
+}
+
+template<typename Out>
+void Writer::OutputBinaryContents(Out& out, DataTag const& tag) const
 {
   switch (tag.type)
   {
@@ -253,6 +373,11 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
       auto& intArray = tag.payload.As<TagPayload::IntArray>();
       auto intPool = dataStore.Pool<int32_t>().data() + intArray.poolIndex_;
       Store(out, swap_i32(intArray.count_));
+      if (dataStore.bigEndianArrays)
+      {
+        StoreRange(out, intPool, intArray.count_);
+        break;
+      }
       for (int i = 0; i < intArray.count_; ++i)
       {
         Store(out, swap_i32(intPool[i]));
@@ -263,6 +388,11 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
       auto& longArray = tag.payload.As<TagPayload::LongArray>();
       auto longPool = dataStore.Pool<int64_t>().data() + longArray.poolIndex_;
       Store(out, swap_i32(longArray.count_));
+      if (dataStore.bigEndianArrays)
+      {
+        StoreRange(out, longPool, longArray.count_);
+        break;
+      }
       for (int i = 0; i < longArray.count_; ++i)
       {
         Store(out, swap_i64(longPool[i]));
@@ -277,6 +407,13 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
     break;
     case TAG::List: {
       auto& list = tag.payload.As<TagPayload::List>();
+      // shaped lists and compounds that are unchanged since they were read are copied as they were read
+      Internal::SourceRange const source = canonicalOrder ? Internal::SourceRange{} : dataStore.Source(list);
+      if (!source.empty())
+      {
+        StoreRange(out, dataStore.sourceBytes->data() + source.begin, source.end - source.begin);
+        return;
+      }
       if (list.count_ == 0)
       {
         Store(out, TAG::End);
@@ -353,6 +490,11 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
             auto const& intArray = intArrayPool[i];
             auto const* intPool = dataStore.Pool<int32_t>().data() + intArray.poolIndex_;
             Store(out, swap_i32(intArray.count_));
+            if (dataStore.bigEndianArrays)
+            {
+              StoreRange(out, intPool, intArray.count_);
+              continue;
+            }
             for (int j = 0; j < intArray.count_; ++j)
             {
               Store(out, swap_i32(intPool[j]));
@@ -367,6 +509,11 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
             auto const& longArray = longArrayPool[i];
             auto const* longPool = dataStore.Pool<int64_t>().data() + longArray.poolIndex_;
             Store(out, swap_i32(longArray.count_));
+            if (dataStore.bigEndianArrays)
+            {
+              StoreRange(out, longPool, longArray.count_);
+              continue;
+            }
             for (int j = 0; j < longArray.count_; ++j)
             {
               Store(out, swap_i64(longPool[j]));
@@ -396,12 +543,11 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
         }
         break;
         case TAG::Compound: {
-          auto const* compoundPool = dataStore.Pool<TagPayload::Compound>().data() + list.poolIndex_;
           for (int i = 0; i < list.count_; ++i)
           {
             DataTag subcompoundTag;
             subcompoundTag.type = TAG::Compound;
-            subcompoundTag.payload.Set(compoundPool[i]);
+            subcompoundTag.payload.Set(dataStore.ListCompound(list, i));
             OutputBinaryPayload(out, subcompoundTag);
           }
         }
@@ -411,33 +557,199 @@ void Writer::OutputBinaryPayload(std::vector<uint8_t>& out, DataTag const& tag)
     break;
     case TAG::Compound: {
       auto& compound = tag.payload.As<TagPayload::Compound>();
-      for (auto namedTagIndex : dataStore.compoundStorage[compound.storageIndex_])
+      Internal::SourceRange const source = canonicalOrder ? Internal::SourceRange{} : dataStore.Source(compound);
+      if (!source.empty())
       {
-        OutputBinaryTag(out, dataStore.namedTags[namedTagIndex]);
+        StoreRange(out, dataStore.sourceBytes->data() + source.begin, source.end - source.begin);
+        return;
       }
+      ForEachEntry(compound, [&](StringView name, DataTag const& entry) {
+        OutputBinaryTag(out, name, entry);
+      });
       Store(out, TAG::End);
     }
     break;
   }
 }
 
-void Writer::OutputTextTag(std::ostream& out, NamedDataTag const& tag)
+size_t Writer::BinaryPayloadSize(DataTag const& tag) const
+{
+  switch (tag.type)
+  {
+    case TAG::Byte_Array:
+      return sizeof(int32_t) + size_t(tag.payload.As<TagPayload::ByteArray>().count_);
+    case TAG::Int_Array:
+      return sizeof(int32_t) + sizeof(int32_t) * tag.payload.As<TagPayload::IntArray>().count_;
+    case TAG::Long_Array:
+      return sizeof(int32_t) + sizeof(int64_t) * tag.payload.As<TagPayload::LongArray>().count_;
+    case TAG::String:
+      return sizeof(uint16_t) + tag.payload.As<TagPayload::String>().length_;
+    case TAG::List: {
+      auto const& list = tag.payload.As<TagPayload::List>();
+      Internal::SourceRange const source = canonicalOrder ? Internal::SourceRange{} : dataStore.Source(list);
+      if (!source.empty())
+        return source.end - source.begin;
+      size_t size = sizeof(TAG) + sizeof(int32_t);
+      if (list.count_ == 0)
+        return size;
+      switch (list.elementType_)
+      {
+        case TAG::Byte: case TAG::Short: case TAG::Int: case TAG::Long: case TAG::Float: case TAG::Double:
+          return size + Internal::WithPayloadType(list.elementType_, [&](auto type) { return sizeof(typename decltype(type)::Type); }) * list.count_;
+        default:
+          for (int32_t i = 0; i < list.count_; ++i)
+            size += BinaryPayloadSize(dataStore.ListElement(list, i));
+          return size;
+      }
+    }
+    case TAG::Compound: {
+      auto const& compound = tag.payload.As<TagPayload::Compound>();
+      Internal::SourceRange const source = canonicalOrder ? Internal::SourceRange{} : dataStore.Source(compound);
+      if (!source.empty())
+        return source.end - source.begin;
+      // the order of the entries does not change the size
+      size_t size = sizeof(TAG);
+      dataStore.ForEachEntry(compound, [&](StringView name, DataTag const& entry) {
+        size += sizeof(TAG) + sizeof(uint16_t) + name.size() + BinaryPayloadSize(entry);
+      });
+      return size;
+    }
+    default:
+      return Internal::WithPayloadType(tag.type, [&](auto type) { return sizeof(typename decltype(type)::Type); });
+  }
+}
+
+template<typename Fn>
+void Writer::BinaryPlan::Frame(Fn&& write)
+{
+  size_t const begin = frames.size();
+  write(frames);
+  size_t const end = frames.size();
+  if (end == begin)
+    return;
+  // bytes that follow the previous frame directly are placed with it
+  if (!framePlacements.empty() && framePlacements.back().second.end == begin && framePlacements.back().first + (begin - framePlacements.back().second.begin) == size)
+    framePlacements.back().second.end = end;
+  else
+    framePlacements.push_back({ size, { begin, end } });
+  size += end - begin;
+}
+
+bool Writer::ExportBinaryParallel(std::vector<uint8_t>& out, unsigned threads) const
+{
+  static constexpr size_t minimumParallelSize = size_t(4) << 20;
+  static constexpr size_t minimumGrain = size_t(256) << 10;
+  NamedDataTag const& root = std::as_const(dataStore).namedTags[0];
+  // a root passed through from the source is copied as a whole
+  if (!canonicalOrder && !dataStore.Source(root.dataTag.payload.As<TagPayload::Compound>()).empty())
+    return false;
+  size_t const payloadSize = BinaryPayloadSize(root.dataTag);
+  if (payloadSize < minimumParallelSize)
+    return false;
+  BinaryPlan plan;
+  // several parts per thread, so threads that finish early take over the parts that are left
+  plan.grain = std::max(payloadSize / (threads * 8), minimumGrain);
+  plan.Frame([&](std::vector<uint8_t>& frames) {
+    Store(frames, root.dataTag.type);
+    OutputBinaryStr(frames, root.GetName());
+  });
+  PlanBinaryContents(plan, root.dataTag);
+  if (plan.tasks.size() < 2)
+    return false;
+
+  size_t const base = out.size();
+  out.resize(base + plan.size);
+  uint8_t* const document = out.data() + base;
+  for (auto const& [offset, range] : plan.framePlacements)
+    std::memcpy(document + offset, plan.frames.data() + range.begin, range.end - range.begin);
+  Internal::ParallelFor(plan.tasks.size(), threads, [&](size_t task) {
+    BinaryPlan::Task const& part = plan.tasks[task];
+    PlacedOutput placed{ document, part.offset };
+    for (auto const& [name, tag] : part.tags)
+    {
+      if (part.named)
+        OutputBinaryTag(placed, name, tag);
+      else
+        OutputBinaryPayload(placed, tag);
+    }
+    assert(placed.position == part.offset + part.size);
+  });
+  return true;
+}
+
+void Writer::PlanBinaryContents(BinaryPlan& plan, DataTag const& tag) const
+{
+  if (tag.type == TAG::Compound)
+  {
+    ForEachEntry(tag.payload.As<TagPayload::Compound>(), [&](StringView name, DataTag const& entry) {
+      PlanBinaryChild(plan, true, name, entry);
+    });
+    plan.Frame([](std::vector<uint8_t>& frames) { Store(frames, TAG::End); });
+    return;
+  }
+  auto const& list = tag.payload.As<TagPayload::List>();
+  plan.Frame([&](std::vector<uint8_t>& frames) {
+    Store(frames, list.elementType_);
+    Store(frames, swap_u32(list.count_));
+  });
+  for (int32_t i = 0; i < list.count_; ++i)
+    PlanBinaryChild(plan, false, {}, dataStore.ListElement(list, i));
+}
+
+void Writer::PlanBinaryChild(BinaryPlan& plan, bool named, StringView name, DataTag const& tag) const
+{
+  size_t const payloadSize = BinaryPayloadSize(tag);
+  size_t const size = (named ? sizeof(TAG) + sizeof(uint16_t) + name.size() : 0) + payloadSize;
+  // compounds and lists of containers are split if they are large, unless they are copied from the source as a whole
+  bool const splittable = tag.type == TAG::Compound ||
+    (tag.type == TAG::List && Internal::IsContainer(tag.payload.As<TagPayload::List>().elementType_) && tag.payload.As<TagPayload::List>().count_ > 0);
+  if (splittable && payloadSize > plan.grain)
+  {
+    bool const copied = !canonicalOrder && (tag.type == TAG::Compound ? !dataStore.Source(tag.payload.As<TagPayload::Compound>()).empty()
+                                                                      : !dataStore.Source(tag.payload.As<TagPayload::List>()).empty());
+    if (!copied)
+    {
+      plan.Frame([&](std::vector<uint8_t>& frames) {
+        if (!named)
+          return;
+        Store(frames, tag.type);
+        OutputBinaryStr(frames, name);
+      });
+      PlanBinaryContents(plan, tag);
+      return;
+    }
+  }
+  // small parts that follow each other are encoded together
+  if (plan.tasks.empty() || plan.tasks.back().named != named || plan.tasks.back().offset + plan.tasks.back().size != plan.size ||
+      plan.tasks.back().size + size > plan.grain)
+    plan.tasks.push_back({ plan.size, 0, named, {} });
+  plan.tasks.back().size += size;
+  plan.tasks.back().tags.emplace_back(name, tag);
+  plan.size += size;
+}
+
+void Writer::OutputTextTag(std::ostream& out, NamedDataTag const& tag) const
+{
+  OutputTextTag(out, tag.GetName(), tag.dataTag);
+}
+
+void Writer::OutputTextTag(std::ostream& out, StringView name, DataTag const& tag) const
 {
   // root tag likely nameless
-  if (!tag.GetName().empty())
+  if (!name.empty())
   {
-    OutputTextStr(out, tag.GetName());
+    OutputTextStr(out, name);
     out << ':';
   }
-  OutputTextPayload(out, tag.dataTag);
+  OutputTextPayload(out, tag);
 }
 
-void Writer::OutputTextStr(std::ostream& out, StringView str)
+void Writer::OutputTextStr(std::ostream& out, StringView str) const
 {
   out << '"' << EscapeQuotes(str) << '"';
 }
 
-void Writer::OutputTextPayload(std::ostream& out, DataTag const& tag)
+void Writer::OutputTextPayload(std::ostream& out, DataTag const& tag) const
 {
   switch (tag.type)
   {
@@ -483,24 +795,26 @@ void Writer::OutputTextPayload(std::ostream& out, DataTag const& tag)
       out << "[I;";
       auto& intArray = tag.payload.As<TagPayload::IntArray>();
       auto intPool = dataStore.Pool<int32_t>().data() + intArray.poolIndex_;
+      auto const value = [&](int i) { return dataStore.bigEndianArrays ? swap_i32(intPool[i]) : intPool[i]; };
       for (int i = 0; i < intArray.count_ - 1; ++i)
       {
-        out << intPool[i] << ',';
+        out << value(i) << ',';
       }
       if (intArray.count_)
-        out << intPool[intArray.count_ - 1] << ']';
+        out << value(intArray.count_ - 1) << ']';
     }
     break;
     case TAG::Long_Array: {
       out << "[L;";
       auto& longArray = tag.payload.As<TagPayload::LongArray>();
       auto longPool = dataStore.Pool<int64_t>().data() + longArray.poolIndex_;
+      auto const value = [&](int i) { return dataStore.bigEndianArrays ? swap_i64(longPool[i]) : longPool[i]; };
       for (int i = 0; i < longArray.count_ - 1; ++i)
       {
-        out << longPool[i] << "l,";
+        out << value(i) << "l,";
       }
       if (longArray.count_)
-        out << longPool[longArray.count_ - 1] << "l]";
+        out << value(longArray.count_ - 1) << "l]";
     }
     break;
     case TAG::String: {
@@ -639,14 +953,13 @@ void Writer::OutputTextPayload(std::ostream& out, DataTag const& tag)
         }
         break;
         case TAG::Compound: {
-          auto const* compoundPool = dataStore.Pool<TagPayload::Compound>().data() + list.poolIndex_;
           ++textOutputState.depth;
           for (int i = 0; i < list.count_; ++i)
           {
             out << Newline << Spacing;
             DataTag newTag;
             newTag.type = list.elementType_;
-            newTag.payload.Set(compoundPool[i]);
+            newTag.payload.Set(dataStore.ListCompound(list, i));
             OutputTextPayload(out, newTag);
             if (i != list.count_ - 1)
               out << ',';
@@ -662,15 +975,16 @@ void Writer::OutputTextPayload(std::ostream& out, DataTag const& tag)
       auto& compound = tag.payload.As<TagPayload::Compound>();
       out << '{' << Newline;
       ++textOutputState.depth;
-      for (auto namedTagIndex : dataStore.compoundStorage[compound.storageIndex_])
-      {
+      size_t const entryCount = dataStore.EntryCount(compound);
+      size_t entryIndex = 0;
+      ForEachEntry(compound, [&](StringView name, DataTag const& entry) {
         out << Spacing;
-        OutputTextTag(out, dataStore.namedTags[namedTagIndex]);
-        if (namedTagIndex != dataStore.compoundStorage[compound.storageIndex_].back())
+        OutputTextTag(out, name, entry);
+        if (++entryIndex != entryCount)
           out << ',' << Newline;
         else
           out << Newline;
-      }
+      });
       --textOutputState.depth;
       out << Spacing << '}';
     }
@@ -0,0 +1,32 @@
+#ifndef GZIPMEMBERS_H
+#define GZIPMEMBERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ImNBT::Internal
+{
+
+// the uncompressed bytes in each member of a stream written by CompressGzipMembers()
+constexpr size_t GzipMemberSize = size_t(1) << 20;
+
+// compresses data as a gzip stream of independent members, compressed on up to threads threads and returned in order.
+// Any gzip reader inflates the members one after another, as a single stream. Each member also notes its compressed size
+// in an extra field of its header, so DecompressGzipMembers() can find them all without inflating any.
+// Returns no members if compression fails
+std::vector<std::vector<uint8_t>> CompressGzipMembers(uint8_t const* data, size_t size, unsigned threads);
+
+// the bytes at the start of a stream that tell whether it was written by CompressGzipMembers()
+constexpr size_t GzipMembersSignatureSize = 16;
+
+// true if data, which holds at least GzipMembersSignatureSize bytes, starts like a stream written by CompressGzipMembers()
+bool IsGzipMembers(uint8_t const* data);
+
+// inflates a stream written by CompressGzipMembers() on up to threads threads, appending the result to out.
+// Returns false, leaving out as it was, if the stream was not written that way or is damaged
+bool DecompressGzipMembers(uint8_t const* data, size_t size, std::vector<uint8_t>& out, unsigned threads);
+
+} // namespace ImNBT::Internal
+
+#endif // GZIPMEMBERS_H
@@ -0,0 +1,15 @@
+#ifndef HASHBYTES_H
+#define HASHBYTES_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ImNBT::Internal
+{
+
+// xxHash64 of size bytes at data
+uint64_t HashBytes(void const* data, size_t size, uint64_t seed);
+
+} // namespace ImNBT::Internal
+
+#endif // HASHBYTES_H
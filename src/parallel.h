@@ -0,0 +1,41 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace ImNBT::Internal
+{
+
+// the threads to use when asked for requested threads, where 0 means one per core
+inline unsigned ThreadCount(unsigned requested)
+{
+  return requested == 0 ? std::max(1u, std::thread::hardware_concurrency()) : requested;
+}
+
+// calls fn(index) for every index below count, on up to threads threads including the calling one.
+// Indices are handed out in order as threads become free, so tasks of uneven length still keep every thread busy
+template<typename Fn>
+void ParallelFor(size_t count, unsigned threads, Fn&& fn)
+{
+  std::atomic<size_t> next{ 0 };
+  auto const work = [&]() {
+    for (size_t index = next++; index < count; index = next++)
+      fn(index);
+  };
+  size_t const workerCount = count > 1 ? std::min<size_t>(threads, count) - 1 : 0;
+  std::vector<std::thread> workers;
+  workers.reserve(workerCount);
+  for (size_t worker = 0; worker < workerCount; ++worker)
+    workers.emplace_back(work);
+  work();
+  for (std::thread& worker : workers)
+    worker.join();
+}
+
+} // namespace ImNBT::Internal
+
+#endif // PARALLEL_H
@@ -0,0 +1,322 @@
+#include <ImNBT/NBTEditor.hpp>
+#include <ImNBT/NBTPatch.hpp>
+#include <ImNBT/NBTPath.hpp>
+#include <ImNBT/NBTReader.hpp>
+#include <ImNBT/NBTVisitor.hpp>
+#include <ImNBT/NBTWriter.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// A region-sized document: chunks with a handful of scalar fields and sections holding packed block state arrays
+static std::vector<uint8_t> MakeDocument(int chunks)
+{
+  ImNBT::Writer writer;
+  writer.WriteInt(3465, "DataVersion");
+  if (writer.BeginList("Chunks"))
+  {
+    std::array<int64_t, 256> blockStates{};
+    std::array<int8_t, 2048> light{};
+    for (int chunk = 0; chunk < chunks; ++chunk)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(chunk % 32, "xPos");
+        writer.WriteInt(chunk / 32, "zPos");
+        writer.WriteLong(chunk * 1000ll, "LastUpdate");
+        writer.WriteString("minecraft:full", "Status");
+        if (writer.BeginList("Sections"))
+        {
+          for (int section = 0; section < 16; ++section)
+          {
+            if (writer.BeginCompound())
+            {
+              blockStates.fill(chunk * 16 + section);
+              writer.WriteByte(static_cast<int8_t>(section), "Y");
+              writer.WriteLongArray(blockStates.data(), static_cast<int32_t>(blockStates.size()), "BlockStates");
+              writer.WriteByteArray(light.data(), static_cast<int32_t>(light.size()), "SkyLight");
+              writer.EndCompound();
+            }
+          }
+          writer.EndList();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+  return data;
+}
+
+struct SummingVisitor : ImNBT::VisitorBase
+{
+  int64_t sum = 0;
+
+  ImNBT::Visit Byte(ImNBT::StringView, int8_t value) { sum += value; return ImNBT::Visit::Continue; }
+  ImNBT::Visit Int(ImNBT::StringView, int32_t value) { sum += value; return ImNBT::Visit::Continue; }
+  ImNBT::Visit Long(ImNBT::StringView, int64_t value) { sum += value; return ImNBT::Visit::Continue; }
+  ImNBT::Visit String(ImNBT::StringView, ImNBT::StringView value) { sum += value.size(); return ImNBT::Visit::Continue; }
+  ImNBT::Visit ByteArray(ImNBT::StringView, ImNBT::ArrayView<int8_t> value)
+  {
+    for (int32_t i = 0; i < value.Size(); ++i)
+      sum += value[i];
+    return ImNBT::Visit::Continue;
+  }
+  ImNBT::Visit LongArray(ImNBT::StringView, ImNBT::ArrayView<int64_t> value)
+  {
+    for (int32_t i = 0; i < value.Size(); ++i)
+      sum += value[i];
+    return ImNBT::Visit::Continue;
+  }
+};
+
+// only the scalar fields of each chunk, the sections are passed over by length
+struct SkippingVisitor : ImNBT::VisitorBase
+{
+  int64_t sum = 0;
+
+  ImNBT::Visit BeginList(ImNBT::StringView name, ImNBT::TAG, int32_t) { return name == "Sections" ? ImNBT::Visit::Skip : ImNBT::Visit::Continue; }
+  ImNBT::Visit Int(ImNBT::StringView, int32_t value) { sum += value; return ImNBT::Visit::Continue; }
+};
+
+template<typename Fn>
+static void Measure(char const* label, size_t bytes, int repetitions, Fn&& fn)
+{
+  auto const start = std::chrono::steady_clock::now();
+  int64_t check = 0;
+  for (int i = 0; i < repetitions; ++i)
+    check += fn();
+  std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+  double const megabytesPerSecond = double(bytes) * repetitions / elapsed.count() / (1024.0 * 1024.0);
+  std::printf("%-28s %10.1f MB/s  (check %lld)\n", label, megabytesPerSecond, static_cast<long long>(check));
+}
+
+// time per edit and bytes no longer shared with the previous snapshot, when every edit is published as a snapshot
+template<typename Fn>
+static void MeasureEdits(char const* label, ImNBT::Editor& editor, int repetitions, Fn&& edit)
+{
+  ImNBT::DocumentPtr previous = editor.Snapshot();
+  std::chrono::duration<double> elapsed{};
+  size_t copied = 0;
+  for (int i = 0; i < repetitions; ++i)
+  {
+    auto const start = std::chrono::steady_clock::now();
+    edit(i);
+    ImNBT::DocumentPtr next = editor.Snapshot();
+    elapsed += std::chrono::steady_clock::now() - start;
+    copied += next->MemoryUsage(*previous);
+    previous = std::move(next);
+  }
+  std::printf("%-28s %10.2f us  %10zu bytes copied per edit\n", label, elapsed.count() * 1e6 / repetitions, copied / repetitions);
+}
+
+int main()
+{
+  std::vector<uint8_t> const data = MakeDocument(1024);
+  std::printf("document: %.1f MB\n", data.size() / (1024.0 * 1024.0));
+  int const repetitions = 10;
+
+  std::vector<uint8_t> copy(data.size());
+  Measure("memcpy", data.size(), repetitions, [&]() {
+    std::memcpy(copy.data(), data.data(), data.size());
+    return int64_t(copy[copy.size() / 2]);
+  });
+  Measure("visit (sum every value)", data.size(), repetitions, [&]() {
+    SummingVisitor visitor;
+    ImNBT::VisitBinary(data.data(), data.size(), visitor);
+    return visitor.sum;
+  });
+  Measure("visit (skip sections)", data.size(), repetitions, [&]() {
+    SkippingVisitor visitor;
+    ImNBT::VisitBinary(data.data(), data.size(), visitor);
+    return visitor.sum;
+  });
+  Measure("Reader::ImportBinary", data.size(), repetitions, [&]() {
+    ImNBT::Reader reader;
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    return int64_t(reader.Count());
+  });
+  // time to first read, which still includes copying the input
+  Measure("lazy import + first read", data.size(), repetitions, [&]() {
+    ImNBT::Reader reader;
+    reader.SetLazyImport(true);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    return int64_t(reader.ReadInt("DataVersion"));
+  });
+  Measure("projected import", data.size(), repetitions, [&]() {
+    ImNBT::Reader reader;
+    reader.SetProjection({ "Chunks[*].xPos" });
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    return int64_t(reader.Count());
+  });
+  // every section holds the same light array, which deduplication stores once
+  size_t deduplicatedMemory = 0;
+  Measure("deduplicated import", data.size(), repetitions, [&]() {
+    ImNBT::Reader reader;
+    reader.SetListShaping(true);
+    reader.SetDeduplication(true);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    deduplicatedMemory = reader.ReleaseDocument()->MemoryUsage();
+    return int64_t(deduplicatedMemory & 1);
+  });
+  std::vector<uint8_t> image;
+  {
+    ImNBT::Reader reader;
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    reader.ExportFrozen(image);
+  }
+  Measure("Reader::ImportFrozen", data.size(), repetitions, [&]() {
+    ImNBT::Reader reader;
+    reader.ImportFrozen(image.data(), image.size());
+    return int64_t(reader.Count());
+  });
+  // the same image mapped from a file, which reads values and names in place
+  {
+    char const* const file = "bench.frozen";
+    if (FILE* out = fopen(file, "wb"))
+    {
+      fwrite(image.data(), 1, image.size(), out);
+      fclose(out);
+    }
+    Measure("Reader::ImportFrozenFile", data.size(), repetitions, [&]() {
+      ImNBT::Reader reader;
+      reader.ImportFrozenFile(file);
+      return int64_t(reader.Count());
+    });
+    std::remove(file);
+  }
+
+  ImNBT::DocumentPtr document;
+  {
+    ImNBT::Reader reader;
+    reader.SetListShaping(true);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    document = reader.ReleaseDocument();
+  }
+  std::printf("document memory: %.1f MB, %.1f MB deduplicated\n", document->MemoryUsage() / (1024.0 * 1024.0), deduplicatedMemory / (1024.0 * 1024.0));
+  ImNBT::Editor editor{ document };
+  int const snapshots = 100000;
+  auto const start = std::chrono::steady_clock::now();
+  for (int i = 0; i < snapshots; ++i)
+    editor.Snapshot();
+  std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+  std::printf("%-28s %10.2f us\n", "Editor::Snapshot", elapsed.count() * 1e6 / snapshots);
+
+  // the chunks and their sections are shaped lists, so their fields are stored in pool columns
+  int const edits = 1000;
+  ImNBT::Path const dataVersion = *ImNBT::Path::Compile("DataVersion");
+  MeasureEdits("edit named tag", editor, edits, [&](int i) { editor.SetInt(dataVersion, i); });
+  ImNBT::Path const lastUpdate = *ImNBT::Path::Compile("Chunks[500].LastUpdate");
+  MeasureEdits("edit chunk field", editor, edits, [&](int i) { editor.SetLong(lastUpdate, i); });
+  ImNBT::Path const sectionY = *ImNBT::Path::Compile("Chunks[500].Sections[3].Y");
+  MeasureEdits("edit section field", editor, edits, [&](int i) { editor.SetByte(sectionY, static_cast<int8_t>(i)); });
+  std::vector<ImNBT::Path> spread;
+  for (int chunk = 0; chunk < 1024; chunk += 7)
+    spread.push_back(*ImNBT::Path::Compile("Chunks[" + std::to_string(chunk) + "].Sections[3].Y"));
+  MeasureEdits("edit sections across chunks", editor, edits, [&](int i) { editor.SetByte(spread[i % spread.size()], static_cast<int8_t>(i)); });
+
+  // saving after a small edit, encoding every tag or copying the compounds that are unchanged since they were read
+  for (bool passthrough : { false, true })
+  {
+    ImNBT::Reader reader;
+    reader.SetSourcePassthrough(passthrough);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::Editor edited{ reader.ReleaseDocument() };
+    edited.SetLong(lastUpdate, 1);
+    ImNBT::DocumentPtr const snapshot = edited.Snapshot();
+    Measure(passthrough ? "export edited (passthrough)" : "export edited", data.size(), repetitions, [&]() {
+      std::vector<uint8_t> out;
+      ImNBT::Writer{ snapshot }.ExportBinary(out);
+      return int64_t(out.size());
+    });
+  }
+
+  // encoding the whole document on one thread, and in parts on every core
+  for (unsigned threads : { 1u, 0u })
+  {
+    Measure(threads == 1 ? "export (1 thread)" : "export (every core)", data.size(), repetitions, [&]() {
+      std::vector<uint8_t> out;
+      ImNBT::Writer writer{ document };
+      writer.SetExportThreads(threads);
+      writer.ExportBinary(out);
+      return int64_t(out.size());
+    });
+  }
+
+  // compressing to a file and inflating it again, as one stream on one thread and in members on every core
+  for (unsigned threads : { 1u, 0u })
+  {
+    char const* const file = "bench_compressed.nbt";
+    Measure(threads == 1 ? "compressed export (1 thread)" : "compressed export (cores)", data.size(), 3, [&]() {
+      ImNBT::Writer writer{ document };
+      writer.SetExportThreads(threads);
+      return int64_t(writer.ExportBinaryFile(file));
+    });
+    Measure(threads == 1 ? "compressed import (1 thread)" : "compressed import (cores)", data.size(), 3, [&]() {
+      ImNBT::Reader reader;
+      reader.SetImportThreads(threads);
+      return int64_t(reader.ImportBinaryFile(file));
+    });
+    std::remove(file);
+  }
+
+  // saving over and over with an edit in between, reusing the previous output for what the edit left alone
+  {
+    ImNBT::Reader reader;
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::Editor autosaved{ reader.ReleaseDocument() };
+    autosaved.ExportBinary();
+    int64_t saves = 0;
+    Measure("edit + cached export", data.size(), repetitions, [&]() {
+      autosaved.SetLong(lastUpdate, ++saves);
+      return int64_t(autosaved.ExportBinary()->size());
+    });
+  }
+
+  // replicating a few edits as a patch rather than as the whole document
+  {
+    ImNBT::Editor changed{ document };
+    changed.SetLong(lastUpdate, -1);
+    changed.SetByte(sectionY, -1);
+    ImNBT::DocumentPtr const next = changed.Snapshot();
+    size_t patchSize = 0;
+    Measure("Patch::Diff", data.size(), repetitions, [&]() {
+      patchSize = ImNBT::Patch::Diff(document->Root(), next->Root())->Bytes().size();
+      return int64_t(patchSize);
+    });
+    std::printf("patch: %zu bytes\n", patchSize);
+  }
+
+  // hashing the whole document, and hashing it again after an edit with the hashes an editor caches
+  {
+    ImNBT::TagRef const root = document->Root();
+    Measure("TagRef::Hash", data.size(), repetitions, [&]() { return int64_t(root.Hash() & 1); });
+    ImNBT::Editor hashed{ document };
+    ImNBT::Path const rootPath = *ImNBT::Path::Compile("");
+    hashed.Hash(rootPath);
+    int64_t edits = 0;
+    Measure("edit + cached hash", data.size(), repetitions, [&]() {
+      hashed.SetLong(lastUpdate, ++edits);
+      return int64_t(hashed.Hash(rootPath) & 1);
+    });
+  }
+
+  // copying every chunk into a new document, which only moves pool ranges and should approach memcpy
+  {
+    ImNBT::Reader reader;
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::TagRef const chunks = reader.Root()["Chunks"];
+    Measure("Writer::WriteCopy", data.size(), repetitions, [&]() {
+      ImNBT::Writer writer;
+      return int64_t(writer.WriteCopy(chunks, "Chunks"));
+    });
+  }
+  return 0;
+}
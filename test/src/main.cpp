@@ -1,9 +1,22 @@
+#include <ImNBT/NBTBinding.hpp>
+#include <ImNBT/NBTCache.hpp>
+#include <ImNBT/NBTEditor.hpp>
+#include <ImNBT/NBTIndex.hpp>
+#include <ImNBT/NBTPatch.hpp>
+#include <ImNBT/NBTPath.hpp>
+#include <ImNBT/NBTVisitor.hpp>
 #include <ImNBT/NBTReader.hpp>
 #include <ImNBT/NBTWriter.hpp>
 
 #include <ImNBT/NBTRepresentation.hpp>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
 
 void WriterTest()
 {
@@ -247,6 +260,2234 @@ void ListsOfListsOfListsTest()
   writer.ExportTextFile("./ListsOfListsOfLists.test");
 }
 
+void ListIterationTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    if (writer.BeginList("Entities"))
+    {
+      for (int i = 0; i < 100; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          writer.WriteInt(i, "id");
+          if (writer.BeginList("Pos"))
+          {
+            writer.WriteDouble(i * 0.5);
+            writer.WriteDouble(i * 2.0);
+            writer.EndList();
+          }
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+
+  int32_t visited = 0;
+  for (int32_t i : reader.Compounds("Entities"))
+  {
+    assert(reader.ReadInt("id") == i);
+    if (reader.OpenList("Pos"))
+    {
+      assert(reader.ListSize() == 2);
+      assert(reader.ReadDouble() == i * 0.5);
+      assert(reader.ReadDouble() == i * 2.0);
+      reader.CloseList();
+    }
+    ++visited;
+  }
+  assert(visited == 100);
+
+  for (int32_t i : reader.Compounds("Entities"))
+  {
+    if (i == 3)
+      break;
+  }
+  int32_t missing = 0;
+  for (int32_t i : reader.Compounds("missing"))
+  {
+    missing += i + 1;
+  }
+  assert(missing == 0);
+  // the reader is back at the root after the loops
+  assert(reader.Count() == 1);
+}
+
+void ColumnExtractionTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    if (writer.BeginList("Items"))
+    {
+      for (int i = 0; i < 150; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          // every third item has no count, and the field order changes halfway through
+          if (i >= 75)
+            writer.WriteString(std::to_string(i), "id");
+          if (i % 3 != 0)
+            writer.WriteByte(static_cast<int8_t>(i % 64), "Count");
+          if (i < 75)
+            writer.WriteString(std::to_string(i), "id");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+
+  ImNBT::Column<int8_t> count{ "Count" };
+  ImNBT::Column<ImNBT::StringView> id{ "id" };
+  ImNBT::Column<int32_t> wrongType{ "Count" };
+  bool const extracted = reader.ExtractColumns("Items", count, id, wrongType);
+  assert(extracted);
+  assert(count.Size() == 150 && id.Size() == 150);
+  for (size_t i = 0; i < 150; ++i)
+  {
+    assert(count.Valid(i) == (i % 3 != 0));
+    if (count.Valid(i))
+      assert(count.values[i] == static_cast<int8_t>(i % 64));
+    assert(id.Valid(i) && id.values[i] == std::to_string(i));
+    assert(!wrongType.Valid(i));
+  }
+  assert(!reader.ExtractColumns("missing", count));
+}
+
+static void WriteShapedListTestData(ImNBT::Writer& writer)
+{
+  if (writer.BeginList("Palette"))
+  {
+    for (int i = 0; i < 20; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteString("block_" + std::to_string(i), "Name");
+        writer.WriteInt(i * 3, "Id");
+        if (writer.BeginList("Pos"))
+        {
+          writer.WriteDouble(i + 0.25);
+          writer.WriteDouble(i + 0.75);
+          writer.EndList();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  // differing key sets stay as they are
+  if (writer.BeginList("Mixed"))
+  {
+    for (int i = 0; i < 10; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(i, i % 2 ? "odd" : "even");
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  writer.WriteString("after", "Trailer");
+}
+
+void ShapedListTest()
+{
+  std::vector<uint8_t> plain, shaped;
+  std::string plainText, shapedText;
+  {
+    ImNBT::Writer writer;
+    WriteShapedListTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(plain);
+    writer.ExportString(plainText);
+  }
+  {
+    ImNBT::Writer writer;
+    writer.SetListShaping(true);
+    WriteShapedListTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(shaped);
+    writer.ExportString(shapedText);
+  }
+  assert(plain == shaped);
+  assert(plainText == shapedText);
+
+  ImNBT::Reader reader;
+  reader.SetListShaping(true);
+  reader.ImportBinary(plain.data(), static_cast<uint32_t>(plain.size()));
+
+  for (int32_t i : reader.Compounds("Palette"))
+  {
+    assert(reader.Count() == 3);
+    assert(reader.ReadString("Name") == "block_" + std::to_string(i));
+    assert(reader.ReadInt("Id") == i * 3);
+    assert(!reader.MaybeReadLong("Id"));
+    if (reader.OpenList("Pos"))
+    {
+      assert(reader.ReadDouble() == i + 0.25);
+      assert(reader.ReadDouble() == i + 0.75);
+      reader.CloseList();
+    }
+  }
+  if (reader.OpenList("Palette"))
+  {
+    for (int i = 0; i < reader.ListSize(); ++i)
+    {
+      if (reader.OpenCompound())
+      {
+        std::vector<ImNBT::StringView> names;
+        for (ImNBT::StringView name : reader.Names())
+          names.push_back(name);
+        assert((names == std::vector<ImNBT::StringView>{ "Name", "Id", "Pos" }));
+        reader.CloseCompound();
+      }
+    }
+    reader.CloseList();
+  }
+  ImNBT::Column<int32_t> ids{ "Id" };
+  reader.ExtractColumns("Palette", ids);
+  assert(ids.Size() == 20 && ids.Valid(19) && ids.values[19] == 57);
+  assert(ImNBT::Path::Compile("Palette[19].Id")->Evaluate(reader).As<int32_t>() == 57);
+  assert(ImNBT::Path::Compile("Palette[*].Pos[1]")->All(reader).size() == 20);
+  assert(reader.ReadString("Trailer") == "after");
+}
+
+struct BoundItem
+{
+  std::string id;
+  int8_t count = 0;
+  std::optional<int16_t> damage;
+};
+
+struct BoundPlayer
+{
+  std::string name;
+  int32_t level = 0;
+  bool flying = false;
+  std::vector<double> pos;
+  std::vector<int32_t> uuid;
+  std::vector<BoundItem> inventory;
+  BoundItem hand;
+};
+
+IMNBT_BIND(BoundItem, IMNBT_FIELD(id), IMNBT_FIELD_NAMED(count, "Count"), IMNBT_FIELD(damage))
+IMNBT_BIND(BoundPlayer, IMNBT_FIELD(name), IMNBT_FIELD(level), IMNBT_FIELD(flying), IMNBT_FIELD(pos), IMNBT_FIELD(uuid), IMNBT_FIELD_NAMED(inventory, "Inventory"), IMNBT_FIELD(hand))
+
+void BindingTest()
+{
+  BoundPlayer player;
+  player.name = "Steve";
+  player.level = 30;
+  player.flying = true;
+  player.pos = { 1.5, 64.0, -3.25 };
+  player.uuid = { 1, -2, 3, -4 };
+  player.inventory = { { "stone", 64, std::nullopt }, { "sword", 1, int16_t(12) } };
+  player.hand = { "torch", 3, std::nullopt };
+
+  ImNBT::Writer writer;
+  writer.Write(player, "player");
+  // written by hand with the fields out of declaration order and one missing
+  if (writer.BeginCompound("partial"))
+  {
+    writer.WriteByte(5, "Count");
+    writer.WriteString("apple", "id");
+    writer.EndCompound();
+  }
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  BoundPlayer const read = reader.Read<BoundPlayer>("player");
+  assert(read.name == "Steve" && read.level == 30 && read.flying);
+  assert((read.pos == std::vector<double>{ 1.5, 64.0, -3.25 }));
+  assert((read.uuid == std::vector<int32_t>{ 1, -2, 3, -4 }));
+  assert(read.inventory.size() == 2);
+  assert(read.inventory[0].id == "stone" && read.inventory[0].count == 64 && !read.inventory[0].damage);
+  assert(read.inventory[1].id == "sword" && read.inventory[1].damage == int16_t(12));
+  assert(read.hand.id == "torch" && read.hand.count == 3);
+
+  auto const partial = reader.MaybeRead<BoundItem>("partial");
+  assert(partial && partial->id == "apple" && partial->count == 5 && !partial->damage);
+  assert(!reader.MaybeRead<BoundItem>("missing"));
+
+  // the bound layout is the same one the immediate mode API sees
+  if (reader.OpenCompound("player"))
+  {
+    assert(reader.ReadInt("level") == 30);
+    assert(reader.ReadByte("flying") == 1);
+    reader.CloseCompound();
+  }
+}
+
+void DecodePlanTest()
+{
+  ImNBT::Writer writer;
+  if (writer.BeginList("sections"))
+  {
+    for (int i = 0; i < 10; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteByte(static_cast<int8_t>(i), "Y");
+        writer.WriteString("minecraft:plains", "Biome");
+        writer.WriteInt(i * 100, "Light");
+        writer.EndCompound();
+      }
+    }
+    // the same keys in another order make another shape
+    if (writer.BeginCompound())
+    {
+      writer.WriteInt(1000, "Light");
+      writer.WriteString("minecraft:desert", "Biome");
+      writer.WriteByte(10, "Y");
+      writer.EndCompound();
+    }
+    writer.EndList();
+  }
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  ImNBT::Reader reader;
+  auto readSections = [&reader]() {
+    for (int32_t i : reader.Compounds("sections"))
+    {
+      assert(reader.ReadByte("Y") == i);
+      assert(reader.ReadString("Biome") == (i < 10 ? "minecraft:plains" : "minecraft:desert"));
+      assert(reader.ReadInt("Light") == i * 100);
+      assert(!reader.MaybeReadInt("Missing"));
+    }
+  };
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  readSections();
+  ImNBT::DecodePlanStats stats = reader.GetDecodePlanStats();
+  // the first compound of each shape (and the root) learns its plan; absent names always fall back to search
+  assert(stats.hits == 9 * 3);
+  assert(stats.misses == 1 + 2 * 4 + 9);
+
+  // plans outlive the document they were learned from
+  reader.ResetDecodePlanStats();
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  readSections();
+  stats = reader.GetDecodePlanStats();
+  assert(stats.hits == 1 + 11 * 3);
+  assert(stats.misses == 11);
+
+  // the number of shapes planned is bounded, later shapes are searched
+  ImNBT::Writer shapes;
+  if (shapes.BeginList("Shapes"))
+  {
+    for (int i = 0; i < 5000; ++i)
+    {
+      if (shapes.BeginCompound())
+      {
+        shapes.WriteInt(i, "f" + std::to_string(i));
+        shapes.EndCompound();
+      }
+    }
+    shapes.EndList();
+  }
+  shapes.Finalize();
+  std::vector<uint8_t> shapesData;
+  shapes.ExportBinary(shapesData);
+  ImNBT::Reader shapesReader;
+  for (int round = 0; round < 2; ++round)
+  {
+    shapesReader.ResetDecodePlanStats();
+    shapesReader.ImportBinary(shapesData.data(), static_cast<uint32_t>(shapesData.size()));
+    int i = 0;
+    for (int32_t index : shapesReader.Compounds("Shapes"))
+      assert(shapesReader.ReadInt("f" + std::to_string(i++)) == index);
+    assert(i == 5000);
+  }
+  // the root and the first 4095 shapes are planned
+  stats = shapesReader.GetDecodePlanStats();
+  assert(stats.hits == 4096 && stats.misses == 5000 - 4095);
+}
+
+void PathTest()
+{
+  ImNBT::Writer writer;
+  if (writer.BeginCompound("Level"))
+  {
+    writer.WriteInt(-3, "xPos");
+    if (writer.BeginList("Sections"))
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          writer.WriteByte(static_cast<int8_t>(i), "Y");
+          std::array<int64_t, 2> states{ i * 10ll, i * 10ll + 1 };
+          writer.WriteLongArray(states.data(), static_cast<int32_t>(states.size()), "BlockStates");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.WriteString("v", "odd.key");
+    writer.EndCompound();
+  }
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+
+  auto const states = ImNBT::Path::Compile("Level.Sections[3].BlockStates");
+  assert(states);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    ImNBT::TagRef const ref = states->Evaluate(reader);
+    assert(ref.Type() == ImNBT::TAG::Long_Array && ref.Size() == 2);
+    assert((ref.AsLongArray() == std::vector<int64_t>{ 30, 31 }));
+  }
+  assert(ImNBT::Path::Compile("Level.Sections[-1].Y")->Evaluate(reader).As<int8_t>() == int8_t(3));
+  assert(!ImNBT::Path::Compile("Level.Sections[4]")->Evaluate(reader));
+  assert(!ImNBT::Path::Compile("Level.xPos.Y")->Evaluate(reader));
+  assert(ImNBT::Path::Compile("Level.\"odd.key\"")->Evaluate(reader).As<ImNBT::StringView>() == ImNBT::StringView("v"));
+  assert(ImNBT::Path::Compile("")->Evaluate(reader).Type() == ImNBT::TAG::Compound);
+
+  std::vector<int8_t> ys;
+  ImNBT::Path::Compile("Level.Sections[*].Y")->ForEach(reader, [&ys](ImNBT::TagRef const& y) { ys.push_back(*y.As<int8_t>()); });
+  assert((ys == std::vector<int8_t>{ 0, 1, 2, 3 }));
+  assert(ImNBT::Path::Compile("*.*")->All(reader).size() == 3);
+  assert(ImNBT::Path::Compile("Level")->Evaluate(reader)["Sections"][1]["Y"].As<int8_t>() == int8_t(1));
+
+  assert(!ImNBT::Path::Compile("Level..xPos"));
+  assert(!ImNBT::Path::Compile("Level.Sections[x]"));
+  assert(!ImNBT::Path::Compile("Level.Sections[1"));
+  assert(!ImNBT::Path::Compile("Level."));
+}
+
+struct RecordingVisitor : ImNBT::VisitorBase
+{
+  std::string events;
+  ImNBT::StringView skipName;
+  ImNBT::StringView stopName;
+
+  ImNBT::Visit Check(ImNBT::StringView name, char const* event)
+  {
+    if (!stopName.empty() && name == stopName)
+      return ImNBT::Visit::Stop;
+    events += event;
+    events += std::string(name) + ";";
+    return (!skipName.empty() && name == skipName) ? ImNBT::Visit::Skip : ImNBT::Visit::Continue;
+  }
+  ImNBT::Visit BeginCompound(ImNBT::StringView name) { return Check(name, "{"); }
+  ImNBT::Visit EndCompound() { events += "};"; return ImNBT::Visit::Continue; }
+  ImNBT::Visit BeginList(ImNBT::StringView name, ImNBT::TAG, int32_t count) { return Check(name, ("[" + std::to_string(count)).c_str()); }
+  ImNBT::Visit EndList() { events += "];"; return ImNBT::Visit::Continue; }
+  ImNBT::Visit Int(ImNBT::StringView name, int32_t value) { return Check(name, ("i" + std::to_string(value)).c_str()); }
+  ImNBT::Visit String(ImNBT::StringView name, ImNBT::StringView value) { return Check(name, ("s" + std::string(value)).c_str()); }
+  ImNBT::Visit LongArray(ImNBT::StringView name, ImNBT::ArrayView<int64_t> value) { return Check(name, ("L" + std::to_string(value[value.Size() - 1])).c_str()); }
+};
+
+void VisitorTest()
+{
+  ImNBT::Writer writer;
+  writer.WriteInt(7, "a");
+  if (writer.BeginCompound("c"))
+  {
+    writer.WriteString("x", "s");
+    if (writer.BeginList("l"))
+    {
+      writer.WriteInt(1);
+      writer.WriteInt(2);
+      writer.EndList();
+    }
+    writer.EndCompound();
+  }
+  std::array<int64_t, 3> longs{ 1, 2, -5000000000ll };
+  writer.WriteLongArray(longs.data(), static_cast<int32_t>(longs.size()), "L");
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  RecordingVisitor all;
+  assert(ImNBT::VisitBinary(data.data(), data.size(), all));
+  assert(all.events == "{;i7a;{c;sxs;[2l;i1;i2;];};L-5000000000L;};");
+
+  RecordingVisitor skipping;
+  skipping.skipName = "c";
+  assert(ImNBT::VisitBinary(data.data(), data.size(), skipping));
+  assert(skipping.events == "{;i7a;{c;L-5000000000L;};");
+
+  RecordingVisitor stopping;
+  stopping.stopName = "l";
+  assert(ImNBT::VisitBinary(data.data(), data.size(), stopping));
+  assert(stopping.events == "{;i7a;{c;sxs;");
+
+  RecordingVisitor truncated;
+  assert(!ImNBT::VisitBinary(data.data(), data.size() - 3, truncated));
+
+  // the streaming source sees the same events as the in-memory one
+  struct Counter : ImNBT::VisitorBase
+  {
+    int tags = 0;
+    int64_t longTest = 0;
+    ImNBT::Visit Long(ImNBT::StringView name, int64_t value)
+    {
+      ++tags;
+      if (name == "longTest")
+        longTest = value;
+      return ImNBT::Visit::Continue;
+    }
+    ImNBT::Visit String(ImNBT::StringView, ImNBT::StringView) { ++tags; return ImNBT::Visit::Continue; }
+    ImNBT::Visit ByteArray(ImNBT::StringView, ImNBT::ArrayView<int8_t> value) { tags += value.Size(); return ImNBT::Visit::Continue; }
+  } fromFile;
+  assert(ImNBT::VisitBinaryFile("./test/data/bigtest_uncompr", fromFile));
+  assert(fromFile.longTest == 9223372036854775807ll);
+  // 8 longs, 5 strings and the 1000 element byte array
+  assert(fromFile.tags == 8 + 5 + 1000);
+}
+
+void LazyImportTest()
+{
+  ImNBT::Writer writer;
+  writer.WriteString("first", "head");
+  if (writer.BeginList("bulk"))
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(i, "i");
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  if (writer.BeginCompound("Data"))
+  {
+    if (writer.BeginCompound("Player"))
+    {
+      writer.WriteDouble(1.5, "x");
+      writer.EndCompound();
+    }
+    writer.EndCompound();
+  }
+  writer.WriteInt(42, "tail");
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  ImNBT::Reader reader;
+  reader.SetLazyImport(true);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  // later entries first, and nested containers decoded whole
+  assert(reader.ReadInt("tail") == 42);
+  if (reader.OpenCompound("Data"))
+  {
+    if (reader.OpenCompound("Player"))
+    {
+      assert(reader.ReadDouble("x") == 1.5);
+      // the root is filled in while a nested compound is open
+      assert(ImNBT::Path::Compile("bulk[99].i")->Evaluate(reader).As<int32_t>() == 99);
+      assert(reader.ReadDouble("x") == 1.5);
+      reader.CloseCompound();
+    }
+    reader.CloseCompound();
+  }
+  assert(!reader.MaybeReadInt("missing"));
+  assert(reader.Count() == 4);
+  std::vector<ImNBT::StringView> names;
+  for (ImNBT::StringView name : reader.Names())
+    names.push_back(name);
+  // in the order of the file, whichever entries were read first
+  assert(names == std::vector<ImNBT::StringView>({ "head", "bulk", "Data", "tail" }));
+  assert(reader.ReadString("head") == "first");
+
+  // exported again as it was read
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  assert(reader.ReadInt("tail") == 42 && reader.OpenCompound("Data"));
+  reader.CloseCompound();
+  std::vector<uint8_t> exported;
+  assert(ImNBT::Writer{ reader }.ExportBinary(exported) && exported == data);
+
+  // a fresh lazy import only decodes what is read
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  int32_t sum = 0;
+  for (int32_t i : reader.Compounds("bulk"))
+    sum += reader.ReadInt("i") - i;
+  assert(sum == 0);
+}
+
+void ProjectionTest()
+{
+  ImNBT::Writer writer;
+  if (writer.BeginCompound("Data"))
+  {
+    writer.WriteString("world", "LevelName");
+    if (writer.BeginCompound("Player"))
+    {
+      if (writer.BeginList("Pos"))
+      {
+        writer.WriteDouble(1.0);
+        writer.WriteDouble(2.0);
+        writer.WriteDouble(3.0);
+        writer.EndList();
+      }
+      if (writer.BeginList("Inventory"))
+      {
+        if (writer.BeginCompound())
+        {
+          writer.WriteString("stone", "id");
+          writer.EndCompound();
+        }
+        writer.EndList();
+      }
+      writer.EndCompound();
+    }
+    if (writer.BeginList("Sections"))
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          writer.WriteByte(static_cast<int8_t>(i), "Y");
+          std::array<int64_t, 64> states{};
+          writer.WriteLongArray(states.data(), static_cast<int32_t>(states.size()), "BlockStates");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.EndCompound();
+  }
+  writer.WriteInt(1, "LevelName");
+  writer.Finalize();
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+
+  ImNBT::Reader reader;
+  assert(!reader.SetProjection({ "Data..Player" }));
+  assert(reader.SetProjection({ "Data.Player.Pos", "Data.Sections[*].Y", "Data.LevelName.x" }));
+  for (bool lazy : { false, true })
+  {
+    reader.SetLazyImport(lazy);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    assert((ImNBT::Path::Compile("Data.Player.Pos")->Evaluate(reader).Size() == 3));
+    assert(!ImNBT::Path::Compile("Data.Player.Inventory")->Evaluate(reader));
+    // a string cannot lead to LevelName.x, so it is left out
+    assert(!ImNBT::Path::Compile("Data.LevelName")->Evaluate(reader));
+    assert(!reader.MaybeReadInt("LevelName"));
+    std::vector<ImNBT::TagRef> const sections = ImNBT::Path::Compile("Data.Sections[*]")->All(reader);
+    assert(sections.size() == 3);
+    for (int i = 0; i < 3; ++i)
+    {
+      assert(sections[i].Size() == 1);
+      assert(sections[i]["Y"].As<int8_t>() == int8_t(i));
+    }
+  }
+
+  reader.SetLazyImport(false);
+  // a skipped subtree that is cut short fails the import
+  assert(reader.SetProjection({ "Data.LevelName" }));
+  assert(reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size())));
+  assert(!reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size() - 300)));
+
+  assert(reader.SetProjection({}));
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  assert(reader.ReadInt("LevelName") == 1);
+}
+
+void ExtractionTest()
+{
+  ImNBT::Writer writer;
+  if (writer.BeginCompound("Data"))
+  {
+    writer.WriteInt(3465, "DataVersion");
+    if (writer.BeginCompound("Player"))
+    {
+      writer.WriteString("Steve", "Name");
+      writer.WriteInt(20, "Health");
+      writer.EndCompound();
+    }
+    writer.WriteString("world", "LevelName");
+    if (writer.BeginList("Chunks"))
+    {
+      // noise, so the compressed tail stays large
+      uint64_t state = 1;
+      std::array<int64_t, 512> noise;
+      for (int chunk = 0; chunk < 64; ++chunk)
+      {
+        for (int64_t& value : noise)
+          value = static_cast<int64_t>(state = state * 6364136223846793005ull + 1442695040888963407ull);
+        if (writer.BeginCompound())
+        {
+          writer.WriteInt(chunk, "xPos");
+          writer.WriteLongArray(noise.data(), static_cast<int32_t>(noise.size()), "Noise");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.EndCompound();
+  }
+  writer.Finalize();
+  writer.ExportBinaryFile("./test/output/extraction.nbt");
+
+  // cut the file in half, so only reads that end before the chunks succeed
+  std::vector<char> file;
+  {
+    std::ifstream in("./test/output/extraction.nbt", std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  std::ofstream("./test/output/extraction_truncated.nbt", std::ios::binary).write(file.data(), file.size() / 2);
+
+  ImNBT::Reader reader;
+  assert(reader.ImportBinaryFile("./test/output/extraction.nbt"));
+  assert(!reader.ImportBinaryFile("./test/output/extraction_truncated.nbt"));
+
+  assert(reader.ImportBinaryFileFields("./test/output/extraction_truncated.nbt", { "Data.DataVersion", "Data.Player.Name" }));
+  assert(ImNBT::Path::Compile("Data.DataVersion")->Evaluate(reader).As<int32_t>() == 3465);
+  assert(ImNBT::Path::Compile("Data.Player.Name")->Evaluate(reader).As<ImNBT::StringView>() == "Steve");
+  assert(!ImNBT::Path::Compile("Data.Player.Health")->Evaluate(reader));
+  assert(reader.OpenCompound("Data") && reader.Count() == 2);
+  reader.CloseCompound();
+
+  // a missing entry is resolved when the compound that would hold it closes
+  assert(reader.ImportBinaryFileFields("./test/output/extraction_truncated.nbt", { "Data.Player.Missing", "Data.Player.Health" }));
+  assert(ImNBT::Path::Compile("Data.Player.Health")->Evaluate(reader).As<int32_t>() == 20);
+  assert(!reader.ImportBinaryFileFields("./test/output/extraction_truncated.nbt", { "Data.Missing" }));
+
+  // a wildcard is only resolved at the end of its container
+  assert(!reader.ImportBinaryFileFields("./test/output/extraction_truncated.nbt", { "Data.Chunks[*].xPos" }));
+  assert(reader.ImportBinaryFileFields("./test/output/extraction.nbt", { "Data.Chunks[*].xPos", "Data.LevelName" }));
+  std::vector<ImNBT::TagRef> const chunks = ImNBT::Path::Compile("Data.Chunks[*]")->All(reader);
+  assert(chunks.size() == 64);
+  assert(chunks[63].Size() == 1 && chunks[63]["xPos"].As<int32_t>() == 63);
+  assert(ImNBT::Path::Compile("Data.LevelName")->Evaluate(reader).As<ImNBT::StringView>() == "world");
+
+  assert(!reader.ImportBinaryFileFields("./test/output/extraction.nbt", { "Data..x" }));
+  assert(!reader.ImportBinaryFileFields("./test/output/missing.nbt", { "Data" }));
+}
+
+void IndexTest()
+{
+  ImNBT::Writer writer;
+  if (writer.BeginCompound("Data"))
+  {
+    writer.WriteInt(3465, "DataVersion");
+    writer.WriteString("quoted", "a.b");
+    if (writer.BeginList("Heights"))
+    {
+      for (int32_t height : { 62, 63, 64 })
+        writer.WriteInt(height);
+      writer.EndList();
+    }
+    if (writer.BeginList("Chunks"))
+    {
+      uint64_t state = 7;
+      std::array<int64_t, 512> noise;
+      for (int chunk = 0; chunk < 64; ++chunk)
+      {
+        for (int64_t& value : noise)
+          value = static_cast<int64_t>(state = state * 6364136223846793005ull + 1442695040888963407ull);
+        if (writer.BeginCompound())
+        {
+          writer.WriteInt(chunk, "xPos");
+          writer.WriteLongArray(noise.data(), static_cast<int32_t>(noise.size()), "Noise");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.EndCompound();
+  }
+  writer.Finalize();
+  writer.ExportBinaryFile("./test/output/indexed.nbt");
+  writer.ExportBinaryFileUncompressed("./test/output/indexed_uncompr.nbt");
+
+  ImNBT::Reader full;
+  assert(full.ImportBinaryFile("./test/output/indexed.nbt"));
+  std::vector<int64_t> noise;
+  if (full.OpenCompound("Data") && full.OpenList("Chunks"))
+  {
+    for (int chunk = 0; chunk <= 40 && full.OpenCompound(); ++chunk)
+    {
+      noise = full.ReadLongArray("Noise");
+      full.CloseCompound();
+    }
+    full.CloseList();
+    full.CloseCompound();
+  }
+
+  for (char const* file : { "./test/output/indexed.nbt", "./test/output/indexed_uncompr.nbt" })
+  {
+    ImNBT::Optional<ImNBT::OffsetIndex> index = ImNBT::OffsetIndex::Build(file, 4, 16 * 1024);
+    assert(index && index->IsCurrent());
+    assert((index->CheckpointCount() > 1) == (file == std::string("./test/output/indexed.nbt")));
+    assert(index->Find("Data.Chunks[63].xPos") && !index->Find("Data.Chunks[64]"));
+    assert(index->Save("./test/output/indexed.idx"));
+    index = ImNBT::OffsetIndex::Load("./test/output/indexed.idx", file);
+    assert(index);
+
+    ImNBT::Reader reader;
+    assert(reader.ImportIndexedSubtree(*index, "Data.Chunks[40]"));
+    assert(reader.ReadInt("xPos") == 40);
+    assert(reader.ReadLongArray("Noise") == noise);
+    assert(reader.ImportIndexedSubtree(*index, "Data.DataVersion"));
+    assert(reader.ReadInt("DataVersion") == 3465);
+    assert(reader.ImportIndexedSubtree(*index, "Data.\"a.b\""));
+    assert(reader.ReadString("a.b") == "quoted");
+    assert(reader.ImportIndexedSubtree(*index, "Data.Chunks[5].xPos"));
+    assert(reader.ReadInt("xPos") == 5);
+    assert(reader.ImportIndexedSubtree(*index, "Data.Heights[2]"));
+    assert(reader.Root()[""].As<int32_t>() == 64);
+    assert(!reader.ImportIndexedSubtree(*index, "Data.Missing"));
+  }
+
+  // entries past 2 GiB are read from where they are, the file is sparse where supported
+  {
+    std::ifstream source("./test/output/indexed_uncompr.nbt", std::ios::binary);
+    std::vector<char> const bytes{ std::istreambuf_iterator<char>(source), std::istreambuf_iterator<char>() };
+    uint64_t const offset = (uint64_t(1) << 31) + 16;
+    std::ofstream large("./test/output/indexed_large.nbt", std::ios::binary);
+    large.write(bytes.data(), bytes.size());
+    large.seekp(static_cast<std::streamoff>(offset));
+    large.write("mark", 4);
+  }
+  {
+    ImNBT::Optional<ImNBT::OffsetIndex> const large = ImNBT::OffsetIndex::Build("./test/output/indexed_large.nbt");
+    assert(large && large->IsCurrent() && large->Find("Data.DataVersion"));
+    std::vector<uint8_t> mark;
+    assert(large->Read({ (uint64_t(1) << 31) + 16, 4, ImNBT::TAG::Int, false }, mark));
+    assert(std::string(mark.begin(), mark.end()) == "mark");
+  }
+  std::remove("./test/output/indexed_large.nbt");
+
+  // a changed file invalidates its index
+  ImNBT::Optional<ImNBT::OffsetIndex> const index = ImNBT::OffsetIndex::Build("./test/output/indexed.nbt");
+  assert(index && index->Save("./test/output/indexed.idx"));
+  ImNBT::Writer other;
+  other.WriteInt(1, "DataVersion");
+  other.Finalize();
+  other.ExportBinaryFile("./test/output/indexed.nbt");
+  assert(!index->IsCurrent());
+  assert(!ImNBT::OffsetIndex::Load("./test/output/indexed.idx", "./test/output/indexed.nbt"));
+  ImNBT::Reader reader;
+  assert(!reader.ImportIndexedSubtree(*index, "Data.DataVersion"));
+}
+
+// compares two documents by structure and values. Entry names are not compared
+bool SameTree(ImNBT::TagRef const& a, ImNBT::TagRef const& b)
+{
+  if (a.Type() != b.Type() || a.Size() != b.Size())
+    return false;
+  switch (a.Type())
+  {
+    case ImNBT::TAG::Compound:
+    case ImNBT::TAG::List:
+    {
+      auto const children = *ImNBT::Path::Compile(a.Type() == ImNBT::TAG::List ? "[*]" : "*");
+      std::vector<ImNBT::TagRef> aChildren, bChildren;
+      children.ForEach(a, [&](ImNBT::TagRef const& child) { aChildren.push_back(child); });
+      children.ForEach(b, [&](ImNBT::TagRef const& child) { bChildren.push_back(child); });
+      if (aChildren.size() != bChildren.size())
+        return false;
+      for (size_t i = 0; i < aChildren.size(); ++i)
+      {
+        if (!SameTree(aChildren[i], bChildren[i]))
+          return false;
+      }
+      return true;
+    }
+    case ImNBT::TAG::Byte: return a.As<int8_t>() == b.As<int8_t>();
+    case ImNBT::TAG::Short: return a.As<int16_t>() == b.As<int16_t>();
+    case ImNBT::TAG::Int: return a.As<int32_t>() == b.As<int32_t>();
+    case ImNBT::TAG::Long: return a.As<int64_t>() == b.As<int64_t>();
+    case ImNBT::TAG::Float: return a.As<float>() == b.As<float>();
+    case ImNBT::TAG::Double: return a.As<double>() == b.As<double>();
+    case ImNBT::TAG::String: return a.As<ImNBT::StringView>() == b.As<ImNBT::StringView>();
+    case ImNBT::TAG::Byte_Array: return a.AsByteArray() == b.AsByteArray();
+    case ImNBT::TAG::Int_Array: return a.AsIntArray() == b.AsIntArray();
+    case ImNBT::TAG::Long_Array: return a.AsLongArray() == b.AsLongArray();
+    default: return false;
+  }
+}
+
+void FrozenTest()
+{
+  ImNBT::Reader parsed;
+  assert(parsed.ImportBinaryFileUncompressed("./test/data/bigtest_uncompr"));
+  assert(parsed.ExportFrozenFile("./test/output/bigtest.frozen"));
+
+  ImNBT::Reader frozen;
+  assert(frozen.ImportFrozenFile("./test/output/bigtest.frozen"));
+  assert(SameTree(parsed.Root(), frozen.Root()));
+  assert(frozen.ReadLong("longTest") == 9223372036854775807ll);
+  if (frozen.OpenCompound("nested compound test"))
+  {
+    if (frozen.OpenCompound("egg"))
+    {
+      assert(frozen.ReadString("name") == "Eggbert");
+      frozen.CloseCompound();
+    }
+    frozen.CloseCompound();
+  }
+  assert((frozen.ReadIntArray("intArrayTest") == std::vector{ 66051, 67438087, 134810123, 202182159 }));
+
+  // a mapped image is read in place, and stays mapped for as long as the document is alive
+  ImNBT::DocumentPtr const mapped = frozen.ReleaseDocument();
+  ImNBT::Reader copied;
+  {
+    std::ifstream file("./test/output/bigtest.frozen", std::ios::binary);
+    std::vector<uint8_t> const image{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    assert(copied.ImportFrozen(image.data(), image.size()));
+  }
+  assert(SameTree(copied.Root(), mapped->Root()));
+  assert(mapped->MemoryUsage() + 1000 < copied.ReleaseDocument()->MemoryUsage());
+  assert(frozen.ImportFrozenFile("./test/output/bigtest.frozen"));
+  assert(mapped->Root()["nested compound test"]["egg"]["name"].As<ImNBT::StringView>() == "Eggbert");
+
+  // changes copy the values out of the mapping first
+  ImNBT::Editor editor{ mapped };
+  assert(editor.SetString(*ImNBT::Path::Compile("stringTest"), "changed"));
+  int32_t const changedInts[] = { 1, 2 };
+  assert(editor.SetIntArray(*ImNBT::Path::Compile("intArrayTest"), changedInts, 2));
+  ImNBT::DocumentPtr const changed = editor.Snapshot();
+  assert(changed->Root()["stringTest"].As<ImNBT::StringView>() == "changed");
+  assert(changed->Root()["longTest"].As<int64_t>() == 9223372036854775807ll);
+  assert(mapped->Root()["stringTest"].As<ImNBT::StringView>() == frozen.ReadString("stringTest"));
+  assert(frozen.ReadIntArray("intArrayTest").size() == 4);
+
+  // shaped lists, frozen from a lazy import
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteShapedListTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  ImNBT::Reader shaped;
+  shaped.SetListShaping(true);
+  shaped.SetLazyImport(true);
+  shaped.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  std::vector<uint8_t> image;
+  assert(shaped.ExportFrozen(image));
+  assert(frozen.ImportFrozen(image.data(), image.size()));
+  assert(SameTree(shaped.Root(), frozen.Root()));
+  for (int32_t i : frozen.Compounds("Palette"))
+  {
+    assert(frozen.ReadString("Name") == "block_" + std::to_string(i));
+    assert(frozen.ReadInt("Id") == i * 3);
+  }
+
+  // damaged images are rejected, or at least imported without reading outside of them
+  assert(!frozen.ImportFrozen(image.data(), image.size() - 1));
+  assert(!frozen.ImportFrozen(image.data(), 16));
+  for (size_t i = 0; i < image.size(); ++i)
+  {
+    std::vector<uint8_t> damaged = image;
+    damaged[i] ^= 0xFF;
+    bool const imported = frozen.ImportFrozen(damaged.data(), damaged.size());
+    // the magic, version, byte order, header size and section count
+    assert(!imported || i >= 24);
+    if (imported)
+    {
+      std::vector<uint8_t> exported;
+      ImNBT::Writer{ frozen.ReleaseDocument() }.ExportBinary(exported);
+    }
+  }
+
+  // images with a compound that holds itself are rejected, however well they are in bounds
+  {
+    ImNBT::Writer writer;
+    if (writer.BeginCompound("a"))
+    {
+      if (writer.BeginCompound("b"))
+        writer.EndCompound();
+      writer.EndCompound();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  frozen.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  assert(frozen.ExportFrozen(image) && frozen.ImportFrozen(image.data(), image.size()));
+  // the offset and count of the storage entries section, which make every compound hold the same compound
+  uint64_t entries[2];
+  std::memcpy(entries, image.data() + 32 + 3 * 16, sizeof(entries));
+  for (uint64_t entry = 0; entry < entries[1]; ++entry)
+  {
+    uint64_t const tagIndex = 1;
+    std::memcpy(image.data() + entries[0] + entry * sizeof(uint64_t), &tagIndex, sizeof(tagIndex));
+  }
+  assert(!frozen.ImportFrozen(image.data(), image.size()));
+
+  ImNBT::Reader empty;
+  assert(!empty.ExportFrozen(image));
+  assert(!empty.ImportFrozenFile("./test/output/missing.frozen"));
+}
+
+void CacheTest()
+{
+  ImNBT::DocumentCache cache;
+  ImNBT::DocumentPtr const first = cache.Get("./test/data/bigtest_uncompr");
+  assert(first && first->Root()["longTest"].As<int64_t>() == 9223372036854775807ll);
+  assert(cache.Get("./test/data/bigtest_uncompr") == first);
+  assert(!cache.Get("./test/output/missing.nbt"));
+  std::ofstream("./test/output/garbage.nbt") << "{ a: 1 ]";
+  assert(!cache.Get("./test/output/garbage.nbt"));
+  ImNBT::DocumentCache::Stats stats = cache.GetStats();
+  assert(stats.hits == 1 && stats.misses == 2 && stats.failedLoads == 1);
+  assert(stats.documents == 1 && stats.memoryUsage == first->MemoryUsage());
+
+  // a changed file is parsed again
+  auto const writeFile = [](int32_t value) {
+    ImNBT::Writer writer;
+    writer.WriteInt(value, "value");
+    std::array<int8_t, 4096> padding{};
+    writer.WriteByteArray(padding.data(), value, "padding");
+    writer.Finalize();
+    writer.ExportBinaryFile("./test/output/cached.nbt");
+  };
+  writeFile(1);
+  ImNBT::DocumentPtr const before = cache.Get("./test/output/cached.nbt");
+  writeFile(2);
+  ImNBT::DocumentPtr const after = cache.Get("./test/output/cached.nbt");
+  assert(before->Root()["value"].As<int32_t>() == 1);
+  assert(after->Root()["value"].As<int32_t>() == 2);
+
+  // documents keyed by content
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    writer.WriteString("shared", "name");
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  std::vector<uint8_t> const copy = data;
+  ImNBT::DocumentPtr const fromData = cache.Get(data.data(), data.size());
+  assert(fromData && cache.Get(copy.data(), copy.size()) == fromData);
+
+  // the least recently used documents go first, and stay alive while held
+  cache.SetMemoryBudget(fromData->MemoryUsage() + data.size() + after->MemoryUsage());
+  stats = cache.GetStats();
+  assert(stats.documents == 2 && stats.evictions == 2);
+  assert(first->Root()["shortTest"].As<int16_t>() == 32767);
+  assert(cache.Get("./test/output/cached.nbt") == after);
+  assert(cache.Get("./test/data/bigtest_uncompr") != first);
+
+  // concurrent misses parse once
+  cache.Clear();
+  cache.SetMemoryBudget(256u << 20);
+  ImNBT::DocumentCache::Stats const previous = cache.GetStats();
+  std::vector<std::thread> threads;
+  std::vector<ImNBT::DocumentPtr> results(8);
+  std::atomic<int> ready{ 0 };
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    threads.emplace_back([&, i]() {
+      ++ready;
+      while (ready < static_cast<int>(results.size())) {}
+      results[i] = cache.Get("./test/data/bigtest_uncompr");
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  for (ImNBT::DocumentPtr const& result : results)
+    assert(result && result == results.front());
+  stats = cache.GetStats();
+  assert(stats.documents == 1);
+  assert(stats.misses - stats.sharedLoads == previous.misses - previous.sharedLoads + 1);
+  assert(stats.hits + stats.misses == previous.hits + previous.misses + results.size());
+}
+
+void CursorTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteShapedListTestData(writer);
+    writer.WriteString("tail", "Last");
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  ImNBT::Reader reader;
+  reader.SetListShaping(true);
+  reader.SetLazyImport(true);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::DocumentPtr const document = reader.ReleaseDocument();
+  assert(document && !reader.ReleaseDocument());
+  static_assert(sizeof(ImNBT::Cursor) <= 64, "cursors are created per request");
+
+  // many threads read one document, each with its own cursors
+  std::vector<std::thread> threads;
+  std::atomic<int> failures{ 0 };
+  for (int t = 0; t < 8; ++t)
+  {
+    threads.emplace_back([&]() {
+      for (int repetition = 0; repetition < 200; ++repetition)
+      {
+        ImNBT::Cursor cursor{ document };
+        bool ok = cursor.OpenCompound() && cursor.ReadString("Last") == "tail";
+        if (cursor.OpenList("Palette"))
+        {
+          int32_t const size = cursor.ListSize();
+          for (int32_t i = 0; i < size && cursor.OpenCompound(); ++i)
+          {
+            ok = ok && cursor.Count() == 3 && cursor.ReadString("Name") == "block_" + std::to_string(i) && cursor.ReadInt("Id") == i * 3;
+            ok = ok && !cursor.MaybeReadLong("Id") && !cursor.MaybeReadInt("Missing");
+            if (cursor.OpenList("Pos"))
+            {
+              ok = ok && cursor.ReadDouble() == i + 0.25 && cursor.ReadDouble() == i + 0.75 && !cursor.MaybeReadDouble();
+              cursor.CloseList();
+            }
+            cursor.CloseCompound();
+          }
+          ok = ok && !cursor.OpenCompound();
+          cursor.CloseList();
+        }
+        else
+        {
+          ok = false;
+        }
+        cursor.CloseCompound();
+        ok = ok && cursor.ReadString("Last") == "tail";
+        if (!ok)
+          ++failures;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  assert(failures == 0);
+
+  ImNBT::Cursor empty{ nullptr };
+  assert(!empty.OpenList("Palette") && empty.ReadInt("Id") == 0 && empty.Count() == 0);
+}
+
+void SnapshotTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteShapedListTestData(writer);
+    writer.WriteInt(7, "Version");
+    if (writer.BeginList("Heights"))
+    {
+      for (int i = 0; i < 64; ++i)
+        writer.WriteShort(static_cast<int16_t>(i));
+      writer.EndList();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  ImNBT::Reader reader;
+  reader.SetListShaping(true);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::DocumentPtr const original = reader.ReleaseDocument();
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  auto const value = [&](ImNBT::DocumentPtr const& document, char const* expression) { return path(expression).Evaluate(document->Root()); };
+
+  // a named tag, an element of a list, a field of a shaped list element, an element of a list held by such a field
+  // and an entry of a compound in a list
+  ImNBT::Editor editor{ original };
+  assert(editor.SetInt(path("Version"), 8));
+  assert(editor.SetShort(path("Heights[5]"), -5));
+  assert(editor.SetInt(path("Palette[4].Id"), 1000));
+  assert(editor.SetDouble(path("Palette[6].Pos[1]"), -1.5));
+  assert(editor.SetInt(path("Mixed[3].odd"), 33));
+  assert(!editor.SetLong(path("Version"), 1) && !editor.SetInt(path("Missing"), 1) && !editor.SetInt(path("Palette[*].Id"), 1));
+  assert(path("Palette[4].Id").Evaluate(editor.Root()).As<int32_t>() == 1000);
+  ImNBT::DocumentPtr const edited = editor.Snapshot();
+
+  assert(value(original, "Version").As<int32_t>() == 7 && value(edited, "Version").As<int32_t>() == 8);
+  assert(value(original, "Heights[5]").As<int16_t>() == 5 && value(edited, "Heights[5]").As<int16_t>() == -5);
+  assert(value(edited, "Heights[4]").As<int16_t>() == 4 && value(edited, "Heights[63]").As<int16_t>() == 63);
+  assert(value(original, "Palette[4].Id").As<int32_t>() == 12 && value(edited, "Palette[4].Id").As<int32_t>() == 1000);
+  assert(value(edited, "Palette[5].Id").As<int32_t>() == 15 && value(edited, "Palette[5].Name").As<ImNBT::StringView>() == "block_5");
+  assert(value(original, "Palette[6].Pos[1]").As<double>() == 6.75 && value(edited, "Palette[6].Pos[1]").As<double>() == -1.5);
+  assert(value(edited, "Palette[6].Pos[0]").As<double>() == 6.25 && value(edited, "Palette[7].Pos[1]").As<double>() == 7.75);
+  assert(value(original, "Mixed[3].odd").As<int32_t>() == 3 && value(edited, "Mixed[3].odd").As<int32_t>() == 33);
+
+  // the edit copied only what it touched, and a snapshot without edits shares everything
+  assert(edited->MemoryUsage(*original) > 0 && edited->MemoryUsage(*original) < original->MemoryUsage());
+  assert(editor.Snapshot()->MemoryUsage(*edited) == 0);
+
+  // editors branching from one snapshot do not see each other's edits
+  ImNBT::Editor left{ edited }, right{ edited };
+  assert(left.SetShort(path("Heights[5]"), 100) && right.SetShort(path("Heights[5]"), 200));
+  assert(left.SetInt(path("Palette[4].Id"), 101) && right.SetInt(path("Palette[4].Id"), 201));
+  assert(value(left.Snapshot(), "Heights[5]").As<int16_t>() == 100 && value(right.Snapshot(), "Heights[5]").As<int16_t>() == 200);
+  assert(value(left.Snapshot(), "Palette[4].Id").As<int32_t>() == 101 && value(right.Snapshot(), "Palette[4].Id").As<int32_t>() == 201);
+  assert(value(edited, "Heights[5]").As<int16_t>() == -5 && value(edited, "Palette[4].Id").As<int32_t>() == 1000);
+
+  // readers of a snapshot are unaffected by the edits made while they read
+  std::atomic<bool> editing{ true };
+  std::atomic<int> failures{ 0 };
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+  {
+    readers.emplace_back([&]() {
+      ImNBT::Path const version = path("Version"), height = path("Heights[5]"), id = path("Palette[4].Id"), position = path("Palette[6].Pos[1]");
+      do
+      {
+        ImNBT::TagRef const root = edited->Root();
+        if (version.Evaluate(root).As<int32_t>() != 8 || height.Evaluate(root).As<int16_t>() != -5 ||
+            id.Evaluate(root).As<int32_t>() != 1000 || position.Evaluate(root).As<double>() != -1.5)
+          ++failures;
+      } while (editing);
+    });
+  }
+  ImNBT::Path const version = path("Version"), height = path("Heights[5]"), id = path("Palette[4].Id"), position = path("Palette[6].Pos[1]");
+  for (int i = 0; i < 500; ++i)
+  {
+    assert(editor.SetInt(version, 100 + i) && editor.SetShort(height, static_cast<int16_t>(i)) && editor.SetInt(id, i) && editor.SetDouble(position, i));
+    ImNBT::DocumentPtr const latest = editor.Snapshot();
+    assert(version.Evaluate(latest->Root()).As<int32_t>() == 100 + i && position.Evaluate(latest->Root()).As<double>() == i);
+  }
+  editing = false;
+  for (std::thread& thread : readers)
+    thread.join();
+  assert(failures == 0);
+}
+
+static void WriteMutationTestData(ImNBT::Writer& writer)
+{
+  WriteShapedListTestData(writer);
+  writer.WriteInt(7, "Version");
+  if (writer.BeginList("Heights"))
+  {
+    for (int i = 0; i < 8; ++i)
+      writer.WriteShort(static_cast<int16_t>(i));
+    writer.EndList();
+  }
+  std::array<int32_t, 3> const ints{ 1, 2, 3 };
+  writer.WriteIntArray(ints.data(), static_cast<int32_t>(ints.size()), "Ints");
+  std::array<int64_t, 2> const longs{ 1003370060459195070, -2401053089480183795 };
+  writer.WriteLongArray(longs.data(), static_cast<int32_t>(longs.size()), "Longs");
+}
+
+void MutationTest()
+{
+  std::vector<uint8_t> data;
+  std::string text;
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(data);
+    writer.ExportString(text);
+  }
+  ImNBT::Reader reader;
+  reader.SetListShaping(true);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::DocumentPtr const original = reader.ReleaseDocument();
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  auto const exportBinary = [](ImNBT::DocumentPtr const& document) {
+    std::vector<uint8_t> out;
+    ImNBT::Writer{ document }.ExportBinary(out);
+    return out;
+  };
+
+  // a parsed document exports as it was read
+  {
+    ImNBT::Writer writer{ original };
+    std::string exportedText;
+    assert(writer.ExportString(exportedText) && exportedText == text);
+    assert(exportBinary(original) == data);
+  }
+
+  ImNBT::Editor editor{ original };
+  std::array<int32_t, 4> const ints{ 4, 5, 6, 7 };
+  assert(editor.SetString(path("Trailer"), "changed"));
+  assert(editor.SetIntArray(path("Ints"), ints.data(), static_cast<int32_t>(ints.size())));
+  assert(editor.InsertInt(path(""), "Version", 9));
+  assert(editor.InsertCompound(path(""), "Extra") && editor.InsertString(path("Extra"), "Name", "extra") && editor.InsertList(path("Extra"), "Values"));
+  for (int64_t i = 1; i <= 3; ++i)
+    assert(editor.AppendLong(path("Extra.Values"), i));
+  // structural changes to a shaped list store it as a regular list again
+  assert(editor.AppendCompound(path("Palette")) && editor.InsertInt(path("Palette[-1]"), "Id", 60));
+  assert(editor.Remove(path("Palette[2].Pos")) && editor.SetInt(path("Palette[5].Id"), 1005));
+  assert(editor.Remove(path("Heights[0]")) && editor.Remove(path("Mixed[3].odd")));
+
+  assert(!editor.AppendInt(path("Heights"), 1) && !editor.AppendCompound(path("Version")) && !editor.Remove(path("")));
+  assert(!editor.InsertInt(path("Version"), "x", 1) && !editor.SetString(path("Version"), "x") && !editor.Remove(path("Heights[7]")));
+
+  std::vector<uint8_t> expected;
+  {
+    ImNBT::Writer writer;
+    if (writer.BeginList("Palette"))
+    {
+      for (int i = 0; i < 20; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          writer.WriteString("block_" + std::to_string(i), "Name");
+          writer.WriteInt(i == 5 ? 1005 : i * 3, "Id");
+          if (i != 2 && writer.BeginList("Pos"))
+          {
+            writer.WriteDouble(i + 0.25);
+            writer.WriteDouble(i + 0.75);
+            writer.EndList();
+          }
+          writer.EndCompound();
+        }
+      }
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(60, "Id");
+        writer.EndCompound();
+      }
+      writer.EndList();
+    }
+    if (writer.BeginList("Mixed"))
+    {
+      for (int i = 0; i < 10; ++i)
+      {
+        if (writer.BeginCompound())
+        {
+          if (i != 3)
+            writer.WriteInt(i, i % 2 ? "odd" : "even");
+          writer.EndCompound();
+        }
+      }
+      writer.EndList();
+    }
+    writer.WriteString("changed", "Trailer");
+    writer.WriteInt(9, "Version");
+    if (writer.BeginList("Heights"))
+    {
+      for (int i = 1; i < 8; ++i)
+        writer.WriteShort(static_cast<int16_t>(i));
+      writer.EndList();
+    }
+    writer.WriteIntArray(ints.data(), static_cast<int32_t>(ints.size()), "Ints");
+    std::array<int64_t, 2> const longs{ 1003370060459195070, -2401053089480183795 };
+    writer.WriteLongArray(longs.data(), static_cast<int32_t>(longs.size()), "Longs");
+    if (writer.BeginCompound("Extra"))
+    {
+      writer.WriteString("extra", "Name");
+      if (writer.BeginList("Values"))
+      {
+        for (int64_t i = 1; i <= 3; ++i)
+          writer.WriteLong(i);
+        writer.EndList();
+      }
+      writer.EndCompound();
+    }
+    writer.Finalize();
+    writer.ExportBinary(expected);
+  }
+  ImNBT::DocumentPtr const edited = editor.Snapshot();
+  assert(exportBinary(edited) == expected);
+  assert(exportBinary(original) == data);
+  assert((path("Ints").Evaluate(edited->Root()).AsIntArray() == std::vector<int32_t>{ 4, 5, 6, 7 }));
+
+  // compacting drops what edits left behind, without changing the document
+  assert(editor.Compact() > 0);
+  assert(exportBinary(editor.Snapshot()) == expected && exportBinary(edited) == expected);
+  assert(editor.Snapshot()->MemoryUsage() < edited->MemoryUsage());
+
+  // appending to the list that ends its pool does not move it
+  assert(editor.InsertList(path(""), "Counter"));
+  for (int32_t i = 0; i < 1000; ++i)
+    assert(editor.AppendInt(path("Counter"), i));
+  for (int32_t i = 0; i < 500; ++i)
+    assert(editor.Remove(path("Counter[0]")));
+  ImNBT::TagRef const counter = path("Counter").Evaluate(editor.Root());
+  assert(counter.Size() == 500 && counter[0].As<int32_t>() == 500 && counter[499].As<int32_t>() == 999);
+}
+
+void RoundTripTest()
+{
+  std::vector<uint8_t> data;
+  std::string text;
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    if (writer.BeginList("Arrays"))
+    {
+      std::array<int64_t, 3> const longs{ 1, -2, 3 };
+      writer.WriteLongArray(longs.data(), static_cast<int32_t>(longs.size()));
+      writer.WriteLongArray(longs.data(), 1);
+      writer.EndList();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+    writer.ExportString(text);
+  }
+
+  // binary to binary and text, with and without shaping or lazy import
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    ImNBT::Reader reader;
+    reader.SetListShaping(mode == 1);
+    reader.SetLazyImport(mode == 2);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    std::vector<uint8_t> binary;
+    std::string exportedText;
+    ImNBT::Writer writer{ reader };
+    assert(writer.ExportBinary(binary) && binary == data);
+    assert(writer.ExportString(exportedText) && exportedText == text);
+    // the reader is still usable
+    assert(reader.ReadInt("Version") == 7 && (reader.ReadIntArray("Ints") == std::vector<int32_t>{ 1, 2, 3 }));
+  }
+
+  // text to binary, through a file
+  ImNBT::Reader reader;
+  reader.ImportString(text.data(), static_cast<uint32_t>(text.size()));
+  assert(ImNBT::Writer{ reader }.ExportBinaryFile("./test/output/roundtrip.nbt"));
+  assert(reader.ImportBinaryFile("./test/output/roundtrip.nbt"));
+  std::vector<uint8_t> binary;
+  ImNBT::Writer{ reader }.ExportBinary(binary);
+  assert(binary == data);
+
+  ImNBT::Reader empty;
+  std::vector<uint8_t> emptyBinary;
+  assert(ImNBT::Writer{ empty }.ExportBinary(emptyBinary) && emptyBinary.size() == 4);
+}
+
+void PassthroughTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    for (char const* name : { "Kept", "Edited" })
+    {
+      if (writer.BeginCompound(name))
+      {
+        if (writer.BeginList("Empty"))
+          writer.EndList();
+        writer.WriteInt(1, "x");
+        writer.EndCompound();
+      }
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  // an empty list may declare any element type, which is only kept by copying the bytes as they were read
+  std::string const emptyList = std::string{ '\x09', '\x00', '\x05' } + "Empty";
+  std::vector<size_t> elementTypes;
+  for (auto at = data.begin(); (at = std::search(at, data.end(), emptyList.begin(), emptyList.end())) != data.end(); ++at)
+    elementTypes.push_back(static_cast<size_t>(at - data.begin()) + emptyList.size());
+  assert(elementTypes.size() == 2);
+  for (size_t at : elementTypes)
+    data[at] = static_cast<uint8_t>(ImNBT::TAG::Int);
+
+  auto const exportBinary = [](ImNBT::DocumentPtr const& document) {
+    std::vector<uint8_t> out;
+    ImNBT::Writer{ document }.ExportBinary(out);
+    return out;
+  };
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    ImNBT::Reader reader;
+    reader.SetSourcePassthrough(true);
+    reader.SetListShaping(mode == 1);
+    reader.SetLazyImport(mode == 2);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::DocumentPtr const original = reader.ReleaseDocument();
+    assert(exportBinary(original) == data);
+
+    // only the changed compounds, and the compounds holding them, are encoded again
+    ImNBT::Editor editor{ original };
+    assert(editor.SetInt(path("Edited.x"), 2) && editor.SetInt(path("Palette[3].Id"), 33) && editor.SetShort(path("Heights[1]"), 11));
+    std::vector<uint8_t> expected = data;
+    expected[elementTypes[1]] = static_cast<uint8_t>(ImNBT::TAG::End);
+    expected[elementTypes[1] + 5 + 3 + 1 + 3] = 2;
+    std::vector<uint8_t> edited = exportBinary(editor.Snapshot());
+    assert(edited.size() == expected.size() && edited != data);
+    assert(std::equal(expected.begin() + elementTypes[0] - 16, expected.end(), edited.begin() + elementTypes[0] - 16));
+    {
+      ImNBT::Reader check;
+      check.ImportBinary(edited.data(), static_cast<uint32_t>(edited.size()));
+      assert(check.ReadInt("Version") == 7);
+      ImNBT::TagRef const root = check.Root();
+      assert(path("Palette[3].Id").Evaluate(root).As<int32_t>() == 33 && path("Palette[4].Id").Evaluate(root).As<int32_t>() == 12);
+      assert(path("Heights[1]").Evaluate(root).As<int16_t>() == 11 && path("Mixed[3].odd").Evaluate(root).As<int32_t>() == 3);
+    }
+
+    // compacting keeps what has not changed
+    editor.Compact();
+    assert(exportBinary(editor.Snapshot()) == edited);
+  }
+
+  // without passthrough, or with a projection, everything is encoded from the document
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  std::vector<uint8_t> encoded;
+  ImNBT::Writer{ reader }.ExportBinary(encoded);
+  assert(encoded != data && encoded[elementTypes[0]] == static_cast<uint8_t>(ImNBT::TAG::End));
+  reader.SetSourcePassthrough(true);
+  assert(reader.SetProjection({ "Kept", "Heights" }));
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  std::vector<uint8_t> projected;
+  ImNBT::Writer{ reader }.ExportBinary(projected);
+  reader.SetSourcePassthrough(false);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  std::vector<uint8_t> reference;
+  ImNBT::Writer{ reader }.ExportBinary(reference);
+  assert(projected.size() == reference.size() && projected != reference);
+}
+
+void CopyTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  // the same tags written by hand
+  std::vector<uint8_t> expected;
+  {
+    ImNBT::Writer writer;
+    if (writer.BeginCompound("Copy"))
+    {
+      WriteMutationTestData(writer);
+      writer.EndCompound();
+    }
+    writer.WriteInt(7, "Version");
+    std::array<int64_t, 2> const longs{ 1003370060459195070, -2401053089480183795 };
+    writer.WriteLongArray(longs.data(), static_cast<int32_t>(longs.size()), "Longs");
+    if (writer.BeginList("Rows"))
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteString("block_3", "Name");
+        writer.WriteInt(9, "Id");
+        if (writer.BeginList("Pos"))
+        {
+          writer.WriteDouble(3.25);
+          writer.WriteDouble(3.75);
+          writer.EndList();
+        }
+        writer.EndCompound();
+      }
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(4, "even");
+        writer.EndCompound();
+      }
+      writer.EndList();
+    }
+    if (writer.BeginList("Lists"))
+    {
+      if (writer.BeginList())
+      {
+        for (int i = 0; i < 8; ++i)
+          writer.WriteShort(static_cast<int16_t>(i));
+        writer.EndList();
+      }
+      if (writer.BeginList())
+      {
+        writer.WriteDouble(5.25);
+        writer.WriteDouble(5.75);
+        writer.EndList();
+      }
+      writer.EndList();
+    }
+    writer.Finalize();
+    writer.ExportBinary(expected);
+  }
+
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    ImNBT::Reader reader;
+    reader.SetListShaping(mode == 1);
+    reader.SetLazyImport(mode == 2);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::Writer writer;
+    writer.SetListShaping(mode != 0);
+    ImNBT::TagRef const root = reader.Root();
+    assert(writer.WriteCopy(root, "Copy"));
+    assert(writer.WriteCopy(root["Version"], "Version") && writer.WriteCopy(root["Longs"], "Longs"));
+    if (writer.BeginList("Rows"))
+    {
+      assert(writer.WriteCopy(path("Palette[3]").Evaluate(root)) && writer.WriteCopy(path("Mixed[4]").Evaluate(root)));
+      writer.EndList();
+    }
+    if (writer.BeginList("Lists"))
+    {
+      assert(reader.OpenList("Heights"));
+      assert(writer.WriteCopy(reader.Current()));
+      reader.CloseList();
+      assert(writer.WriteCopy(path("Palette[5].Pos").Evaluate(root)));
+      writer.EndList();
+    }
+    assert(!writer.WriteCopy(root["Missing"], "Missing"));
+    writer.Finalize();
+    std::vector<uint8_t> copied;
+    writer.ExportBinary(copied);
+    assert(copied == expected);
+  }
+
+  // edits are copied along with the rest of a snapshot
+  ImNBT::Reader reader;
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::Editor editor{ reader.ReleaseDocument() };
+  assert(editor.SetInt(path("Palette[2].Id"), 22));
+  ImNBT::Writer writer;
+  assert(writer.WriteCopy(path("Palette").Evaluate(editor.Root()), "Palette"));
+  assert(writer.WriteCopy(editor.Root()["Ints"], "Ints"));
+  writer.Finalize();
+  std::vector<uint8_t> copied;
+  writer.ExportBinary(copied);
+  reader.ImportBinary(copied.data(), static_cast<uint32_t>(copied.size()));
+  assert(path("Palette[2].Id").Evaluate(reader.Root()).As<int32_t>() == 22 && path("Palette[19].Name").Evaluate(reader.Root()).As<ImNBT::StringView>() == "block_19");
+  assert((reader.ReadIntArray("Ints") == std::vector<int32_t>{ 1, 2, 3 }));
+}
+
+void ExportCacheTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    for (char const* name : { "Kept", "Edited" })
+    {
+      if (writer.BeginCompound(name))
+      {
+        writer.WriteInt(1, "x");
+        if (writer.BeginCompound("Inner"))
+        {
+          writer.WriteInt(1, "x");
+          writer.EndCompound();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  auto const valueAfter = [](std::vector<uint8_t> const& bytes, std::string const& name) {
+    return static_cast<size_t>(std::search(bytes.begin(), bytes.end(), name.begin(), name.end()) - bytes.begin()) + name.size() + 7;
+  };
+  size_t const keptValue = valueAfter(data, "Kept");
+  assert(data[keptValue] == 1);
+
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  auto const edit = [&](ImNBT::Editor& editor, int32_t value) {
+    return editor.SetInt(path("Edited.x"), value) && editor.SetInt(path("Palette[3].Id"), value) && editor.SetShort(path("Heights[1]"), static_cast<int16_t>(value));
+  };
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    ImNBT::Reader reader;
+    reader.SetListShaping(mode == 1);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::Editor editor{ reader.ReleaseDocument() };
+    auto output = editor.ExportBinary(mode == 0 ? 0 : 4096);
+    assert(output && *output == data);
+    // unchanged entries are copied from the previous output, so a value patched into it is kept
+    const_cast<std::vector<uint8_t>&>(*output)[keptValue] = 5;
+
+    for (int32_t round = 2; round < 5; ++round)
+    {
+      assert(edit(editor, round));
+      output = editor.ExportBinary(mode == 0 ? 0 : 4096);
+      ImNBT::Reader fresh;
+      fresh.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+      ImNBT::Editor uncached{ fresh.ReleaseDocument() };
+      assert(edit(uncached, round));
+      std::vector<uint8_t> expected;
+      ImNBT::Writer{ uncached.Snapshot() }.ExportBinary(expected);
+      expected[keptValue] = 5;
+      assert(*output == expected);
+    }
+    ImNBT::Reader check;
+    check.ImportBinary(output->data(), static_cast<uint32_t>(output->size()));
+    assert(path("Palette[3].Id").Evaluate(check.Root()).As<int32_t>() == 4 && path("Kept.x").Evaluate(check.Root()).As<int32_t>() == 5);
+
+    // snapshots share the output
+    std::vector<uint8_t> exported;
+    ImNBT::Writer{ editor.Snapshot() }.ExportBinary(exported);
+    assert(exported == *output);
+
+    // compounds inside a copied one keep their place in the output, so they are copied again once their parent changes
+    size_t const innerValue = valueAfter(*output, "Inner");
+    const_cast<std::vector<uint8_t>&>(*output)[innerValue] = 6;
+    assert(edit(editor, 5));
+    output = editor.ExportBinary(mode == 0 ? 0 : 4096);
+    assert(editor.SetInt(path("Kept.x"), 7));
+    output = editor.ExportBinary(mode == 0 ? 0 : 4096);
+    check.ImportBinary(output->data(), static_cast<uint32_t>(output->size()));
+    assert(path("Kept.x").Evaluate(check.Root()).As<int32_t>() == 7);
+    assert(path("Kept.Inner.x").Evaluate(check.Root()).As<int32_t>() == (mode == 0 ? 6 : 1));
+  }
+  ImNBT::Editor empty{ nullptr };
+  assert(!empty.ExportBinary());
+}
+
+// a document built in memory, whose tags are reached like those of a parsed one
+struct PatchBuilder : ImNBT::Writer
+{
+  ImNBT::TagRef Root() const { return ImNBT::TagRef{ &dataStore, dataStore.namedTags.front().dataTag }; }
+};
+
+void PatchTest()
+{
+  std::vector<uint8_t> data;
+  std::vector<int64_t> blocks(1000);
+  for (size_t i = 0; i < blocks.size(); ++i)
+    blocks[i] = static_cast<int64_t>(i * 0x0101010101);
+  {
+    ImNBT::Writer writer;
+    WriteMutationTestData(writer);
+    writer.WriteLongArray(blocks.data(), static_cast<int32_t>(blocks.size()), "Blocks");
+    if (writer.BeginList("Grid"))
+    {
+      for (int row = 0; row < 3; ++row)
+      {
+        if (writer.BeginList())
+        {
+          writer.WriteInt(row);
+          writer.EndList();
+        }
+      }
+      writer.EndList();
+    }
+    if (writer.BeginCompound("a.b"))
+    {
+      writer.WriteString("quoted", "\"key\"");
+      writer.EndCompound();
+    }
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  auto const exportBinary = [](ImNBT::DocumentPtr const& document) {
+    std::vector<uint8_t> out;
+    ImNBT::Writer{ document }.ExportBinary(out);
+    return out;
+  };
+
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    ImNBT::Reader reader;
+    reader.SetListShaping(mode == 1);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    ImNBT::DocumentPtr const from = reader.ReleaseDocument();
+    assert(ImNBT::Patch::Diff(from->Root(), from->Root())->Empty());
+
+    ImNBT::Editor editor{ from };
+    std::vector<int64_t> changedBlocks = blocks;
+    changedBlocks[10] = -1;
+    changedBlocks[11] = -2;
+    changedBlocks[500] = -3;
+    changedBlocks.push_back(7);
+    assert(editor.SetInt(path("Version"), 8) && editor.SetString(path("Trailer"), "changed"));
+    assert(editor.SetLongArray(path("Blocks"), changedBlocks.data(), static_cast<int32_t>(changedBlocks.size())));
+    assert(editor.InsertInt(path(""), "New", 5) && editor.Remove(path("Ints")));
+    assert(editor.Remove(path("Palette[19]")) && editor.Remove(path("Palette[18]")) && editor.SetInt(path("Palette[2].Id"), 22));
+    assert(editor.AppendCompound(path("Mixed")) && editor.InsertString(path("Mixed[10]"), "name", "added"));
+    assert(editor.InsertList(path(""), "Heights") && editor.AppendInt(path("Heights"), 1));
+    assert(editor.Remove(path("Grid[1][0]")) && editor.AppendString(path("Grid[1]"), "now a string"));
+    assert(editor.SetString(path("\"a.b\".\"\\\"key\\\"\""), "changed"));
+    ImNBT::DocumentPtr const to = editor.Snapshot();
+
+    ImNBT::Optional<ImNBT::Patch> const patch = ImNBT::Patch::Diff(from->Root(), to->Root());
+    assert(patch && !patch->Empty());
+    // a few values changed, so the patch is a small fraction of the document
+    assert(patch->Bytes().size() * 10 < data.size());
+
+    ImNBT::Optional<ImNBT::Patch> const received = ImNBT::Patch::Decode(patch->Bytes().data(), patch->Bytes().size());
+    assert(received);
+    ImNBT::Editor replica{ from };
+    assert(received->Apply(replica));
+    ImNBT::DocumentPtr const patched = replica.Snapshot();
+    assert(ImNBT::Patch::Diff(patched->Root(), to->Root())->Empty());
+    assert(exportBinary(patched) == exportBinary(to));
+
+    std::vector<ImNBT::Patch::Change> const changes = received->Changes();
+    auto const listed = [&](ImNBT::Patch::Change::Kind kind, char const* changed) {
+      return std::any_of(changes.begin(), changes.end(), [&](ImNBT::Patch::Change const& change) { return change.kind == kind && change.path == changed; });
+    };
+    using Kind = ImNBT::Patch::Change::Kind;
+    assert(listed(Kind::Changed, "Version") && listed(Kind::Changed, "Blocks") && listed(Kind::Changed, "Palette[2].Id"));
+    assert(listed(Kind::Added, "New") && listed(Kind::Removed, "Ints") && listed(Kind::Removed, "Palette[18]"));
+    assert(listed(Kind::Added, "Mixed[10]") && !listed(Kind::Added, "Mixed[10].name"));
+    assert(listed(Kind::Added, "Heights") && listed(Kind::Added, "Grid") && listed(Kind::Changed, "\"a.b\".\"\\\"key\\\"\""));
+
+    // a patch applied to another version of the document changes nothing
+    std::vector<uint8_t> const before = exportBinary(replica.Snapshot());
+    assert(!received->Apply(replica));
+    assert(exportBinary(replica.Snapshot()) == before);
+  }
+
+  // arrays of documents built in memory are in native order, and are diffed by value against parsed ones
+  {
+    PatchBuilder built;
+    WriteMutationTestData(built);
+    built.WriteLongArray(blocks.data(), static_cast<int32_t>(blocks.size()), "Blocks");
+    built.Finalize();
+    std::vector<uint8_t> builtData;
+    built.ExportBinary(builtData);
+    ImNBT::Reader reader;
+    reader.ImportBinary(builtData.data(), static_cast<uint32_t>(builtData.size()));
+    ImNBT::DocumentPtr const parsed = reader.ReleaseDocument();
+    assert(ImNBT::Patch::Diff(built.Root(), parsed->Root())->Empty());
+    ImNBT::Editor editor{ parsed };
+    std::vector<int64_t> changedBlocks = blocks;
+    changedBlocks[3] = -1;
+    assert(editor.SetLongArray(path("Blocks"), changedBlocks.data(), static_cast<int32_t>(changedBlocks.size())));
+    ImNBT::Optional<ImNBT::Patch> const patch = ImNBT::Patch::Diff(built.Root(), editor.Snapshot()->Root());
+    ImNBT::Editor replica{ parsed };
+    assert(patch && patch->Apply(replica) && replica.Root()["Blocks"].AsLongArray() == changedBlocks);
+  }
+
+  // the length of a patched array is checked without allocating it
+  std::vector<uint8_t> const large{ 1, 2, 1, 2, 'A', 0x0c, 0xff, 0xff, 0xff, 0xff, 0x07, 0 };
+  assert(ImNBT::Patch::Decode(large.data(), large.size()));
+  std::vector<uint8_t> const invalid{ 1, 1, 1, 0x09 };
+  assert(!ImNBT::Patch::Decode(invalid.data(), invalid.size()));
+  assert(!ImNBT::Patch::Diff(ImNBT::TagRef{}, ImNBT::TagRef{}));
+}
+
+// the entries of every compound are written in reverse order if reversed is set
+static void WriteHashTestData(ImNBT::Writer& writer, bool reversed)
+{
+  for (int entry = 0; entry < 4; ++entry)
+  {
+    switch (reversed ? 3 - entry : entry)
+    {
+      case 0: writer.WriteString("spawn", "Name"); break;
+      case 1: {
+        std::array<int32_t, 4> const ints{ 1, -2, 3, 1 << 20 };
+        writer.WriteIntArray(ints.data(), static_cast<int32_t>(ints.size()), "Ints");
+      }
+      break;
+      case 2:
+        if (writer.BeginCompound("Pos"))
+        {
+          for (int axis = 0; axis < 3; ++axis)
+          {
+            int const field = reversed ? 2 - axis : axis;
+            writer.WriteInt(field * 10, std::string(1, static_cast<char>('x' + field)));
+          }
+          writer.EndCompound();
+        }
+        break;
+      case 3:
+        if (writer.BeginList("Items"))
+        {
+          // enough elements to be stored as a shaped list
+          for (int i = 0; i < 10; ++i)
+          {
+            if (writer.BeginCompound())
+            {
+              if (!reversed)
+                writer.WriteString("item_" + std::to_string(i), "id");
+              writer.WriteByte(static_cast<int8_t>(i), "count");
+              if (reversed)
+                writer.WriteString("item_" + std::to_string(i), "id");
+              writer.EndCompound();
+            }
+          }
+          writer.EndList();
+        }
+        break;
+    }
+  }
+}
+
+void HashTest()
+{
+  auto const read = [](bool reversed, bool shaping) {
+    std::vector<uint8_t> data;
+    ImNBT::Writer writer;
+    WriteHashTestData(writer, reversed);
+    writer.Finalize();
+    writer.ExportBinary(data);
+    ImNBT::Reader reader;
+    reader.SetListShaping(shaping);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    return reader.ReleaseDocument();
+  };
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+  auto const exportCanonical = [](ImNBT::DocumentPtr const& document, std::string* text = nullptr) {
+    std::vector<uint8_t> out;
+    ImNBT::Writer writer{ document };
+    writer.SetCanonicalOrder(true);
+    writer.ExportBinary(out);
+    if (text)
+      writer.ExportString(*text);
+    return out;
+  };
+  using ImNBT::HashOrder;
+
+  ImNBT::DocumentPtr const document = read(false, true);
+  ImNBT::DocumentPtr const unshaped = read(false, false);
+  ImNBT::DocumentPtr const reversed = read(true, true);
+  ImNBT::TagRef const root = document->Root();
+
+  // how lists are stored does not matter, only what they hold
+  assert(root.Hash() != 0 && root.Hash() == unshaped->Root().Hash() && root.Equals(unshaped->Root()));
+  // the order of entries only matters to stored order hashes
+  assert(root.Hash() != reversed->Root().Hash());
+  assert(root.Hash(HashOrder::Canonical) == reversed->Root().Hash(HashOrder::Canonical));
+  assert(root.Equals(reversed->Root()) && root["Items"][2].Equals(reversed->Root()["Items"][2]));
+  assert(root["Pos"].Hash() != root["Items"].Hash() && !root["Pos"].Equals(root["Items"]));
+  assert(ImNBT::TagRef{}.Hash() == 0 && ImNBT::TagRef{}.Equals(ImNBT::TagRef{}) && !root.Equals(ImNBT::TagRef{}));
+
+  // editors cache the hashes and forget those of the compounds an edit changes
+  ImNBT::Editor editor{ document };
+  uint64_t const hash = editor.Hash(path(""));
+  assert(hash == root.Hash() && editor.Hash(path(""), HashOrder::Canonical) == root.Hash(HashOrder::Canonical));
+  ImNBT::DocumentPtr const hashed = editor.Snapshot();
+  assert(editor.SetInt(path("Pos.y"), 11) && editor.SetString(path("Items[3].id"), "changed"));
+  uint64_t const changed = editor.Hash(path(""));
+  // the cached hashes match those of a copy that has none
+  std::vector<uint8_t> edited;
+  ImNBT::Writer{ editor.Snapshot() }.ExportBinary(edited);
+  ImNBT::Reader copy;
+  copy.ImportBinary(edited.data(), static_cast<uint32_t>(edited.size()));
+  assert(changed != hash && changed == copy.Root().Hash() && copy.Root().Equals(editor.Root()));
+  assert(editor.Hash(path("Pos")) != root["Pos"].Hash() && editor.Hash(path("Ints")) == root["Ints"].Hash());
+  assert(hashed->Root().Hash() == hash && !hashed->Root().Equals(editor.Root()));
+  assert(editor.SetInt(path("Pos.y"), 10) && editor.SetString(path("Items[3].id"), "item_3"));
+  assert(editor.Hash(path("")) == hash && editor.Root().Equals(root));
+  assert(editor.InsertInt(path("Pos"), "w", 1) && editor.Hash(path("")) != hash && !editor.Root().Equals(root));
+  assert(editor.Remove(path("Pos.w")) && editor.Hash(path("")) == hash);
+
+  // equal data exports to the same bytes in canonical order, in the order of the canonical hash
+  std::string text, reversedText;
+  std::vector<uint8_t> const canonical = exportCanonical(document, &text);
+  assert(canonical == exportCanonical(reversed, &reversedText) && text == reversedText);
+  assert(canonical == exportCanonical(editor.Snapshot()));
+  ImNBT::Reader reader;
+  reader.ImportBinary(canonical.data(), static_cast<uint32_t>(canonical.size()));
+  assert(reader.Root().Hash() == root.Hash(HashOrder::Canonical));
+}
+
+void WriteDeduplicationTestData(ImNBT::Writer& writer)
+{
+  if (writer.BeginList("Inventory"))
+  {
+    // items of two kinds, whose nested compounds keep them from being shaped
+    for (int i = 0; i < 40; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteString(i % 2 ? "minecraft:diamond_sword" : "minecraft:stone", "id");
+        writer.WriteByte(static_cast<int8_t>(i % 2 ? 1 : 64), "Count");
+        if (writer.BeginCompound("tag"))
+        {
+          writer.WriteInt(0, "Damage");
+          if (writer.BeginList("Enchantments"))
+          {
+            if (writer.BeginCompound())
+            {
+              writer.WriteString("minecraft:sharpness", "id");
+              writer.WriteShort(5, "lvl");
+              writer.EndCompound();
+            }
+            writer.EndList();
+          }
+          writer.EndCompound();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  if (writer.BeginList("Sections"))
+  {
+    int64_t const states[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    for (int i = 0; i < 12; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteByte(static_cast<int8_t>(i), "Y");
+        writer.WriteLongArray(states, 8, "BlockStates");
+        if (writer.BeginList("Palette"))
+        {
+          writer.WriteString("minecraft:air");
+          writer.WriteString("minecraft:stone");
+          writer.EndList();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  if (writer.BeginList("Markers"))
+  {
+    // equal elements still make a shaped list
+    for (int i = 0; i < 10; ++i)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(1, "x");
+        writer.WriteString("marker", "name");
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  if (writer.BeginCompound("Empty"))
+    writer.EndCompound();
+  if (writer.BeginCompound("AlsoEmpty"))
+    writer.EndCompound();
+}
+
+void DeduplicationTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteDeduplicationTestData(writer);
+    writer.Finalize();
+    writer.ExportBinary(data);
+  }
+  auto const exportBinary = [](ImNBT::DocumentPtr const& document) {
+    std::vector<uint8_t> out;
+    ImNBT::Writer{ document }.ExportBinary(out);
+    return out;
+  };
+  auto const path = [](char const* expression) { return *ImNBT::Path::Compile(expression); };
+
+  ImNBT::Reader plainReader;
+  plainReader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::DocumentPtr const plain = plainReader.ReleaseDocument();
+  ImNBT::Reader reader;
+  reader.SetDeduplication(true);
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  ImNBT::DeduplicationStats const stats = reader.GetDeduplicationStats();
+  assert(stats.strings > 0 && stats.arrays == 11 && stats.compounds > 0 && stats.bytesSaved > 0);
+  std::vector<uint8_t> image;
+  assert(reader.ExportFrozen(image));
+  ImNBT::DocumentPtr const deduplicated = reader.ReleaseDocument();
+
+  // the document holds the same data in less memory, and exports the same way
+  assert(deduplicated->MemoryUsage() < plain->MemoryUsage());
+  assert(exportBinary(deduplicated) == data && deduplicated->Root().Equals(plain->Root()));
+  assert(deduplicated->Root().Hash() == plain->Root().Hash());
+  assert(deduplicated->Root()["Markers"][9]["name"].As<ImNBT::StringView>() == "marker");
+
+  // the stats count the last import only
+  reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+  assert(reader.GetDeduplicationStats().compounds == stats.compounds);
+
+  // writers deduplicate as they are written
+  {
+    ImNBT::Writer writer;
+    writer.SetDeduplication(true);
+    WriteDeduplicationTestData(writer);
+    writer.Finalize();
+    std::vector<uint8_t> out;
+    writer.ExportBinary(out);
+    assert(out == data && writer.GetDeduplicationStats().compounds > 0);
+  }
+
+  // edits copy a shared compound first, so the equal items keep their values
+  auto const edit = [&](ImNBT::Editor& editor) {
+    assert(editor.SetInt(path("Inventory[2].tag.Damage"), 7));
+    assert(editor.InsertString(path("Inventory[4].tag"), "Name", "renamed"));
+    assert(editor.AppendCompound(path("Inventory[6].tag.Enchantments")));
+    assert(editor.Remove(path("Sections[3].Palette[0]")));
+    assert(editor.Remove(path("AlsoEmpty")));
+  };
+  ImNBT::Editor plainEditor{ plain };
+  edit(plainEditor);
+  ImNBT::Editor editor{ deduplicated };
+  edit(editor);
+  ImNBT::TagRef const root = editor.Root();
+  assert(*root["Inventory"][2]["tag"]["Damage"].As<int32_t>() == 7 && *root["Inventory"][0]["tag"]["Damage"].As<int32_t>() == 0);
+  assert(root["Inventory"][0]["tag"]["Enchantments"].Hash() == deduplicated->Root()["Inventory"][0]["tag"]["Enchantments"].Hash());
+  assert(root["Sections"][4]["Palette"].Equals(deduplicated->Root()["Sections"][4]["Palette"]));
+  assert(exportBinary(editor.Snapshot()) == exportBinary(plainEditor.Snapshot()));
+  assert(exportBinary(deduplicated) == data);
+
+  // compacting keeps the compounds shared
+  plainEditor.Compact();
+  editor.Compact();
+  assert(editor.Snapshot()->MemoryUsage() < plainEditor.Snapshot()->MemoryUsage());
+  assert(exportBinary(editor.Snapshot()) == exportBinary(plainEditor.Snapshot()));
+  assert(editor.SetInt(path("Inventory[8].tag.Damage"), 9) && *editor.Root()["Inventory"][10]["tag"]["Damage"].As<int32_t>() == 0);
+
+  // and so do frozen images
+  ImNBT::Reader thawed;
+  assert(thawed.ImportFrozen(image.data(), image.size()));
+  ImNBT::Editor thawedEditor{ thawed.ReleaseDocument() };
+  assert(thawedEditor.SetInt(path("Inventory[2].tag.Damage"), 7));
+  assert(*thawedEditor.Root()["Inventory"][0]["tag"]["Damage"].As<int32_t>() == 0);
+}
+
+// large enough to be split into parts and members, with chunks larger than a part and sections smaller
+void WriteParallelTestData(ImNBT::Writer& writer)
+{
+  writer.WriteInt(3465, "DataVersion");
+  if (writer.BeginList("Chunks"))
+  {
+    std::vector<int64_t> states(1024);
+    for (int chunk = 0; chunk < 24; ++chunk)
+    {
+      if (writer.BeginCompound())
+      {
+        writer.WriteInt(chunk, "xPos");
+        writer.WriteString("minecraft:full", "Status");
+        if (writer.BeginList("Sections"))
+        {
+          for (int section = 0; section < 40; ++section)
+          {
+            if (writer.BeginCompound())
+            {
+              std::fill(states.begin(), states.end(), chunk * 100 + section);
+              writer.WriteByte(static_cast<int8_t>(section), "Y");
+              writer.WriteLongArray(states.data(), static_cast<int32_t>(states.size()), "BlockStates");
+              writer.EndCompound();
+            }
+          }
+          writer.EndList();
+        }
+        writer.EndCompound();
+      }
+    }
+    writer.EndList();
+  }
+  writer.Finalize();
+}
+
+void ParallelExportTest()
+{
+  std::vector<uint8_t> data;
+  {
+    ImNBT::Writer writer;
+    WriteParallelTestData(writer);
+    writer.ExportBinary(data);
+  }
+  assert(data.size() > (size_t(6) << 20));
+  auto const exportBinary = [](ImNBT::DocumentPtr const& document, unsigned threads, bool canonical = false) {
+    std::vector<uint8_t> out{ 1, 2, 3 };
+    ImNBT::Writer writer{ document };
+    writer.SetExportThreads(threads);
+    writer.SetCanonicalOrder(canonical);
+    writer.ExportBinary(out);
+    return out;
+  };
+  auto const read = [&](bool shaping, bool passthrough) {
+    ImNBT::Reader reader;
+    reader.SetListShaping(shaping);
+    reader.SetSourcePassthrough(passthrough);
+    reader.ImportBinary(data.data(), static_cast<uint32_t>(data.size()));
+    return reader.ReleaseDocument();
+  };
+
+  // the output is the same on any number of threads, after what the vector held before
+  ImNBT::DocumentPtr const document = read(false, false);
+  std::vector<uint8_t> const serial = exportBinary(document, 1);
+  assert(serial.size() == data.size() + 3 && std::equal(data.begin(), data.end(), serial.begin() + 3));
+  assert(exportBinary(document, 4) == serial && exportBinary(document, 0) == serial && exportBinary(document, 64) == serial);
+  assert(exportBinary(read(true, false), 4) == serial);
+  assert(exportBinary(document, 4, true) == exportBinary(document, 1, true));
+
+  // compounds passed through from the source are copied within their parts
+  ImNBT::Editor editor{ read(false, true) };
+  assert(editor.SetByte(*ImNBT::Path::Compile("Chunks[5].Sections[7].Y"), -1) && editor.SetInt(*ImNBT::Path::Compile("DataVersion"), 1));
+  ImNBT::DocumentPtr const edited = editor.Snapshot();
+  assert(exportBinary(edited, 4) == exportBinary(edited, 1) && exportBinary(edited, 4) != serial);
+}
+
+void ParallelGzipTest()
+{
+  ImNBT::Writer writer;
+  WriteParallelTestData(writer);
+  std::vector<uint8_t> data;
+  writer.ExportBinary(data);
+  assert(writer.ExportBinaryFile("./test/output/serial.nbt"));
+  writer.SetExportThreads(4);
+  assert(writer.ExportBinaryFile("./test/output/parallel.nbt"));
+
+  std::vector<uint8_t> parallel;
+  if (FILE* file = fopen("./test/output/parallel.nbt", "rb"))
+  {
+    std::array<uint8_t, 8192> buffer;
+    size_t read;
+    while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0)
+      parallel.insert(parallel.end(), buffer.begin(), buffer.begin() + read);
+    fclose(file);
+  }
+  // a gzip member with an extra field, the first of several
+  assert(parallel.size() > 20 && parallel[0] == 0x1f && parallel[1] == 0x8b && parallel[3] == 0x04 && parallel[12] == 'I' && parallel[13] == 'N');
+
+  auto const import = [](char const* file, unsigned threads) {
+    ImNBT::Reader reader;
+    reader.SetImportThreads(threads);
+    std::vector<uint8_t> out;
+    if (reader.ImportBinaryFile(file))
+      ImNBT::Writer{ reader.ReleaseDocument() }.ExportBinary(out);
+    return out;
+  };
+  // any gzip reader inflates the members as one stream, and a single stream is still read on several threads
+  for (char const* file : { "./test/output/serial.nbt", "./test/output/parallel.nbt" })
+    assert(import(file, 1) == data && import(file, 4) == data && import(file, 0) == data);
+
+  // a damaged file is not read either way
+  if (FILE* file = fopen("./test/output/damaged.nbt", "wb"))
+  {
+    fwrite(parallel.data(), 1, parallel.size() - 4, file);
+    fclose(file);
+  }
+  assert(import("./test/output/damaged.nbt", 1).empty() && import("./test/output/damaged.nbt", 4).empty());
+
+  // members claiming more output than their deflate data can hold are rejected before anything is allocated for them
+  if (FILE* file = fopen("./test/output/inflated.nbt", "wb"))
+  {
+    std::array<uint8_t, 30> const member = { 0x1f, 0x8b, 8, 0x04, 0, 0, 0, 0, 0, 255, 8, 0, 'I', 'N', 4, 0, 30, 0, 0, 0, 0x03, 0x00, 0, 0, 0, 0, 0, 0, 0x10, 0 };
+    for (int i = 0; i < 4096; ++i)
+      fwrite(member.data(), 1, member.size(), file);
+    fclose(file);
+  }
+  assert(import("./test/output/inflated.nbt", 1).empty() && import("./test/output/inflated.nbt", 2).empty());
+
+  // members of zeros are inflated to the full ratio of deflate
+  ImNBT::Writer zeros;
+  std::vector<int8_t> const zeroBytes(3 << 20);
+  zeros.WriteByteArray(zeroBytes.data(), static_cast<int32_t>(zeroBytes.size()), "Zeros");
+  zeros.Finalize();
+  std::vector<uint8_t> zeroData;
+  zeros.ExportBinary(zeroData);
+  zeros.SetExportThreads(4);
+  assert(zeros.ExportBinaryFile("./test/output/zeros.nbt"));
+  assert(import("./test/output/zeros.nbt", 4) == zeroData);
+
+  // an index reads across members, such as the one that ends within chunk 21
+  ImNBT::Optional<ImNBT::OffsetIndex> const index = ImNBT::OffsetIndex::Build("./test/output/parallel.nbt", 4, 256 * 1024);
+  assert(index && index->CheckpointCount() >= (data.size() >> 20));
+  assert(index->Find("Chunks[23].Sections[39]"));
+  ImNBT::Reader reader;
+  assert(reader.ImportIndexedSubtree(*index, "Chunks[21]"));
+  assert(reader.ReadInt("xPos") == 21);
+  if (reader.OpenList("Sections"))
+  {
+    for (int section = 0; section < 40; ++section)
+    {
+      assert(reader.OpenCompound());
+      std::vector<int64_t> const states = reader.ReadLongArray("BlockStates");
+      assert(states.size() == 1024 && states.front() == 2100 + section && states.back() == 2100 + section);
+      reader.CloseCompound();
+    }
+    reader.CloseList();
+  }
+  assert(reader.ImportIndexedSubtree(*index, "Chunks[23].Sections[39]"));
+  assert(reader.ReadByte("Y") == 39);
+}
+
 int main()
 {
   //WriterTest();
@@ -257,5 +2498,55 @@ int main()
 
   ListsOfListsOfListsTest();
 
+  ListIterationTest();
+
+  ColumnExtractionTest();
+
+  ShapedListTest();
+
+  BindingTest();
+
+  DecodePlanTest();
+
+  PathTest();
+
+  VisitorTest();
+
+  LazyImportTest();
+
+  ProjectionTest();
+
+  ExtractionTest();
+
+  IndexTest();
+
+  FrozenTest();
+
+  CacheTest();
+
+  CursorTest();
+
+  SnapshotTest();
+
+  MutationTest();
+
+  RoundTripTest();
+
+  PassthroughTest();
+
+  CopyTest();
+
+  ExportCacheTest();
+
+  PatchTest();
+
+  HashTest();
+
+  DeduplicationTest();
+
+  ParallelExportTest();
+
+  ParallelGzipTest();
+
   return 0;
 }